@@ -0,0 +1,271 @@
+// generated by embed_includes.c from rc_includes
+#include "compiler.h"
+
+// stdio.h
+static const struct token embedded_tokens_0[] = {
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 1, .col = 8}, .sval = "ifndef"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 16}, .sval = "STDIO_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 2, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 16}, .sval = "STDIO_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 2}, .llnum = 35ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 3, .col = 9}, .sval = "include"},
+    {.type = 5, .flags = 2, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 20}, .sval = "stdlib.h"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 5, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 5, .col = 8}, .sval = "typedef"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 5, .col = 15}, .sval = "struct"},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 5, .col = 22}, .sval = "_iobuf"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 5, .col = 24}, .llnum = 123ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 7}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 9}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 13}, .sval = "_ptr"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 14}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 7, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 7, .col = 6}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 11}, .sval = "_cnt"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 12}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 8, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 8, .col = 7}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 9}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 14}, .sval = "_base"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 15}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 6}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 12}, .sval = "_flag"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 13}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 10, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 10, .col = 6}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 10, .col = 12}, .sval = "_file"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 10, .col = 13}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 11, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 11, .col = 6}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 11, .col = 15}, .sval = "_charbuf"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 11, .col = 16}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 12, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 12, .col = 6}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 12, .col = 14}, .sval = "_bufsiz"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 12, .col = 15}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 13, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 13, .col = 7}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 13, .col = 9}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 13, .col = 18}, .sval = "_tmpfname"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 13, .col = 19}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 14, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 14, .col = 2}, .llnum = 125ULL},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 14, .col = 7}, .sval = "FILE"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 14, .col = 8}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 15, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 1}, .llnum = 0ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 5}, .sval = "FILE"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 7}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 12}, .sval = "fopen"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 13}, .sval = "("},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 18}, .sval = "const"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 23}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 25}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 33}, .sval = "filename"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 34}, .sval = ","},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 40}, .sval = "const"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 16, .col = 45}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 47}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 51}, .sval = "mode"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 52}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 16, .col = 53}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 17, .col = 4}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 11}, .sval = "fclose"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 12}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 17, .col = 16}, .sval = "FILE"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 18}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 24}, .sval = "stream"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 25}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 17, .col = 26}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 1}, .llnum = 0ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 7}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 14}, .sval = "fwrite"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 15}, .sval = "("},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 20}, .sval = "const"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 25}, .sval = "void"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 27}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 30}, .sval = "ptr"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 31}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 38}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 43}, .sval = "size"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 44}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 51}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 57}, .sval = "count"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 58}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 18, .col = 63}, .sval = "FILE"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 65}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 71}, .sval = "stream"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 72}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 18, .col = 73}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 1}, .llnum = 0ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 7}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 13}, .sval = "fread"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 14}, .sval = "("},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 18}, .sval = "void"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 20}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 23}, .sval = "ptr"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 24}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 31}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 36}, .sval = "size"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 37}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 44}, .sval = "size_t"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 50}, .sval = "count"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 51}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 19, .col = 56}, .sval = "FILE"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 58}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 64}, .sval = "stream"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 65}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 19, .col = 66}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 20, .col = 4}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 11}, .sval = "printf"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 12}, .sval = "("},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 20, .col = 17}, .sval = "const"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 20, .col = 22}, .sval = "char"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 24}, .sval = "*"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 30}, .sval = "format"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 20, .col = 31}, .sval = ","},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 33}, .sval = "."},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 34}, .sval = "."},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 35}, .sval = "."},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 36}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 20, .col = 37}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 21, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 22, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 22, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 22, .col = 7}, .sval = "endif"},
+    {.type = 6, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 22, .col = 18}, .sval = " STDIO_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 23, .col = 1}, .llnum = 0ULL},
+    {}};
+
+// stdlib.h
+static const struct token embedded_tokens_1[] = {
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 1, .col = 8}, .sval = "ifndef"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 17}, .sval = "STDLIB_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 2, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 17}, .sval = "STDLIB_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 4, .col = 8}, .sval = "typedef"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 4, .col = 12}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 19}, .sval = "size_t"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 20}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 5, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 7}, .sval = "endif"},
+    {.type = 6, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 19}, .sval = " STDLIB_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 1}, .llnum = 0ULL},
+    {}};
+
+// stdarg.h
+static const struct token embedded_tokens_2[] = {
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 1, .col = 8}, .sval = "ifndef"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 17}, .sval = "STDARG_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 2, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 17}, .sval = "STDARG_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 2}, .llnum = 35ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 4, .col = 9}, .sval = "include"},
+    {.type = 5, .flags = 2, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 29}, .sval = "stdarg_internal.h"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 5, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 8}, .sval = "typedef"},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 12}, .sval = "int"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 30}, .sval = "__builtin_va_list"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 31}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 1}, .llnum = 0ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 7, .col = 8}, .sval = "typedef"},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 7, .col = 26}, .sval = "__builtin_va_list"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 34}, .sval = "va_list"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 35}, .llnum = 59ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 15}, .sval = "va_arg"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 16}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 18}, .sval = "ap"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 19}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 24}, .sval = "type"},
+    {.type = 3, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 25}, .llnum = 41ULL},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 42}, .sval = "__builtin_va_arg"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 43}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 45}, .sval = "ap"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 9, .col = 46}, .sval = ","},
+    {.type = 1, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 53}, .sval = "sizeof"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 54}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 58}, .sval = "type"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 59}, .llnum = 41ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 60}, .llnum = 41ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 10, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 11, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 11, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 11, .col = 7}, .sval = "endif"},
+    {.type = 6, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 11, .col = 19}, .sval = " STDARG_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 12, .col = 1}, .llnum = 0ULL},
+    {}};
+
+// stddef.h
+static const struct token embedded_tokens_3[] = {
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 1, .col = 8}, .sval = "ifndef"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 1, .col = 17}, .sval = "STDDEF_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 2, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 2, .col = 17}, .sval = "STDDEF_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 3, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 2}, .llnum = 35ULL},
+    {.type = 1, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 4, .col = 9}, .sval = "include"},
+    {.type = 5, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 4, .col = 29}, .sval = "stddef_internal.h"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 5, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 8}, .sval = "define"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 17}, .sval = "offsetof"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 18}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 22}, .sval = "type"},
+    {.type = 2, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 23}, .sval = ","},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 30}, .sval = "member"},
+    {.type = 3, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 31}, .llnum = 41ULL},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 33}, .sval = "&"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 34}, .sval = "("},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 35}, .sval = "("},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 6, .col = 39}, .sval = "type"},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 41}, .sval = "*"},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 42}, .llnum = 41ULL},
+    {.type = 4, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 43}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 44}, .llnum = 41ULL},
+    {.type = 2, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 46}, .sval = "->"},
+    {.type = 0, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 6, .col = 52}, .sval = "member"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 7, .col = 1}, .llnum = 0ULL},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 1}, .llnum = 0ULL},
+    {.type = 3, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 2}, .llnum = 35ULL},
+    {.type = 0, .flags = 0, .whitespace = 1, .num.type = 0, .pos = {.line = 8, .col = 7}, .sval = "endif"},
+    {.type = 6, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 8, .col = 19}, .sval = " STDDEF_H"},
+    {.type = 7, .flags = 0, .whitespace = 0, .num.type = 0, .pos = {.line = 9, .col = 1}, .llnum = 0ULL},
+    {}};
+
+const struct preprocessor_embedded_include preprocessor_embedded_includes[] = {
+    {.name = "stdio.h", .path = "<rc_includes>/stdio.h", .tokens = embedded_tokens_0, .total = 141},
+    {.name = "stdlib.h", .path = "<rc_includes>/stdlib.h", .tokens = embedded_tokens_1, .total = 19},
+    {.name = "stdarg.h", .path = "<rc_includes>/stdarg.h", .tokens = embedded_tokens_2, .total = 48},
+    {.name = "stddef.h", .path = "<rc_includes>/stddef.h", .tokens = embedded_tokens_3, .total = 38},
+    {.name = NULL}};
@@ -1,4 +1,5 @@
 #include "compiler.h"
+#include "helpers/arena.h"
 #include "helpers/vector.h"
 #include <assert.h>
 #include <stdarg.h>
@@ -118,14 +119,20 @@ struct history {
   };
 };
 
+// history frames only live until the top level node they were made for is
+// done, the arena is reset before the next one
+static struct arena *codegen_history_arena = NULL;
+
 static struct history *history_begin(int flags) {
-  struct history *history = calloc(1, sizeof(struct history));
+  struct history *history =
+      arena_alloc(codegen_history_arena, sizeof(struct history));
   history->flags = flags;
   return history;
 }
 
 static struct history *history_down(struct history *history, int flags) {
-  struct history *new_history = calloc(1, sizeof(struct history));
+  struct history *new_history =
+      arena_alloc(codegen_history_arena, sizeof(struct history));
   memcpy(new_history, history, sizeof(struct history));
   new_history->flags = flags;
   return new_history;
@@ -624,15 +631,15 @@ void codegen_generate_variable_for_array(struct node *node) {
 }
 
 void codegen_generate_global_variable(struct node *node) {
-  asm_push("; %s %s", node->var.type.type_str, node->var.name);
+  asm_push("; %s %s", node->var.type->type_str, node->var.name);
 
-  if (node->var.type.flags & DATATYPE_FLAG_IS_ARRAY) {
+  if (node->var.type->flags & DATATYPE_FLAG_IS_ARRAY) {
     codegen_generate_variable_for_array(node);
     codegen_new_scope_entity(node, 0, 0);
     return;
   }
 
-  switch (node->var.type.type) {
+  switch (node->var.type->type) {
   case DATA_TYPE_VOID:
   case DATA_TYPE_CHAR:
   case DATA_TYPE_SHORT:
@@ -682,6 +689,7 @@ void codegen_generate_global_variable_list(struct node *node) {
 }
 
 void codegen_generate_data_section_part(struct node *node) {
+  arena_reset(codegen_history_arena);
   switch (node->type) {
   case NODE_TYPE_VARIABLE:
     codegen_generate_global_variable(node);
@@ -721,7 +729,7 @@ struct resolver_entity *codegen_register_function(struct node *func_node,
 
 void codegen_generate_function_prototype(struct node *node) {
   codegen_register_function(node, 0);
-  asm_push("extern %s", node->func.name);
+  asm_push("extern %s", node->func->name);
 }
 
 void codegen_generate_function_arguments(struct vector *args) {
@@ -1021,11 +1029,11 @@ void codegen_generate_cast_node(struct node *node, struct history *history) {
 
   asm_push_ins_pop("eax", STACK_FRAME_ELEMENT_TYPE_PUSHED_VALUE,
                    "result_value");
-  codegen_reduce_register("eax", datatype_size(&node->cast.dtype),
-                          node->cast.dtype.flags & DATATYPE_FLAG_IS_SIGNED);
+  codegen_reduce_register("eax", datatype_size(node->cast.dtype),
+                          node->cast.dtype->flags & DATATYPE_FLAG_IS_SIGNED);
   asm_push_ins_push_with_data(
       "eax", STACK_FRAME_ELEMENT_TYPE_PUSHED_VALUE, "result_value", 0,
-      &(struct stack_frame_data){.dtype = node->cast.dtype});
+      &(struct stack_frame_data){.dtype = *node->cast.dtype});
 }
 
 void codegen_generate_expressionable(struct node *node,
@@ -2330,9 +2338,9 @@ void codegen_generate_body(struct node *node, struct history *history) {
 
 void codegen_generate_function_with_body(struct node *node) {
   codegen_register_function(node, 0);
-  asm_push("global %s", node->func.name);
-  asm_push("; %s function", node->func.name);
-  asm_push("%s:", node->func.name);
+  asm_push("global %s", node->func->name);
+  asm_push("; %s function", node->func->name);
+  asm_push("%s:", node->func->name);
   add_tab = true;
 
   asm_push_ebp();
@@ -2342,7 +2350,8 @@ void codegen_generate_function_with_body(struct node *node) {
   codegen_new_scope(RESOLVER_DEFAULT_ENTITY_FLAG_IS_LOCAL_STACK);
   codegen_generate_function_arguments(function_node_argument_vec(node));
 
-  codegen_generate_body(node->func.body_n, history_begin(IS_ALONE_STATEMENT));
+  codegen_generate_body(function_node_body(node),
+                        history_begin(IS_ALONE_STATEMENT));
   codegen_finish_scope();
   codegen_stack_add(C_ALIGN(function_node_stack_size(node)));
   asm_pop_ebp();
@@ -2362,6 +2371,7 @@ void codegen_generate_function(struct node *node) {
 }
 
 void codegen_generate_root_node(struct node *node) {
+  arena_reset(codegen_history_arena);
   switch (node->type) {
   case NODE_TYPE_VARIABLE:
     // already processed in data section
@@ -2459,6 +2469,7 @@ int codegen(struct compile_process *process) {
   current_process = process;
   x86_codegen.compiler = current_process;
   scope_create_root(process);
+  codegen_history_arena = arena_create();
   vector_set_peek_pointer(process->node_tree_vec, 0);
   codegen_new_scope(0);
   codegen_generate_data_section();
@@ -2470,5 +2481,7 @@ int codegen(struct compile_process *process) {
 
   // generate read only data section
   codegen_generate_rod();
+  arena_free(codegen_history_arena);
+  codegen_history_arena = NULL;
   return 0;
 }
@@ -1,11 +1,24 @@
 #include "compiler.h"
+#include "helpers/intern.h"
+#include "helpers/vector.h"
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 
 struct lex_process_functions compiler_lex_functions = {
     .next_char = compile_process_next_char,
     .peek_char = compile_process_peek_char,
-    .push_char = compile_process_push_char};
+    .push_char = compile_process_push_char,
+    .source = compile_process_source,
+    .skip_chars = compile_process_skip_chars};
+
+struct lex_process_functions compiler_conditional_lex_functions = {
+    .next_char = compile_process_next_char,
+    .peek_char = compile_process_peek_char,
+    .push_char = compile_process_push_char,
+    .source = compile_process_source,
+    .skip_chars = compile_process_skip_chars,
+    .token_pushed = compile_process_token_pushed};
 
 void compiler_node_error(struct node *node, const char *msg, ...) {
   va_list args;
@@ -17,7 +30,13 @@ void compiler_node_error(struct node *node, const char *msg, ...) {
   exit(-1);
 }
 
+__thread jmp_buf *compiler_error_jmp;
+
 void compiler_error(struct compile_process *compiler, const char *msg, ...) {
+  if (compiler_error_jmp) {
+    longjmp(*compiler_error_jmp, 1);
+  }
+
   va_list args;
   va_start(args, msg);
   vfprintf(stderr, msg, args);
@@ -36,32 +55,139 @@ void compiler_warning(struct compile_process *compiler, const char *msg, ...) {
           compiler->pos.col, compiler->pos.filename);
 }
 
-struct compile_process *
-compile_include_for_include_dir(const char *include_dir, const char *filename,
-                                struct compile_process *parent_process) {
-  char tmp_filename[512];
-  sprintf(tmp_filename, "%s/%s", include_dir, filename);
-  if (file_exists(tmp_filename)) {
-    filename = tmp_filename;
+/**
+ * Lexes the whole file before it is preprocessed, inactive regions included.
+ * Returns false with the lex process back at the start of the file when those
+ * may not lex the way lex_skip_inactive() skips them, that is on a literal
+ * that runs past its line or on an error, which may be in a region the
+ * preprocessor never reads.
+ */
+static bool compiler_lex_up_front(struct lex_process *lex_process) {
+  struct compile_process *process = lex_process->compiler;
+  struct lex_process start = *lex_process;
+  struct pos pos = process->pos;
+  size_t offset = process->cfile.offset;
+
+  jmp_buf error_jmp;
+  if (!setjmp(error_jmp)) {
+    compiler_error_jmp = &error_jmp;
+    int res = process->flags & COMPILE_PROCESS_PARALLEL_LEX
+                  ? lex_parallel(lex_process)
+                  : lex(lex_process);
+    compiler_error_jmp = NULL;
+    if (res == LEXICAL_ANALYSIS_ALL_OK && !lex_process->literal_past_line) {
+      return true;
+    }
   }
 
-  struct compile_process *new_process = compile_process_create(
-      filename, NULL, parent_process->flags, parent_process);
-  if (!new_process) {
-    return NULL;
+  compiler_error_jmp = NULL;
+  vector_clear(lex_process->token_vec);
+  *lex_process = start;
+  process->pos = pos;
+  process->cfile.offset = offset;
+  return false;
+}
+
+static int compiler_lex(struct lex_process *lex_process) {
+  struct compile_process *process = lex_process->compiler;
+  // the token cache and the parallel lexer need every token of the file,
+  // otherwise only the tokens up to the first conditional are lexed and the
+  // preprocessor asks for more
+  if (process->flags &
+          (COMPILE_PROCESS_PARALLEL_LEX | COMPILE_PROCESS_TOKEN_CACHE) &&
+      compiler_lex_up_front(lex_process)) {
+    return LEXICAL_ANALYSIS_ALL_OK;
   }
 
-  struct lex_process *lex_process =
-      lex_process_create(new_process, &compiler_lex_functions, NULL);
-  if (!lex_process) {
+  lex_process->function = &compiler_conditional_lex_functions;
+  process->lex_process = lex_process;
+  return lex(lex_process);
+}
+
+// preprocesses the tokens of a header built into the compiler, only their
+// strings are interned, nothing is read or lexed
+static struct compile_process *
+compile_include_embedded(const struct preprocessor_embedded_include *include,
+                         const char *path,
+                         struct compile_process *parent_process) {
+  struct compile_process *new_process = compile_process_create_embedded(
+      path, parent_process->flags, parent_process);
+  struct vector *token_vec = vector_create(sizeof(struct token));
+  if (include->total) {
+    vector_push_multiple(token_vec, (void *)include->tokens, include->total);
+  }
+
+  for (int i = 0; i < include->total; i++) {
+    struct token *token = vector_at(token_vec, i);
+    token->pos.filename = path;
+    if (token_type_has_text(token->type)) {
+      token->sval = intern_table_add(new_process->strings, token->sval);
+    }
+  }
+
+  new_process->token_vec_original = token_vec;
+  if (preprocessor_run(new_process) != PREPROCESS_ALL_OK) {
     return NULL;
   }
 
-  if (lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
+  return new_process;
+}
+
+// reads and lexes the file at path, from the token cache if it has the file
+static struct compile_process *
+compile_include_lex(const char *path, struct compile_process *parent_process) {
+  struct compile_process *new_process =
+      compile_process_create(path, NULL, parent_process->flags, parent_process);
+  if (!new_process) {
     return NULL;
   }
 
-  new_process->token_vec_original = lex_process_tokens(lex_process);
+  struct vector *token_vec = NULL;
+  if (new_process->flags & COMPILE_PROCESS_TOKEN_CACHE) {
+    token_vec = lex_cache_load(new_process);
+  }
+
+  if (!token_vec) {
+    struct lex_process *lex_process =
+        lex_process_create(new_process, &compiler_lex_functions, NULL);
+    if (!lex_process) {
+      return NULL;
+    }
+
+    if (compiler_lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
+      return NULL;
+    }
+
+    token_vec = lex_process_tokens(lex_process);
+    // a file the preprocessor lexes as it reads it is not cached
+    if (new_process->flags & COMPILE_PROCESS_TOKEN_CACHE &&
+        !new_process->lex_process) {
+      lex_cache_store(new_process, token_vec);
+    }
+  }
+
+  new_process->token_vec_original = token_vec;
+  return new_process;
+}
+
+static struct compile_process *
+compile_include_for_path(const char *path,
+                         struct compile_process *parent_process) {
+  const struct preprocessor_embedded_include *include =
+      preprocessor_embedded_include_for_path(path);
+  if (include) {
+    return compile_include_embedded(include, path, parent_process);
+  }
+
+  struct compile_process *new_process =
+      lex_prefetch_take(path, parent_process);
+  if (!new_process) {
+    new_process = compile_include_lex(path, parent_process);
+  }
+
+  if (!new_process) {
+    return NULL;
+  }
 
   if (preprocessor_run(new_process) != PREPROCESS_ALL_OK) {
     return NULL;
@@ -70,25 +196,140 @@ compile_include_for_include_dir(const char *include_dir, const char *filename,
   return new_process;
 }
 
+void compile_include_dir_of_path(const char *path, char *dir) {
+  const char *slash = path ? strrchr(path, '/') : NULL;
+  if (!slash) {
+    strcpy(dir, ".");
+    return;
+  }
+
+  // the root directory keeps its slash
+  size_t len = slash == path ? 1 : slash - path;
+  memcpy(dir, path, len);
+  dir[len] = 0x00;
+}
+
+static const char *compile_include_dir_of(struct compile_process *process) {
+  char dir[PATH_MAX];
+  compile_include_dir_of_path(process->cfile.abs_path, dir);
+  return intern_table_add(process->strings, dir);
+}
+
+// names resolved for includes of files in dir, keyed by interned name
+static struct hashmap *compile_include_cache_for(struct compile_process *process,
+                                                 const char *dir) {
+  struct hashmap_entry *entry = hashmap_find(process->include_cache, dir);
+  if (entry) {
+    return entry->value;
+  }
+
+  struct hashmap *names = malloc(sizeof(struct hashmap));
+  hashmap_init(names, 16, HASHMAP_POINTER_KEYS);
+  hashmap_add(process->include_cache, dir, names);
+  return names;
+}
+
+// writes the absolute path of filename in dir to path, absolute names are
+// taken as they are
+static bool compile_include_find_in(const char *dir, const char *filename,
+                                    char *path) {
+  if (filename[0] == '/') {
+    return realpath(filename, path);
+  }
+
+  char tmp_filename[PATH_MAX];
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s/%s", dir, filename);
+  return realpath(tmp_filename, path);
+}
+
+const char *compile_include_search(const char *filename, bool angle_brackets,
+                                   const char *dir, int flags,
+                                   struct vector *include_dirs, char *path) {
+  // a file of the program is found before a built in header of the same name
+  if (!angle_brackets && compile_include_find_in(dir, filename, path)) {
+    return path;
+  }
+
+  // the built in headers are served without looking at the disk
+  if (!(flags & COMPILE_PROCESS_DISK_INCLUDES)) {
+    const struct preprocessor_embedded_include *include =
+        preprocessor_embedded_include_for(filename);
+    if (include) {
+      return include->path;
+    }
+
+    if (preprocessor_static_include_handler_for(filename)) {
+      return NULL;
+    }
+  }
+
+  for (int i = 0; i < vector_count(include_dirs); i++) {
+    const char *include_dir = *(const char **)vector_at(include_dirs, i);
+    if (compile_include_find_in(include_dir, filename, path)) {
+      return path;
+    }
+  }
+
+  // in place of the current directory names used to fall back to
+  if (angle_brackets && compile_include_find_in(dir, filename, path)) {
+    return path;
+  }
+
+  return NULL;
+}
+
+const char *compile_include_resolve(const char *filename, bool angle_brackets,
+                                    struct compile_process *parent_process) {
+  const char *name = intern_table_add(parent_process->strings, filename);
+  // the result depends on the including directory and on the brackets, so
+  // names in brackets are cached as written to tell them from quoted ones
+  const char *key = name;
+  if (angle_brackets) {
+    char bracketed[PATH_MAX];
+    snprintf(bracketed, sizeof(bracketed), "<%s>", filename);
+    key = intern_table_add(parent_process->strings, bracketed);
+  }
+
+  const char *dir = compile_include_dir_of(parent_process);
+  struct hashmap *names = compile_include_cache_for(parent_process, dir);
+  struct hashmap_entry *entry = hashmap_find(names, key);
+  if (entry) {
+    return entry->value;
+  }
+
+  char found[PATH_MAX];
+  const char *path =
+      compile_include_search(name, angle_brackets, dir, parent_process->flags,
+                             parent_process->include_dirs, found);
+  if (path) {
+    path = intern_table_add(parent_process->strings, path);
+  }
+
+  hashmap_add(names, key, (void *)path);
+  return path;
+}
+
 // Compile include file with only lexing and preprocessing
-struct compile_process *
-compile_include(const char *filename, struct compile_process *parent_process) {
-  struct compile_process *new_process = NULL;
-  const char *include_dir = compiler_include_dir_begin(parent_process);
-  while (include_dir && !new_process) {
-    new_process =
-        compile_include_for_include_dir(include_dir, filename, parent_process);
-    include_dir = compiler_include_dir_next(parent_process);
+struct compile_process *compile_include(const char *filename,
+                                        bool angle_brackets,
+                                        struct compile_process *parent_process) {
+  const char *path =
+      compile_include_resolve(filename, angle_brackets, parent_process);
+  if (!path) {
+    return NULL;
   }
 
-  return new_process;
+  return compile_include_for_path(path, parent_process);
 }
 
-int compile_file(const char *filename, const char *out_filename, int flags) {
-  struct compile_process *process =
-      compile_process_create(filename, out_filename, flags, NULL);
-  if (!process)
+// lexes and preprocesses the file of the root compile process, the state
+// of the precompiled header is loaded first if there is one
+static int compile_process_preprocess(struct compile_process *process,
+                                      const char *pch_filename) {
+  // the precompiled tokens come before everything in the file
+  if (pch_filename && pch_load(process, pch_filename) != 0) {
     return COMPILER_FAILED_WITH_ERRORS;
+  }
 
   // Perform lexical analysis
   struct lex_process *lex_process =
@@ -97,14 +338,97 @@ int compile_file(const char *filename, const char *out_filename, int flags) {
     return COMPILER_FAILED_WITH_ERRORS;
   }
 
-  if (lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
+  if (compiler_lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
     return COMPILER_FAILED_WITH_ERRORS;
   }
 
   process->token_vec_original = lex_process_tokens(lex_process);
 
   // Perform preprocessing
-  if (preprocessor_run(process) != PREPROCESS_ALL_OK) {
+  int res = preprocessor_run(process);
+  if (process->lex_prefetch) {
+    // every #include has been reached, what is left was lexed for nothing
+    lex_prefetch_free(process->lex_prefetch);
+    process->lex_prefetch = NULL;
+  }
+
+  if (res != PREPROCESS_ALL_OK) {
+    return COMPILER_FAILED_WITH_ERRORS;
+  }
+
+  if (process->flags & COMPILE_PROCESS_MACRO_REPORT) {
+    preprocessor_macro_report(process, stderr);
+  }
+
+  return COMPILER_FILE_COMPILED_OK;
+}
+
+int compile_pch_create(const char *filename, const char *pch_filename,
+                       int flags) {
+  struct compile_process *process =
+      compile_process_create(filename, NULL, flags, NULL);
+  if (!process) {
+    return COMPILER_FAILED_WITH_ERRORS;
+  }
+
+  if (compile_process_preprocess(process, NULL) != COMPILER_FILE_COMPILED_OK) {
+    return COMPILER_FAILED_WITH_ERRORS;
+  }
+
+  // the declarations are saved as well so files using the header do not parse
+  // it again
+  bool parsed = parse(process) == PARSE_ALL_OK;
+  if (pch_create(process, pch_filename, parsed) != 0) {
+    return COMPILER_FAILED_WITH_ERRORS;
+  }
+
+  return COMPILER_FILE_COMPILED_OK;
+}
+
+int compile_preprocess_file(const char *filename, const char *out_filename,
+                            const char *pch_filename, int flags) {
+  struct compile_process *process =
+      compile_process_create(filename, NULL, flags, NULL);
+  if (!process) {
+    return COMPILER_FAILED_WITH_ERRORS;
+  }
+
+  FILE *file = stdout;
+  if (out_filename) {
+    file = fopen(out_filename, "w");
+    if (!file) {
+      return COMPILER_FAILED_WITH_ERRORS;
+    }
+  }
+
+  // tokens are written as the preprocessor closes their segments, an
+  // included file is written as soon as it is preprocessed
+  struct preprocess_output output;
+  preprocess_output_init(&output, file);
+  process->preprocess_output = &output;
+  int res = compile_process_preprocess(process, pch_filename);
+  preprocess_output_finish(&output);
+  process->preprocess_output = NULL;
+  if (out_filename) {
+    fclose(file);
+  }
+
+  return res;
+}
+
+int compile_file(const char *filename, const char *out_filename, int flags) {
+  return compile_file_with_pch(filename, out_filename, NULL, flags);
+}
+
+int compile_file_with_pch(const char *filename, const char *out_filename,
+                          const char *pch_filename, int flags) {
+  struct compile_process *process =
+      compile_process_create(filename, out_filename, flags, NULL);
+  if (!process)
+    return COMPILER_FAILED_WITH_ERRORS;
+
+  if (compile_process_preprocess(process, pch_filename) !=
+      COMPILER_FILE_COMPILED_OK) {
     return COMPILER_FAILED_WITH_ERRORS;
   }
 
@@ -113,6 +437,10 @@ int compile_file(const char *filename, const char *out_filename, int flags) {
     return COMPILER_FAILED_WITH_ERRORS;
   }
 
+  if (process->flags & COMPILE_PROCESS_NODE_REPORT) {
+    node_report(process, stderr);
+  }
+
   // Perform validation
   if (validate(process) != VALIDATION_ALL_OK) {
     return COMPILER_FAILED_WITH_ERRORS;
@@ -1,6 +1,8 @@
 #ifndef ROSEBUDCOMPILER_H
 #define ROSEBUDCOMPILER_H
+#include "helpers/hashmap.h"
 #include <assert.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,6 +16,8 @@
       : size
 #define PATH_MAX 4096
 #define FAIL_ERR(msg) assert(0 == 1 && msg)
+// a 64 bit number in binary with its prefix and suffixes
+#define TOKEN_NUMBER_SPELLING_MAX 72
 
 struct pos {
   int line;
@@ -84,6 +88,12 @@ enum {
 
 enum {
   TOKEN_FLAG_IS_CUSTOM_OPERATOR = 0b00000001,
+  // the string is the file of an #include <file>
+  TOKEN_FLAG_ANGLE_INCLUDE = 0b00000010,
+  // how a number was written, see token_number_spelling()
+  TOKEN_FLAG_HEX_NUMBER = 0b00000100,
+  TOKEN_FLAG_BINARY_NUMBER = 0b00001000,
+  TOKEN_FLAG_UNSIGNED_NUMBER = 0b00010000,
 };
 
 struct token {
@@ -106,21 +116,38 @@ struct token {
   // True if there is a whitespace between the current token and next token
   bool whitespace;
 
-  // (5+10+20)
-  const char *between_brackets;
+  // in memory source the offsets below point into (NULL if none)
+  const char *source;
 
-  // TEST(test hello, 50)
-  const char *between_args;
+  // (5+10+20) offset just past the outermost "(", 0 if not in brackets
+  int between_brackets;
+
+  // TEST(test hello, 50) offset just past the arguments "(", 0 if none
+  int between_args;
 };
 
 struct lex_process;
+struct intern_table;
+struct arena;
 typedef char (*LEX_PROCESS_NEXT_CHAR)(struct lex_process *process);
 typedef char (*LEX_PROCESS_PEEK_CHAR)(struct lex_process *process);
 typedef void (*LEX_PROCESS_PUSH_CHAR)(struct lex_process *process, char c);
+// returns the null terminated source that is being lexed
+typedef const char *(*LEX_PROCESS_SOURCE)(struct lex_process *process);
+// moves past amount characters the lexer already scanned from the source
+typedef void (*LEX_PROCESS_SKIP_CHARS)(struct lex_process *process,
+                                       size_t amount);
+// called after every token is pushed, returning true stops the lexer
+typedef bool (*LEX_PROCESS_TOKEN_PUSHED)(struct lex_process *process);
 struct lex_process_functions {
   LEX_PROCESS_NEXT_CHAR next_char;
   LEX_PROCESS_PEEK_CHAR peek_char;
   LEX_PROCESS_PUSH_CHAR push_char;
+  LEX_PROCESS_SOURCE source;
+  // optional, without it the lexer reads every character with next_char
+  LEX_PROCESS_SKIP_CHARS skip_chars;
+  // optional, without it the lexer runs until the input ends
+  LEX_PROCESS_TOKEN_PUSHED token_pushed;
 };
 
 struct lex_process {
@@ -128,16 +155,32 @@ struct lex_process {
   struct vector *token_vec;
   struct compile_process *compiler;
 
+  // source being lexed, see LEX_PROCESS_SOURCE
+  const char *source;
+
+  // offset of the next character in the source
+  int offset;
+
   /**
    * ((50))
    */
   int current_expression_count;
-  struct buffer *parenthesis_buffer;
-
-  // TEST(hello test, 50)
-  struct buffer *arg_string_buffer;
+  // offset just past the outermost "(" of the current expression
+  int parenthesis_start;
+
+  // TEST(hello test, 50) offset just past the last arguments "(", 0 if none
+  int arg_string_start;
+  // a string ran past the end of its line or the source, unlike the literals
+  // lex_skip_inactive() skips which end at the line
+  bool literal_past_line;
   struct lex_process_functions *function;
 
+  // reused while building the text of each token, the final text is interned
+  struct buffer *scratch;
+
+  // where token text is interned, the compilers table unless lexing a chunk
+  struct intern_table *strings;
+
   // This will be private data that the lexer does not understand
   // but the person using the lexer does understand.
   void *private;
@@ -151,6 +194,23 @@ enum {
 enum {
   COMPILE_PROCESS_EXEC_NASM = 0b00000001,
   COMPILE_PROCESS_EXPORT_AS_OBJECT = 0b00000010,
+  // large files are split into chunks that are lexed on worker threads
+  COMPILE_PROCESS_PARALLEL_LEX = 0b00000100,
+  // included files are lexed once and their tokens cached on disk
+  COMPILE_PROCESS_TOKEN_CACHE = 0b00001000,
+  // headers built into the compiler are read from rc_includes instead
+  COMPILE_PROCESS_DISK_INCLUDES = 0b00010000,
+  // macro expansions and included files are counted and the ones that
+  // produce the most tokens reported after preprocessing
+  COMPILE_PROCESS_MACRO_REPORT = 0b00100000,
+  // included files are resolved and lexed on worker threads ahead of the
+  // preprocessor reaching their #include
+  COMPILE_PROCESS_PREFETCH_INCLUDES = 0b01000000,
+  // the number of nodes and the bytes they take are reported after parsing
+  COMPILE_PROCESS_NODE_REPORT = 0b10000000,
+  // function bodies are skipped by the parser and parsed the first time they
+  // are asked for, see function_node_body()
+  COMPILE_PROCESS_LAZY_FUNCTION_BODIES = 0b100000000,
 };
 
 struct scope {
@@ -226,7 +286,6 @@ enum {
   PREPROCESSOR_DEFINITION_STANDARD,
   PREPROCESSOR_DEFINITION_MACRO_FUNCTION,
   PREPROCESSOR_DEFINITION_NATIVE_CALLBACK,
-  PREPROCESSOR_DEFINITION_TYPEDEF,
 };
 
 enum { PREPROCESS_ALL_OK };
@@ -237,13 +296,23 @@ struct preprocessor_definition;
 struct preprocessor_included_file;
 
 struct preprocessor_function_arg {
-  // vector of struct token*
-  struct vector *tokens;
+  // the tokens of the argument in the preprocessors argument token stack
+  int start;
+  int total;
 };
 
+/**
+ * The arguments of a macro call live on the stacks of the preprocessor so
+ * that expanding a call allocates nothing. Nested calls push their arguments
+ * on top and pop them again before the outer call continues.
+ */
 struct preprocessor_function_args {
-  // vector of struct preprocessor_function_arg
-  struct vector *args;
+  struct preprocessor *preprocessor;
+  // index of the first argument in the argument stack
+  int start;
+  int total;
+  // everything in the argument token stack from here on belongs to the call
+  int token_start;
 };
 
 typedef int (*PREPROCESSOR_DEFINITION_NATIVE_CALL_EVALUATE)(
@@ -269,11 +338,12 @@ struct preprocessor_definition {
 
       // vector of const char* (.i.e. arguments like ABC(a, b, c))
       struct vector *args;
-    } standard;
 
-    struct typedef_preprocessor_definition {
-      struct vector *value;
-    } _typedef;
+      // fully expanded value of an object-like macro, NULL until it is
+      // expanded. Stale unless expansion_generation is the preprocessors
+      struct vector *expansion;
+      unsigned int expansion_generation;
+    } standard;
 
     struct native_callback_preprocessor_definition {
       PREPROCESSOR_DEFINITION_NATIVE_CALL_EVALUATE evaluate;
@@ -282,10 +352,27 @@ struct preprocessor_definition {
   };
 
   struct preprocessor *preprocessor;
+
+  // counted for COMPILE_PROCESS_MACRO_REPORT, the tokens include those of
+  // the macros expanded within
+  size_t expansions;
+  size_t expanded_tokens;
 };
 
 struct preprocessor_included_file {
   char filename[PATH_MAX];
+
+  // macro of an #ifndef X / #define X / #endif around the whole file, the
+  // file is not included again while it is defined. NULL if there is none
+  const char *guard;
+
+  // the file had #pragma once and is never included again
+  bool once;
+
+  // counted for COMPILE_PROCESS_MACRO_REPORT, the tokens do not include
+  // those of the files it included
+  size_t times_included;
+  size_t tokens;
 };
 
 typedef void (*PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION)(
@@ -294,6 +381,26 @@ typedef void (*PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION)(
 PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION
 preprocessor_static_include_handler_for(const char *filename);
 
+// a header of rc_includes that was lexed when the compiler was built
+struct preprocessor_embedded_include {
+  // name as written in an #include
+  const char *name;
+  // what the header is preprocessed as, not a file on disk
+  const char *path;
+  // token strings are not interned yet and the tokens have no filename
+  const struct token *tokens;
+  int total;
+};
+
+// generated from rc_includes by embed_includes.c, ends with a NULL name
+extern const struct preprocessor_embedded_include
+    preprocessor_embedded_includes[];
+
+const struct preprocessor_embedded_include *
+preprocessor_embedded_include_for(const char *filename);
+const struct preprocessor_embedded_include *
+preprocessor_embedded_include_for_path(const char *path);
+
 struct generator;
 struct native_function;
 struct node;
@@ -350,8 +457,29 @@ struct native_function *native_function_get(struct compile_process *compiler,
                                             const char *name);
 
 struct preprocessor {
-  // vector of struct_definition*
-  struct vector *defs;
+  // struct preprocessor_definition* keyed by name
+  struct hashmap defs;
+
+  // how often definitions were looked up and how often they did not exist,
+  // shown by the macro report
+  size_t def_lookups;
+  size_t def_misses;
+
+  // bumped whenever a definition is added or removed, which could change
+  // the expansion of any macro
+  unsigned int generation;
+  // how often native definitions were expanded, their values change from
+  // one use to the next so expansions that reach them are never kept
+  size_t native_expansions;
+
+  // vector of struct preprocessor_definition*, every definition expanded at
+  // least once while COMPILE_PROCESS_MACRO_REPORT is set
+  struct vector *expanded_defs;
+
+  // arguments of the macro calls being expanded, vector of struct
+  // preprocessor_function_arg and vector of struct token
+  struct vector *arg_stack;
+  struct vector *arg_token_stack;
 
   // vector of struct preprocessor_node*
   struct vector *exp_vec;
@@ -364,25 +492,92 @@ struct preprocessor {
   struct vector *includes;
 };
 
+// a run of preprocessed tokens in the token vector of the file they came from
+struct token_segment {
+  struct vector *token_vec;
+  int start;
+  int end;
+  // absolute path of the file that was preprocessed into the tokens
+  const char *filename;
+};
+
+// walks the tokens of a vector of struct token_segment in order
+struct token_cursor {
+  struct vector *segments;
+  int segment;
+  int index;
+};
+
+// writes preprocessed tokens as text, one segment at a time as they are closed
+struct preprocess_output {
+  FILE *file;
+  // segments of the compile process already written
+  int segment;
+  // where the text written so far is in the source, a line marker is
+  // written whenever the tokens leave it
+  const char *filename;
+  int line;
+  bool line_started;
+  // copy of the last token written, the vector it was in may move
+  struct token last_token;
+};
+
+// typedef names and the datatypes they stand for, see typedef_table_get()
+struct typedef_table {
+  // struct typedef_entry* keyed by name
+  struct hashmap entries;
+  // vector of struct typedef_entry* in the order they were added
+  struct vector *order;
+  // typedefs added in [hidden_start, hidden_end) are not returned
+  size_t hidden_start;
+  size_t hidden_end;
+};
+
 struct resolver_process;
+struct lex_prefetch;
 struct compile_process {
   // The flags in regard on how this file should be compiled
   int flags;
 
   struct pos pos;
   struct compile_process_input_file {
-    FILE *fp;
+    // whole file contents, null terminated
+    char *data;
+    size_t size;
+
+    // read offset into data
+    size_t offset;
     const char *abs_path;
   } cfile;
 
   // untampered vector of tokens from lexical analysis for preprocessing
   struct vector *token_vec_original;
 
+  // lexes token_vec_original as the preprocessor reads it, lex() stops after
+  // every conditional directive so inactive regions are skipped rather than
+  // lexed. NULL once the whole file is lexed or if it was lexed up front
+  struct lex_process *lex_process;
+  // the line being lexed is an #if, #ifdef, #ifndef, #elif or #else
+  bool lex_conditional_line;
+
   // The vector of tokens from lexical analysis
   struct vector *token_vec;
 
+  // vector of struct token_segment, the preprocessed tokens in order. Tokens
+  // of included files are referenced in place rather than copied here
+  struct vector *token_segments;
+  // start of the tokens of token_vec that are not in a segment yet
+  int token_segment_start;
+  // the preprocessed tokens are written here as their segments are closed
+  // rather than parsed, NULL unless only preprocessing
+  struct preprocess_output *preprocess_output;
+
   struct vector *node_vec;
   struct vector *node_tree_vec;
+  // nodes are allocated from node_arena, the datatypes and function data
+  // they point to from node_data_arena
+  struct arena *node_arena;
+  struct arena *node_data_arena;
   FILE *ofile;
 
   struct {
@@ -407,8 +602,25 @@ struct compile_process {
   // vector of const char* (include directories)
   struct vector *include_dirs;
 
+  // where each #include was found, shared with included files. Keyed by the
+  // interned directory of the including file, each value is a struct hashmap*
+  // from the interned name to its absolute path or NULL if it was not found
+  struct hashmap *include_cache;
+
+  // lexes included files ahead, shared with included files. NULL unless
+  // COMPILE_PROCESS_PREFETCH_INCLUDES is set
+  struct lex_prefetch *lex_prefetch;
+  // tokens of token_vec_original up to here were looked at for #include
+  int lex_prefetch_index;
+
   // pointer to preprocessor
   struct preprocessor *preprocessor;
+
+  // datatypes declared with typedef, shared with included files
+  struct typedef_table *typedefs;
+
+  // interned token strings, shared with included files
+  struct intern_table *strings;
 };
 
 enum { PARSE_ALL_OK, PARSE_GENERAL_ERROR };
@@ -574,6 +786,47 @@ struct unary {
   };
 };
 
+struct function {
+  // special flags for function nodes
+  int flags;
+
+  // return type of the function
+  struct datatype rtype;
+
+  // function name
+  const char *name;
+
+  struct function_args {
+    // vector of struct node* (variable nodes)
+    struct vector *args;
+
+    // how much to add to EBP to get to the first argument
+    size_t stack_addition;
+  } args;
+
+  // body of the function (NULL if it is a function prototype), use
+  // function_node_body() as it may not be parsed yet
+  struct node *body_n;
+
+  // where the body starts when the parser skipped it
+  struct function_lazy_body {
+    bool pending;
+    struct token_cursor start;
+    // typedefs declared before the function, the ones after are hidden
+    // while the body is parsed
+    size_t typedefs;
+  } lazy_body;
+
+  // stack frame
+  struct stack_frame {
+    // vector of struct stack_frame_element*
+    struct vector *elements;
+  } stack_frame;
+
+  // stack size for all the variables in the function
+  size_t stack_size;
+};
+
 struct node {
   int type;
   int flags;
@@ -601,7 +854,8 @@ struct node {
     } paren;
 
     struct var {
-      struct datatype type;
+      // kept out of line so that every node does not pay for a datatype
+      struct datatype *type;
       int padding;
       int aoffset; // aligned offset
       const char *name;
@@ -653,38 +907,11 @@ struct node {
       struct node *largest_variable_node;
     } body;
 
-    struct function {
-      // special flags for function nodes
-      int flags;
-
-      // return type of the function
-      struct datatype rtype;
-
-      // function name
-      const char *name;
-
-      struct function_args {
-        // vector of struct node* (variable nodes)
-        struct vector *args;
-
-        // how much to add to EBP to get to the first argument
-        size_t stack_addition;
-      } args;
-
-      // body of the function (NULL if it is a function prototype)
-      struct node *body_n;
+    // kept out of line, few nodes are functions
+    struct function *func;
 
-      // stack frame
-      struct stack_frame {
-        // vector of struct stack_frame_element*
-        struct vector *elements;
-      } stack_frame;
-
-      // stack size for all the variables in the function
-      size_t stack_size;
-    } func;
-
-    struct statement {
+    // a node is only ever one kind of statement
+    union statement {
       struct return_stmt {
         // return expression
         struct node *exp;
@@ -768,7 +995,7 @@ struct node {
 
     struct cast {
       // (type) exp
-      struct datatype dtype;
+      struct datatype *dtype;
       struct node *exp;
     } cast;
 
@@ -1184,22 +1411,102 @@ enum {
 };
 
 int compile_file(const char *filename, const char *out_filename, int flags);
+/**
+ * Compiles filename as compile_file() does, with the state saved in the
+ * precompiled header pch_filename loaded before the file is preprocessed.
+ * pch_filename may be NULL.
+ */
+int compile_file_with_pch(const char *filename, const char *out_filename,
+                          const char *pch_filename, int flags);
+/**
+ * Lexes, preprocesses and parses filename and writes the preprocessor state,
+ * the declarations and the preprocessed tokens to pch_filename for
+ * compile_file_with_pch().
+ */
+int compile_pch_create(const char *filename, const char *pch_filename,
+                       int flags);
+/**
+ * Lexes and preprocesses filename and writes the preprocessed tokens as text
+ * with line markers to out_filename, or stdout if out_filename is NULL.
+ */
+int compile_preprocess_file(const char *filename, const char *out_filename,
+                            const char *pch_filename, int flags);
 struct compile_process *
 compile_process_create(const char *filename, const char *filename_out,
                        int flags, struct compile_process *parent_process);
+/**
+ * Creates a compile process without a source file for the tokens of a header
+ * built into the compiler, path names it in positions and line markers.
+ */
+struct compile_process *
+compile_process_create_embedded(const char *path, int flags,
+                                struct compile_process *parent_process);
+/**
+ * Creates a compile process for a file that was already read and lexed
+ * elsewhere, the process takes over data which must stay null terminated.
+ */
+struct compile_process *
+compile_process_create_lexed(const char *abs_path, char *data, size_t size,
+                             int flags, struct compile_process *parent_process);
+char *compile_process_read_file(FILE *file, size_t *size_out);
 
 char compile_process_next_char(struct lex_process *lex_process);
 char compile_process_peek_char(struct lex_process *lex_process);
 void compile_process_push_char(struct lex_process *lex_process, char c);
+const char *compile_process_source(struct lex_process *lex_process);
+void compile_process_skip_chars(struct lex_process *lex_process,
+                                size_t amount);
+// reads the compile process source, lexing every token of it
+extern struct lex_process_functions compiler_lex_functions;
+/**
+ * Stops the lexer at the end of every conditional directive line, see
+ * compile_process.lex_process.
+ */
+bool compile_process_token_pushed(struct lex_process *lex_process);
 
+/**
+ * Moves the tokens pushed to token_vec since the last call into a segment.
+ */
+void compile_process_close_token_segment(struct compile_process *process);
+/**
+ * Appends the preprocessed tokens of an included file without copying them,
+ * the included process must not push any more tokens.
+ */
+void compile_process_splice_tokens(struct compile_process *process,
+                                   struct compile_process *included_process);
 const char *compiler_include_dir_begin(struct compile_process *process);
 const char *compiler_include_dir_next(struct compile_process *process);
 void compiler_setup_default_include_dir(struct vector *include_dirs);
+/**
+ * Searches for the file of an #include the way compile_include_resolve does
+ * without its cache, so it may run on any thread. Returns path with the
+ * absolute path of the file written to it, the path of the built in header
+ * when filename is one of them or NULL if there is no such file. path holds
+ * PATH_MAX bytes, dir is the directory of the including file.
+ */
+const char *compile_include_search(const char *filename, bool angle_brackets,
+                                   const char *dir, int flags,
+                                   struct vector *include_dirs, char *path);
+// writes the directory of path to dir, "." if the path has none
+void compile_include_dir_of_path(const char *path, char *dir);
+/**
+ * Returns the absolute path of the file an #include of filename refers to,
+ * NULL if there is no such file. angle_brackets is true for #include <file>,
+ * the quoted form looks next to the including file first and the bracketed
+ * one after the include directories. Lookups are cached, including the ones
+ * that fail, so each name is only searched for once per including directory.
+ */
+const char *compile_include_resolve(const char *filename, bool angle_brackets,
+                                    struct compile_process *parent_process);
 struct compile_process *compile_include(const char *filename,
+                                        bool angle_brackets,
                                         struct compile_process *parent_process);
 
 void compiler_node_error(struct node *node, const char *msg, ...);
 void compiler_error(struct compile_process *compiler, const char *msg, ...);
+// set on a thread whose errors are not the users, compiler_error jumps
+// here instead of reporting the error and exiting
+extern __thread jmp_buf *compiler_error_jmp;
 void compiler_warning(struct compile_process *compiler, const char *msg, ...);
 
 struct lex_process *lex_process_create(struct compile_process *compiler,
@@ -1209,23 +1516,173 @@ void lex_process_free(struct lex_process *process);
 void *lex_process_private(struct lex_process *process);
 struct vector *lex_process_tokens(struct lex_process *process);
 int lex(struct lex_process *process);
+/**
+ * Moves the lexer past the lines of an inactive conditional region without
+ * producing any tokens. Only directives at the start of a line, comments and
+ * literals are looked at, it stops at the start of the #elif, #else or
+ * #endif that ends the region or at the end of the source.
+ */
+void lex_skip_inactive(struct lex_process *process);
+/**
+ * Lexes the file of the compile process on worker threads when it is large
+ * enough, otherwise behaves exactly like lex(). The tokens are identical to
+ * the ones lex() produces.
+ */
+int lex_parallel(struct lex_process *process);
+/**
+ * Splits every file lex_parallel() lexes into total chunks whatever its size
+ * or the number of cpus, 0 goes back to picking the count from both.
+ */
+void lex_parallel_set_chunks(int total);
+
+/**
+ * Starts the threads that resolve and lex included files ahead of the
+ * preprocessor. Preprocessing stays serial, the threads only ever produce
+ * the token vector lex() would for a file.
+ */
+struct lex_prefetch *lex_prefetch_create(struct compile_process *compiler);
+void lex_prefetch_free(struct lex_prefetch *prefetch);
+/**
+ * Queues the files of the #include directives among the tokens lexed for the
+ * compile process since the last call.
+ */
+void lex_prefetch_scan(struct compile_process *compiler);
+/**
+ * Returns a compile process for path with every token of the file lexed,
+ * waiting for a thread that is still lexing it. NULL if no thread lexed the
+ * file, the caller lexes it itself then.
+ */
+struct compile_process *
+lex_prefetch_take(const char *path, struct compile_process *parent_process);
+
+struct lex_edit {
+  // bytes [offset, offset + length) of the source are replaced by text
+  size_t offset;
+  size_t length;
+  const char *text;
+};
+
+/**
+ * Applies the edit to the source of the compile process and returns the new
+ * token vector. Only the tokens from just before the edit up to the point
+ * where the new tokens line up with old_tokens again are lexed, the tokens
+ * after that are copied from old_tokens with their positions shifted.
+ *
+ * old_tokens must be the lexer output for the source before the edit, it is
+ * left untouched but its tokens still point into the old source which is
+ * freed. Returns NULL if the edit is outside of the source.
+ */
+struct vector *lex_relex(struct compile_process *compiler,
+                         struct vector *old_tokens, struct lex_edit *edit);
+
+/**
+ * Returns the tokens cached for the file of the compile process, NULL if
+ * there is no cache or the file changed since the cache was written. The
+ * tokens are identical to the ones lex() produces.
+ */
+struct vector *lex_cache_load(struct compile_process *compiler);
+void lex_cache_store(struct compile_process *compiler,
+                     struct vector *token_vec);
+// writes the name of the cache file for the file at path to out
+void lex_cache_filename(const char *path, char *out, size_t size);
 int parse(struct compile_process *process);
+/**
+ * Parses the body of a function skipped with
+ * COMPILE_PROCESS_LAZY_FUNCTION_BODIES, after parse() has finished.
+ */
+void parse_function_lazy_body(struct node *function_node);
 /**
  * builds tokens for the input string
  */
 struct lex_process *tokens_build_for_string(struct compile_process *compiler,
                                             const char *str);
 
+enum {
+  LEX_SCAN_LEVEL_BEST = -1,
+  LEX_SCAN_LEVEL_SCALAR,
+  LEX_SCAN_LEVEL_SSE2,
+  LEX_SCAN_LEVEL_AVX2
+};
+
+/**
+ * Selects the scanners used by the lexer fast paths, LEX_SCAN_LEVEL_BEST
+ * picks the widest one the cpu supports. Returns the level in use. The best
+ * level is selected at startup, only call this while nothing is being lexed.
+ */
+int lex_scan_select(int level);
+int lex_scan_level();
+const char *lex_scan_level_name(int level);
+size_t lex_scan_whitespace(const char *ptr);
+size_t lex_scan_identifier(const char *ptr);
+size_t lex_scan_until_char(const char *ptr, char c);
+size_t lex_scan_string(const char *ptr, char end_delim);
+void lex_scan_advance_pos(struct pos *pos, const char *ptr, size_t amount);
+
 bool token_is_identifier(struct token *token);
 bool token_is_keyword(struct token *token, const char *value);
 bool token_is_nl_or_comment_or_newline_separator(struct token *token);
 bool token_is_symbol(struct token *token, char c);
 bool keyword_is_datatype(const char *keyword);
+bool is_keyword(const char *str);
 bool token_is_primitive_keyword(struct token *token);
 bool token_is_operator(struct token *token, const char *value);
+bool token_type_has_text(int type);
+/**
+ * Writes the number token as it was written to spelling, which holds
+ * TOKEN_NUMBER_SPELLING_MAX bytes. Only the case of hex digits and suffixes
+ * and leading zeros may differ from the source.
+ */
+void token_number_spelling(struct token *token, char *spelling);
 bool is_operator_token(struct token *token);
-struct vector *tokens_join_vector(struct compile_process *compiler,
-                                  struct vector *token_vec);
+/**
+ * Pushes the token formed by pasting right onto left to the token vector,
+ * only pastes that do not form an identifier or keyword are lexed.
+ */
+void tokens_paste(struct compile_process *compiler, struct token *left,
+                  struct token *right, struct vector *token_vec);
+/**
+ * Returns the interned text of the tokens as they would be written, with a
+ * space wherever whitespace followed a token.
+ */
+const char *tokens_spelling(struct compile_process *compiler,
+                            struct token *tokens, int total);
+void token_cursor_init(struct token_cursor *cursor, struct vector *segments);
+/**
+ * Returns the token at the cursor or NULL at the end, token_cursor_next()
+ * also moves the cursor past it.
+ */
+struct token *token_cursor_peek(struct token_cursor *cursor);
+struct token *token_cursor_next(struct token_cursor *cursor);
+int token_segments_count(struct vector *segments);
+const char *token_between_brackets(struct token *token);
+const char *token_between_args(struct token *token);
+
+struct typedef_table *typedef_table_create();
+/**
+ * Makes name an alias of dtype. A name may only be typedef'd again to the
+ * same type, returns false if it already stands for another one.
+ */
+bool typedef_table_add(struct typedef_table *table, const char *name,
+                       struct datatype *dtype);
+/**
+ * Returns the datatype name is an alias of, NULL if it is not a typedef name.
+ */
+struct datatype *typedef_table_get(struct typedef_table *table,
+                                   const char *name);
+// how many typedefs were added
+size_t typedef_table_count(struct typedef_table *table);
+/**
+ * Returns the typedef added index-th and its name, NULL if there are not that
+ * many. Hidden typedefs are returned too.
+ */
+struct datatype *typedef_table_at(struct typedef_table *table, size_t index,
+                                  const char **name_out);
+/**
+ * Hides the typedefs added after the first count of them until
+ * typedef_table_show_all() is called.
+ */
+void typedef_table_hide_after(struct typedef_table *table, size_t count);
+void typedef_table_show_all(struct typedef_table *table);
 
 bool datatype_is_struct_or_union_for_name(const char *name);
 bool datatype_is_struct_or_union(struct datatype *dtype);
@@ -1297,7 +1754,20 @@ struct node *node_peek();
 struct node *node_peek_or_null();
 void node_push(struct node *node);
 void node_set_vector(struct vector *vec, struct vector *root_vec);
+void node_set_arenas(struct arena *arena, struct arena *data_arena);
 struct node *node_create(struct node *_node);
+
+/**
+ * Returns a copy of the datatype allocated next to the nodes, for the nodes
+ * that keep their datatype out of line
+ */
+struct datatype *node_datatype_create(struct datatype *dtype);
+
+/**
+ * Writes how many nodes the parser created and the bytes they and their out
+ * of line data take. Only used with COMPILE_PROCESS_NODE_REPORT.
+ */
+void node_report(struct compile_process *process, FILE *file);
 struct node *struct_node_for_name(struct compile_process *process,
                                   const char *name);
 struct node *union_node_for_name(struct compile_process *process,
@@ -1325,6 +1795,11 @@ bool function_node_is_prototype(struct node *node);
 bool is_logical_operator(const char *op);
 bool is_logical_node(struct node *node);
 
+/**
+ * Returns the body of the function, parsing it first if the parser skipped it.
+ * NULL for prototypes.
+ */
+struct node *function_node_body(struct node *node);
 size_t function_node_stack_size(struct node *node);
 size_t function_node_argument_stack_addition(struct node *node);
 struct vector *function_node_argument_vec(struct node *node);
@@ -1393,6 +1868,9 @@ struct symbol *symresolver_register_symbol(struct compile_process *process,
 
 #define TOTAL_OPERATOR_GROUPS 14
 #define MAX_OPERATORS_IN_GROUP 12
+// the operand of a unary operator ends at the first operator outside the
+// postfix group, see expressionable_right_operand_limit()
+#define EXPRESSIONABLE_UNARY_OPERAND_LIMIT 2
 
 enum { ASSOCIATIVITY_LEFT_TO_RIGHT, ASSOCIATIVITY_RIGHT_TO_LEFT };
 
@@ -1442,11 +1920,6 @@ typedef void *(*EXPRESSIONABLE_GET_NODE_RIGHT)(
     struct expressionable *expressionable, void *node);
 typedef const char *(*EXPRESSIONABLE_GET_NODE_OP)(
     struct expressionable *expressionable, void *node);
-typedef void **(*EXPRESSIONABLE_GET_NODE_ADDRESS)(
-    struct expressionable *expressionable, void *node);
-typedef void (*EXPRESSIONABLE_SET_EXPRESSION_NODE)(
-    struct expressionable *expressionable, void *node, void *left_node_ptr,
-    void *right_node_ptr, const char *op);
 typedef void *(*EXPRESSIONABLE_JOIN_NODES)(
     struct expressionable *expressionable, void *prev_node, void *next_node);
 typedef bool (*EXPRESSIONABLE_SHOULD_JOIN_NODES)(
@@ -1469,9 +1942,6 @@ struct expressionable_config {
     EXPRESSIONABLE_GET_NODE_LEFT get_node_left;
     EXPRESSIONABLE_GET_NODE_RIGHT get_node_right;
     EXPRESSIONABLE_GET_NODE_OP get_node_op;
-    EXPRESSIONABLE_GET_NODE_ADDRESS get_left_node_address;
-    EXPRESSIONABLE_GET_NODE_ADDRESS get_right_node_address;
-    EXPRESSIONABLE_SET_EXPRESSION_NODE set_expression_node;
     EXPRESSIONABLE_JOIN_NODES join_nodes;
     EXPRESSIONABLE_SHOULD_JOIN_NODES should_join_nodes;
     EXPRESSIONABLE_EXPECTING_ADDITIONAL_NODE expecting_additional_node;
@@ -1485,6 +1955,8 @@ enum {
 
 struct expressionable {
   int flags;
+  // see expressionable_right_operand_limit()
+  int precedence_limit;
   struct expressionable_config config;
   struct vector *token_vec;
   struct vector *node_vec_out;
@@ -1632,12 +2104,20 @@ int expressionable_parse_number(struct expressionable *expressionable);
 int expressionable_parse_identifier(struct expressionable *expressionable);
 int expressionable_parser_get_precedence_for_operator(
     const char *op, struct expressionable_op_precedence_group **group_out);
-bool expressionable_parser_left_op_has_priority(const char *left_op,
-                                                const char *right_op);
-void expressionable_parser_node_shift_children_left(
-    struct expressionable *expressionable, void *node);
-void expressionable_parser_reorder_expression(
-    struct expressionable *expressionable, void **node_out);
+
+/**
+ * Returns the precedence limit for the right operand of the given binary
+ * operator. Operators the limit ends the operand at are left for the caller,
+ * which makes the tree left associative without reordering it afterwards.
+ * Limits are the index of the weakest group still allowed plus one, 0 allows
+ * every operator.
+ */
+int expressionable_right_operand_limit(const char *op);
+
+/**
+ * Returns true if the operator ends an operand parsed with the given limit
+ */
+bool expressionable_op_ends_operand(const char *op, int limit);
 bool expressionable_generic_type_is_value_expressionable(int type);
 void expressionable_expect_op(struct expressionable *expressionable,
                               const char *op);
@@ -1671,6 +2151,49 @@ struct preprocessor_definition *preprocessor_definition_create_native(
     PREPROCESSOR_DEFINITION_NATIVE_CALL_VALUE value,
     struct preprocessor *preprocessor);
 void preprocessor_create_defs(struct preprocessor *preprocessor);
+struct preprocessor_definition *
+preprocessor_definition_create(const char *name, struct vector *value,
+                               struct vector *args,
+                               struct preprocessor *preprocessor);
+struct preprocessor_included_file *
+preprocessor_add_included_file(struct preprocessor *preprocessor,
+                               const char *filename);
+struct preprocessor_included_file *
+preprocessor_get_included_file(struct preprocessor *preprocessor,
+                               const char *filename);
+void preprocessor_create_static_include(
+    struct preprocessor *preprocessor, const char *filename,
+    PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION creation_handler);
+
+/**
+ * Writes the definitions, included files and preprocessed tokens of a
+ * preprocessed compile process to filename, and its declarations if it was
+ * parsed. Returns 0 on success.
+ */
+int pch_create(struct compile_process *compiler, const char *filename,
+               bool parsed);
+/**
+ * Restores the state written by pch_create() into the preprocessor of the
+ * compile process. A compile process that is not only preprocessing takes
+ * the saved declarations into its node tree, symbols and typedefs, otherwise
+ * the saved tokens are appended to its token_vec. Returns 0 on success, -1
+ * if filename is not a precompiled header.
+ */
+int pch_load(struct compile_process *compiler, const char *filename);
+
+/**
+ * Writes the macros and included files that produced the most tokens, see
+ * COMPILE_PROCESS_MACRO_REPORT.
+ */
+void preprocessor_macro_report(struct compile_process *compiler, FILE *file);
+
+void preprocess_output_init(struct preprocess_output *output, FILE *file);
+/**
+ * Writes the segments of token_segments that were not written yet.
+ */
+void preprocess_output_write(struct preprocess_output *output,
+                             struct vector *token_segments);
+void preprocess_output_finish(struct preprocess_output *output);
 
 int validate(struct compile_process *process);
 
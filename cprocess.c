@@ -1,4 +1,6 @@
 #include "compiler.h"
+#include "helpers/arena.h"
+#include "helpers/intern.h"
 #include "helpers/vector.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,30 +28,38 @@ void compiler_setup_default_include_dir(struct vector *include_dirs) {
   }
 }
 
-struct compile_process *
-compile_process_create(const char *filename, const char *filename_out,
-                       int flags, struct compile_process *parent_process) {
-  FILE *file = fopen(filename, "r");
-  if (!file) {
+// reads the whole file into a null terminated buffer so the lexer can refer
+// back to the source by offset
+char *compile_process_read_file(FILE *file, size_t *size_out) {
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size < 0) {
     return NULL;
   }
 
-  FILE *out_file = NULL;
-  if (filename_out) {
-    out_file = fopen(filename_out, "w");
-    if (!out_file) {
-      return NULL;
-    }
-  }
+  char *data = malloc(size + 1);
+  size_t read = fread(data, 1, size, file);
+  data[read] = 0x00;
+  *size_out = read;
+  return data;
+}
 
+static struct compile_process *
+compile_process_new(char *data, size_t size, FILE *out_file, int flags,
+                    struct compile_process *parent_process) {
   struct compile_process *process = calloc(1, sizeof(struct compile_process));
   process->node_vec = vector_create(sizeof(struct node *));
   process->node_tree_vec = vector_create(sizeof(struct node *));
+  process->node_arena = arena_create();
+  process->node_data_arena = arena_create();
   process->token_vec = vector_create(sizeof(struct token));
   process->token_vec_original = vector_create(sizeof(struct token));
+  process->token_segments = vector_create(sizeof(struct token_segment));
 
   process->flags = flags;
-  process->cfile.fp = file;
+  process->cfile.data = data;
+  process->cfile.size = size;
   process->ofile = out_file;
   process->generator = codegenerator_new(process);
   process->resolver = resolver_default_new_process(process);
@@ -60,26 +70,93 @@ compile_process_create(const char *filename, const char *filename_out,
   if (parent_process) {
     process->preprocessor = parent_process->preprocessor;
     process->include_dirs = parent_process->include_dirs;
+    process->include_cache = parent_process->include_cache;
+    process->lex_prefetch = parent_process->lex_prefetch;
+    process->strings = parent_process->strings;
+    process->typedefs = parent_process->typedefs;
   } else {
+    process->strings = intern_table_create();
+    process->typedefs = typedef_table_create();
     process->preprocessor = preprocessor_create(process);
     process->include_dirs = vector_create(sizeof(const char *));
+    process->include_cache = malloc(sizeof(struct hashmap));
+    hashmap_init(process->include_cache, 16, HASHMAP_POINTER_KEYS);
 
     // laod default include dirs
     compiler_setup_default_include_dir(process->include_dirs);
+
+    // the token cache already saves lexing the files it has
+    if ((flags & COMPILE_PROCESS_PREFETCH_INCLUDES) &&
+        !(flags & COMPILE_PROCESS_TOKEN_CACHE)) {
+      process->lex_prefetch = lex_prefetch_create(process);
+    }
   }
 
+  node_set_vector(process->node_vec, process->node_tree_vec);
+  node_set_arenas(process->node_arena, process->node_data_arena);
+  return process;
+}
+
+struct compile_process *
+compile_process_create(const char *filename, const char *filename_out,
+                       int flags, struct compile_process *parent_process) {
+  FILE *file = fopen(filename, "r");
+  if (!file) {
+    return NULL;
+  }
+
+  size_t size = 0;
+  char *data = compile_process_read_file(file, &size);
+  fclose(file);
+  if (!data) {
+    return NULL;
+  }
+
+  FILE *out_file = NULL;
+  if (filename_out) {
+    out_file = fopen(filename_out, "w");
+    if (!out_file) {
+      return NULL;
+    }
+  }
+
+  struct compile_process *process =
+      compile_process_new(data, size, out_file, flags, parent_process);
   char *path = malloc(PATH_MAX);
   realpath(filename, path);
   process->cfile.abs_path = path;
-  node_set_vector(process->node_vec, process->node_tree_vec);
+  return process;
+}
+
+struct compile_process *
+compile_process_create_lexed(const char *abs_path, char *data, size_t size,
+                             int flags, struct compile_process *parent_process) {
+  struct compile_process *process =
+      compile_process_new(data, size, NULL, flags, parent_process);
+  process->cfile.offset = size;
+  process->cfile.abs_path = abs_path;
+  return process;
+}
 
+struct compile_process *
+compile_process_create_embedded(const char *path, int flags,
+                                struct compile_process *parent_process) {
+  // there is no source, the tokens come with the compiler
+  char *data = calloc(1, 1);
+  struct compile_process *process =
+      compile_process_new(data, 0, NULL, flags, parent_process);
+  process->cfile.abs_path = path;
   return process;
 }
 
 char compile_process_next_char(struct lex_process *lex_process) {
   struct compile_process *compiler = lex_process->compiler;
   compiler->pos.col += 1;
-  char c = getc(compiler->cfile.fp);
+  char c = compile_process_peek_char(lex_process);
+  if (c != EOF) {
+    compiler->cfile.offset++;
+  }
+
   if (c == '\n') {
     compiler->pos.line += 1;
     compiler->pos.col = 1;
@@ -90,12 +167,102 @@ char compile_process_next_char(struct lex_process *lex_process) {
 
 char compile_process_peek_char(struct lex_process *lex_process) {
   struct compile_process *compiler = lex_process->compiler;
-  char c = getc(compiler->cfile.fp);
-  ungetc(c, compiler->cfile.fp);
-  return c;
+  if (compiler->cfile.offset >= compiler->cfile.size) {
+    return EOF;
+  }
+
+  return compiler->cfile.data[compiler->cfile.offset];
 }
 
 void compile_process_push_char(struct lex_process *lex_process, char c) {
   struct compile_process *compiler = lex_process->compiler;
-  ungetc(c, compiler->cfile.fp);
+  // only characters that were just read are pushed back
+  assert(compiler->cfile.offset > 0 &&
+         compiler->cfile.data[compiler->cfile.offset - 1] == c);
+  compiler->cfile.offset--;
+  // see pushc, the column has to follow the offset back
+  compiler->pos.col--;
+}
+
+const char *compile_process_source(struct lex_process *lex_process) {
+  return lex_process->compiler->cfile.data;
+}
+
+void compile_process_skip_chars(struct lex_process *lex_process,
+                                size_t amount) {
+  struct compile_process *compiler = lex_process->compiler;
+  assert(compiler->cfile.offset + amount <= compiler->cfile.size);
+  lex_scan_advance_pos(&compiler->pos,
+                       &compiler->cfile.data[compiler->cfile.offset], amount);
+  compiler->cfile.offset += amount;
+}
+
+static bool compile_process_is_conditional_name(struct token *token) {
+  if (token->type != TOKEN_TYPE_IDENTIFIER &&
+      token->type != TOKEN_TYPE_KEYWORD) {
+    return false;
+  }
+
+  return S_EQ(token->sval, "if") || S_EQ(token->sval, "ifdef") ||
+         S_EQ(token->sval, "ifndef") || S_EQ(token->sval, "elif") ||
+         S_EQ(token->sval, "else");
+}
+
+bool compile_process_token_pushed(struct lex_process *lex_process) {
+  struct compile_process *compiler = lex_process->compiler;
+  struct vector *token_vec = lex_process->token_vec;
+  struct token *token = vector_back(token_vec);
+  int total = vector_count(token_vec);
+  if (token->type == TOKEN_TYPE_NEWLINE) {
+    // a directive continues past an escaped newline
+    if (total >= 2 && token_is_symbol(vector_at(token_vec, total - 2), '\\')) {
+      return false;
+    }
+
+    bool stop = compiler->lex_conditional_line;
+    compiler->lex_conditional_line = false;
+    return stop;
+  }
+
+  // only a # at the start of a line begins a directive
+  if (total >= 2 && compile_process_is_conditional_name(token) &&
+      token_is_symbol(vector_at(token_vec, total - 2), '#') &&
+      (total == 2 || ((struct token *)vector_at(token_vec, total - 3))->type ==
+                         TOKEN_TYPE_NEWLINE)) {
+    compiler->lex_conditional_line = true;
+  }
+
+  return false;
+}
+
+void compile_process_close_token_segment(struct compile_process *process) {
+  int end = vector_count(process->token_vec);
+  if (end == process->token_segment_start) {
+    return;
+  }
+
+  struct token_segment segment = {.token_vec = process->token_vec,
+                                  .start = process->token_segment_start,
+                                  .end = end,
+                                  .filename = process->cfile.abs_path};
+  vector_push(process->token_segments, &segment);
+  process->token_segment_start = end;
+  if (process->preprocess_output) {
+    preprocess_output_write(process->preprocess_output,
+                            process->token_segments);
+  }
+}
+
+void compile_process_splice_tokens(struct compile_process *process,
+                                   struct compile_process *included_process) {
+  compile_process_close_token_segment(process);
+  compile_process_close_token_segment(included_process);
+  // only the segments are copied, the tokens stay where they are
+  vector_push_multiple(process->token_segments,
+                       vector_data_ptr(included_process->token_segments),
+                       vector_count(included_process->token_segments));
+  if (process->preprocess_output) {
+    preprocess_output_write(process->preprocess_output,
+                            process->token_segments);
+  }
 }
@@ -0,0 +1,119 @@
+#include "compiler.h"
+#include "helpers/vector.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Lexes the headers of rc_includes with the compilers own lexer and writes
+ * their tokens as C arrays, the compiler then serves #include <stdio.h> and
+ * the like without opening any file.
+ *
+ * embed_includes out.c rc_includes/stdio.h rc_includes/stdlib.h ...
+ */
+
+// the tool itself is built before there are any headers to embed
+const struct preprocessor_embedded_include preprocessor_embedded_includes[] = {
+    {.name = NULL}};
+
+static struct lex_process_functions embed_lex_functions = {
+    .next_char = compile_process_next_char,
+    .peek_char = compile_process_peek_char,
+    .push_char = compile_process_push_char,
+    .source = compile_process_source,
+    .skip_chars = compile_process_skip_chars};
+
+static void embed_write_string(FILE *file, const char *str) {
+  fputc('"', file);
+  for (const char *ptr = str; *ptr; ptr++) {
+    unsigned char c = *ptr;
+    if (c == '"' || c == '\\') {
+      fprintf(file, "\\%c", c);
+    } else if (isprint(c)) {
+      fputc(c, file);
+    } else {
+      fprintf(file, "\\%03o", c);
+    }
+  }
+  fputc('"', file);
+}
+
+static const char *embed_basename(const char *path) {
+  const char *name = strrchr(path, '/');
+  return name ? name + 1 : path;
+}
+
+static int embed_header(FILE *out, const char *path, int index) {
+  struct compile_process *process = compile_process_create(path, NULL, 0, NULL);
+  if (!process) {
+    fprintf(stderr, "embed_includes: cannot read %s\n", path);
+    return -1;
+  }
+
+  struct lex_process *lex_process =
+      lex_process_create(process, &embed_lex_functions, NULL);
+  if (!lex_process || lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
+    fprintf(stderr, "embed_includes: cannot lex %s\n", path);
+    return -1;
+  }
+
+  // the source is not embedded, tokens keep no offsets into it
+  struct vector *token_vec = lex_process_tokens(lex_process);
+  fprintf(out, "\n// %s\nstatic const struct token embedded_tokens_%i[] = {\n",
+          embed_basename(path), index);
+  for (int i = 0; i < vector_count(token_vec); i++) {
+    struct token *token = vector_at(token_vec, i);
+    fprintf(out,
+            "    {.type = %i, .flags = %i, .whitespace = %i, .num.type = %i, "
+            ".pos = {.line = %i, .col = %i}, ",
+            token->type, token->flags, token->whitespace, token->num.type,
+            token->pos.line, token->pos.col);
+    if (token_type_has_text(token->type)) {
+      fputs(".sval = ", out);
+      embed_write_string(out, token->sval);
+    } else {
+      fprintf(out, ".llnum = %lluULL", token->llnum);
+    }
+    fputs("},\n", out);
+  }
+  fprintf(out, "    {}};\n");
+  return vector_count(token_vec);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: embed_includes out.c header...\n");
+    return -1;
+  }
+
+  FILE *out = fopen(argv[1], "w");
+  if (!out) {
+    fprintf(stderr, "embed_includes: cannot write %s\n", argv[1]);
+    return -1;
+  }
+
+  fprintf(out, "// generated by embed_includes.c from rc_includes\n"
+               "#include \"compiler.h\"\n");
+  int totals[argc];
+  for (int i = 2; i < argc; i++) {
+    totals[i] = embed_header(out, argv[i], i - 2);
+    if (totals[i] < 0) {
+      fclose(out);
+      remove(argv[1]);
+      return -1;
+    }
+  }
+
+  fprintf(out, "\nconst struct preprocessor_embedded_include "
+               "preprocessor_embedded_includes[] = {\n");
+  for (int i = 2; i < argc; i++) {
+    const char *name = embed_basename(argv[i]);
+    fprintf(out,
+            "    {.name = \"%s\", .path = \"<rc_includes>/%s\", "
+            ".tokens = embedded_tokens_%i, .total = %i},\n",
+            name, name, i - 2, totals[i]);
+  }
+  fprintf(out, "    {.name = NULL}};\n");
+  fclose(out);
+  return 0;
+}
@@ -148,103 +148,29 @@ int expressionable_parser_get_precedence_for_operator(
   return -1;
 }
 
-bool expressionable_parser_left_op_has_priority(const char *left_op,
-                                                const char *right_op) {
-  struct expressionable_op_precedence_group *group_left = NULL;
-  struct expressionable_op_precedence_group *group_right = NULL;
-  if (S_EQ(left_op, right_op)) {
-    return false;
+int expressionable_right_operand_limit(const char *op) {
+  struct expressionable_op_precedence_group *group = NULL;
+  int precedence = expressionable_parser_get_precedence_for_operator(op, &group);
+  if (precedence < 0) {
+    return 0;
   }
 
-  int precedence_left =
-      expressionable_parser_get_precedence_for_operator(left_op, &group_left);
-  int precedence_right =
-      expressionable_parser_get_precedence_for_operator(right_op, &group_right);
-  if (group_left->associativity == ASSOCIATIVITY_RIGHT_TO_LEFT) {
-    return false;
+  // a - b - c is (a - b) - c but a = b = c is a = (b = c)
+  if (group->associativity == ASSOCIATIVITY_RIGHT_TO_LEFT) {
+    return precedence + 2;
   }
 
-  return precedence_left <= precedence_right;
-}
-
-void expressionable_parser_node_shift_children_left(
-    struct expressionable *expressionable, void *node) {
-  int node_type = expressionable_callbacks(expressionable)
-                      ->get_node_type(expressionable, node);
-  assert(node_type == EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION);
-
-  void *left_node = expressionable_callbacks(expressionable)
-                        ->get_node_left(expressionable, node);
-  void *right_node = expressionable_callbacks(expressionable)
-                         ->get_node_right(expressionable, node);
-  int right_node_type = expressionable_callbacks(expressionable)
-                            ->get_node_type(expressionable, right_node);
-  assert(right_node_type == EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION);
-
-  const char *right_op = expressionable_callbacks(expressionable)
-                             ->get_node_op(expressionable, right_node);
-  void *new_exp_left_node = left_node;
-  void *new_exp_right_node = expressionable_callbacks(expressionable)
-                                 ->get_node_left(expressionable, right_node);
-  const char *node_op = expressionable_callbacks(expressionable)
-                            ->get_node_op(expressionable, node);
-  expressionable_callbacks(expressionable)
-      ->make_expression_node(expressionable, new_exp_left_node,
-                             new_exp_right_node, node_op);
-
-  void *new_left_operand = expressionable_node_pop(expressionable);
-  void *new_right_operand = expressionable_callbacks(expressionable)
-                                ->get_node_right(expressionable, right_node);
-  expressionable_callbacks(expressionable)
-      ->set_expression_node(expressionable, node, new_left_operand,
-                            new_right_operand, right_op);
+  return precedence + 1;
 }
 
-void expressionable_parser_reorder_expression(
-    struct expressionable *expressionable, void **node_out) {
-  void *node = *node_out;
-  int node_type = expressionable_callbacks(expressionable)
-                      ->get_node_type(expressionable, node);
-  if (node_type != EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION) {
-    return;
-  }
-
-  void *left_node = expressionable_callbacks(expressionable)
-                        ->get_node_left(expressionable, node);
-  void *right_node = expressionable_callbacks(expressionable)
-                         ->get_node_right(expressionable, node);
-  int left_node_type = expressionable_callbacks(expressionable)
-                           ->get_node_type(expressionable, left_node);
-  int right_node_type = expressionable_callbacks(expressionable)
-                            ->get_node_type(expressionable, right_node);
-  assert(left_node_type >= 0 && right_node_type >= 0);
-
-  if (left_node_type != EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION && right_node &&
-      right_node_type != EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION) {
-    return;
+bool expressionable_op_ends_operand(const char *op, int limit) {
+  if (!limit) {
+    return false;
   }
 
-  if (left_node_type != EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION && right_node &&
-      right_node_type == EXPRESSIONABLE_GENERIC_TYPE_EXPRESSION) {
-    const char *right_op = expressionable_callbacks(expressionable)
-                               ->get_node_op(expressionable, right_node);
-    const char *main_op = expressionable_callbacks(expressionable)
-                              ->get_node_op(expressionable, node);
-
-    if (expressionable_parser_left_op_has_priority(main_op, right_op)) {
-      expressionable_parser_node_shift_children_left(expressionable, node);
-
-      void **address_of_left =
-          expressionable_callbacks(expressionable)
-              ->get_left_node_address(expressionable, node);
-      void **address_of_right =
-          expressionable_callbacks(expressionable)
-              ->get_right_node_address(expressionable, node);
-      expressionable_parser_reorder_expression(expressionable, address_of_left);
-      expressionable_parser_reorder_expression(expressionable,
-                                               address_of_right);
-    }
-  }
+  struct expressionable_op_precedence_group *group = NULL;
+  int precedence = expressionable_parser_get_precedence_for_operator(op, &group);
+  return precedence >= 0 && precedence + 1 >= limit;
 }
 
 bool expressionable_generic_type_is_value_expressionable(int type) {
@@ -272,7 +198,10 @@ void expressionable_expect_sym(struct expressionable *expressionable, char c) {
 
 void expressionable_deal_with_additional_expression(
     struct expressionable *expressionable) {
-  if (is_operator_token(expressionable_peek_next(expressionable))) {
+  struct token *token = expressionable_peek_next(expressionable);
+  if (is_operator_token(token) &&
+      !expressionable_op_ends_operand(token->sval,
+                                      expressionable->precedence_limit)) {
     expressionable_parse(expressionable);
   }
 }
@@ -290,7 +219,10 @@ void expressionable_parse_parentheses(struct expressionable *expressionable) {
   }
 
   expressionable_expect_op(expressionable, "(");
+  int precedence_limit = expressionable->precedence_limit;
+  expressionable->precedence_limit = 0;
   expressionable_parse(expressionable);
+  expressionable->precedence_limit = precedence_limit;
   expressionable_expect_sym(expressionable, ')');
   void *exp_node = expressionable_node_pop(expressionable);
   expressionable_callbacks(expressionable)
@@ -304,10 +236,19 @@ void expressionable_parse_parentheses(struct expressionable *expressionable) {
   expressionable_deal_with_additional_expression(expressionable);
 }
 
+// !a && b is (!a) && b, only the postfix operators bind tighter
+static void
+expressionable_parse_unary_operand(struct expressionable *expressionable) {
+  int precedence_limit = expressionable->precedence_limit;
+  expressionable->precedence_limit = EXPRESSIONABLE_UNARY_OPERAND_LIMIT;
+  expressionable_parse(expressionable);
+  expressionable->precedence_limit = precedence_limit;
+}
+
 void expressionable_parse_for_normal_unary(
     struct expressionable *expressionable) {
   const char *unary_op = expressionable_token_next(expressionable)->sval;
-  expressionable_parse(expressionable);
+  expressionable_parse_unary_operand(expressionable);
 
   void *unary_operand_node = expressionable_node_pop(expressionable);
   expressionable_callbacks(expressionable)
@@ -327,7 +268,7 @@ int expressionable_get_pointer_depth(struct expressionable *expressionable) {
 void expressionable_parse_for_indirection_unary(
     struct expressionable *expressionable) {
   int depth = expressionable_get_pointer_depth(expressionable);
-  expressionable_parse(expressionable);
+  expressionable_parse_unary_operand(expressionable);
 
   void *unary_operand_node = expressionable_node_pop(expressionable);
   expressionable_callbacks(expressionable)
@@ -338,10 +279,10 @@ void expressionable_parse_unary(struct expressionable *expressionable) {
   const char *unary_op = expressionable_peek_next(expressionable)->sval;
   if (op_is_indirection(unary_op)) {
     expressionable_parse_for_indirection_unary(expressionable);
-    return;
+  } else {
+    expressionable_parse_for_normal_unary(expressionable);
   }
 
-  expressionable_parse_for_normal_unary(expressionable);
   expressionable_deal_with_additional_expression(expressionable);
 }
 
@@ -364,6 +305,10 @@ void expressionable_parse_for_operator(struct expressionable *expressionable) {
   // pop left node
   expressionable_node_pop(expressionable);
 
+  // the right operand ends at the first operator that binds no tighter than
+  // this one, the caller continues the expression from there
+  int precedence_limit = expressionable->precedence_limit;
+  expressionable->precedence_limit = expressionable_right_operand_limit(op);
   if (expressionable_peek_next(expressionable)->type == TOKEN_TYPE_OPERATOR) {
     if (S_EQ(expressionable_peek_next(expressionable)->sval, "(")) {
       expressionable_parse_parentheses(expressionable);
@@ -380,22 +325,24 @@ void expressionable_parse_for_operator(struct expressionable *expressionable) {
     expressionable_parse(expressionable);
   }
 
+  expressionable->precedence_limit = precedence_limit;
   void *node_right = expressionable_node_pop(expressionable);
   expressionable_callbacks(expressionable)
       ->make_expression_node(expressionable, node_left, node_right, op);
-  void *exp_node = expressionable_node_pop(expressionable);
-  expressionable_parser_reorder_expression(expressionable, &exp_node);
-  expressionable_node_push(expressionable, exp_node);
 }
 
 void expressionable_parse_tenary(struct expressionable *expressionable) {
   void *cond_operand = expressionable_node_pop(expressionable);
   expressionable_expect_op(expressionable, "?");
+  int precedence_limit = expressionable->precedence_limit;
+  expressionable->precedence_limit = 0;
   expressionable_parse(expressionable);
 
   void *true_operand = expressionable_node_pop(expressionable);
   expressionable_expect_sym(expressionable, ':');
+  expressionable->precedence_limit = expressionable_right_operand_limit("?");
   expressionable_parse(expressionable);
+  expressionable->precedence_limit = precedence_limit;
 
   void *false_operand = expressionable_node_pop(expressionable);
   expressionable_callbacks(expressionable)
@@ -480,7 +427,21 @@ int expressionable_parse_single(struct expressionable *expressionable) {
   return expressionable_parse_single_with_flags(expressionable, 0);
 }
 
+static bool
+expressionable_next_ends_operand(struct expressionable *expressionable) {
+  struct token *token = expressionable_peek_next(expressionable);
+  return token && token->type == TOKEN_TYPE_OPERATOR &&
+         expressionable_op_ends_operand(token->sval,
+                                        expressionable->precedence_limit);
+}
+
 void expressionable_parse(struct expressionable *expressionable) {
-  while (expressionable_parse_single(expressionable) == 0) {
+  // the first token always starts an operand, - and ( are not binary there
+  if (expressionable_parse_single(expressionable) != 0) {
+    return;
+  }
+
+  while (!expressionable_next_ends_operand(expressionable) &&
+         expressionable_parse_single(expressionable) == 0) {
   }
 }
@@ -84,6 +84,7 @@ bool fixups_resolve(struct fixup_system *system) {
   struct fixup *fixup = fixup_next(system);
   while (fixup) {
     if (fixup->flags & FIXUP_FLAG_RESOLVED) {
+      fixup = fixup_next(system);
       continue;
     }
 
@@ -4,7 +4,7 @@
 
 size_t variable_size(struct node *var_node) {
   assert(var_node->type == NODE_TYPE_VARIABLE);
-  return datatype_size(&var_node->var.type);
+  return datatype_size(var_node->var.type);
 }
 
 size_t variable_size_for_list(struct node *var_list_node) {
@@ -64,7 +64,7 @@ int compute_sum_padding(struct vector *vec) {
     }
 
     padding += cur_node->var.padding;
-    last_type = cur_node->var.type.type;
+    last_type = cur_node->var.type->type;
     last_node = cur_node;
     cur_node = vector_peek_ptr(vec);
   }
@@ -77,12 +77,12 @@ struct node *variable_struct_or_union_body_node(struct node *node) {
     return NULL;
   }
 
-  if (node->var.type.type == DATA_TYPE_STRUCT) {
-    return node->var.type.struct_node->_struct.body_n;
+  if (node->var.type->type == DATA_TYPE_STRUCT) {
+    return node->var.type->struct_node->_struct.body_n;
   }
 
-  if (node->var.type.type == DATA_TYPE_UNION) {
-    return node->var.type.union_node->_union.body_n;
+  if (node->var.type->type == DATA_TYPE_UNION) {
+    return node->var.type->union_node->_union.body_n;
   }
 
   return NULL;
@@ -162,12 +162,12 @@ int struct_offset(struct compile_process *compile_process,
       position += variable_size(var_node_last);
       if (variable_node_is_primitive(var_node_cur)) {
         position =
-            align_value_treat_positive(position, var_node_cur->var.type.size);
+            align_value_treat_positive(position, var_node_cur->var.type->size);
       } else {
         position = align_value_treat_positive(
             position,
             variable_struct_or_union_largest_variable_node(var_node_cur)
-                ->var.type.size);
+                ->var.type->size);
       }
     }
 
@@ -0,0 +1,81 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+static struct arena_block *arena_block_create(size_t size,
+                                              struct arena_block *next) {
+  struct arena_block *block = calloc(1, sizeof(struct arena_block));
+  block->data = calloc(1, size);
+  block->msize = size;
+  block->next = next;
+  return block;
+}
+
+struct arena *arena_create() { return calloc(1, sizeof(struct arena)); }
+
+void *arena_alloc(struct arena *arena, size_t size) {
+  size_t aligned_size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+  struct arena_block *block = arena->block;
+  if (!block || block->len + aligned_size > block->msize) {
+    size_t block_size = ARENA_BLOCK_SIZE;
+    if (aligned_size > block_size) {
+      block_size = aligned_size;
+    }
+
+    block = arena_block_create(block_size, arena->block);
+    arena->block = block;
+  }
+
+  void *ptr = &block->data[block->len];
+  block->len += aligned_size;
+  arena->count++;
+  arena->bytes += size;
+  return ptr;
+}
+
+size_t arena_count(struct arena *arena) { return arena->count; }
+
+size_t arena_bytes(struct arena *arena) { return arena->bytes; }
+
+size_t arena_reserved_bytes(struct arena *arena) {
+  size_t bytes = 0;
+  for (struct arena_block *block = arena->block; block; block = block->next) {
+    bytes += block->msize;
+  }
+
+  return bytes;
+}
+
+void arena_reset(struct arena *arena) {
+  struct arena_block *block = arena->block;
+  if (!block) {
+    return;
+  }
+
+  struct arena_block *next = block->next;
+  while (next) {
+    struct arena_block *tmp = next->next;
+    free(next->data);
+    free(next);
+    next = tmp;
+  }
+
+  // arena_alloc hands out zeroed memory
+  memset(block->data, 0, block->len);
+  block->len = 0;
+  block->next = NULL;
+  arena->count = 0;
+  arena->bytes = 0;
+}
+
+void arena_free(struct arena *arena) {
+  struct arena_block *block = arena->block;
+  while (block) {
+    struct arena_block *next = block->next;
+    free(block->data);
+    free(block);
+    block = next;
+  }
+
+  free(arena);
+}
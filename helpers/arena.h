@@ -0,0 +1,49 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Allocations are carved out of large blocks and are only freed all at once
+// with arena_reset or arena_free
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_ALIGNMENT 16
+
+struct arena_block {
+  char *data;
+  size_t len;
+  size_t msize;
+  struct arena_block *next;
+};
+
+struct arena {
+  // block currently being filled, older blocks are linked through next, NULL
+  // until the first allocation
+  struct arena_block *block;
+
+  // number of allocations and the bytes they asked for
+  size_t count;
+  size_t bytes;
+};
+
+struct arena *arena_create();
+
+/**
+ * Returns zeroed memory of the given size that lives until the arena is freed
+ */
+void *arena_alloc(struct arena *arena, size_t size);
+size_t arena_count(struct arena *arena);
+size_t arena_bytes(struct arena *arena);
+
+/**
+ * Returns the bytes held by the arena's blocks, including unused space
+ */
+size_t arena_reserved_bytes(struct arena *arena);
+
+/**
+ * Invalidates every allocation made so far and keeps the newest block for the
+ * allocations that follow
+ */
+void arena_reset(struct arena *arena);
+void arena_free(struct arena *arena);
+
+#endif
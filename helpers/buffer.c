@@ -2,6 +2,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 struct buffer *buffer_create() {
   struct buffer *buf = calloc(sizeof(struct buffer), 1);
@@ -56,6 +57,13 @@ void buffer_write(struct buffer *buffer, char c) {
   buffer->len++;
 }
 
+void buffer_write_bytes(struct buffer *buffer, const void *data, size_t len) {
+  buffer_need(buffer, len);
+
+  memcpy(&buffer->data[buffer->len], data, len);
+  buffer->len += len;
+}
+
 void *buffer_ptr(struct buffer *buffer) { return buffer->data; }
 
 char buffer_read(struct buffer *buffer) {
@@ -75,6 +83,11 @@ char buffer_peek(struct buffer *buffer) {
   return c;
 }
 
+void buffer_clear(struct buffer *buffer) {
+  buffer->len = 0;
+  buffer->rindex = 0;
+}
+
 void buffer_free(struct buffer *buffer) {
   free(buffer->data);
   free(buffer);
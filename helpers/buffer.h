@@ -22,7 +22,9 @@ void buffer_extend(struct buffer *buffer, size_t size);
 void buffer_printf(struct buffer *buffer, const char *fmt, ...);
 void buffer_printf_no_terminator(struct buffer *buffer, const char *fmt, ...);
 void buffer_write(struct buffer *buffer, char c);
+void buffer_write_bytes(struct buffer *buffer, const void *data, size_t len);
 void *buffer_ptr(struct buffer *buffer);
+void buffer_clear(struct buffer *buffer);
 void buffer_free(struct buffer *buffer);
 
 #endif
@@ -0,0 +1,157 @@
+#include "hashmap.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t hash_fnv1a_update(uint64_t hash, const char *str, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)str[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+uint64_t hash_fnv1a(const char *str, size_t len) {
+  return hash_fnv1a_update(HASH_FNV1A_OFFSET, str, len);
+}
+
+static uint64_t hash_pointer(const void *ptr) {
+  uint64_t hash = (uintptr_t)ptr * 11400714819323198485ULL;
+  return hash ^ (hash >> 32);
+}
+
+static uint64_t hashmap_hash(struct hashmap *map, const void *key,
+                             size_t len) {
+  if (map->key_type == HASHMAP_POINTER_KEYS) {
+    return hash_pointer(key);
+  }
+
+  return hash_fnv1a(key, len);
+}
+
+static bool hashmap_key_equals(struct hashmap *map, const void *entry_key,
+                               const void *key, size_t len) {
+  if (entry_key == key) {
+    return true;
+  }
+
+  if (map->key_type == HASHMAP_POINTER_KEYS) {
+    return false;
+  }
+
+  const char *str = entry_key;
+  return strncmp(str, key, len) == 0 && str[len] == 0x00;
+}
+
+static size_t hashmap_key_len(struct hashmap *map, const void *key) {
+  return map->key_type == HASHMAP_STRING_KEYS ? strlen(key) : 0;
+}
+
+// returns the slot holding the key or the empty slot it would go in
+static struct hashmap_entry *hashmap_slot(struct hashmap *map,
+                                          struct hashmap_entry *entries,
+                                          size_t capacity, const void *key,
+                                          size_t len) {
+  size_t mask = capacity - 1;
+  size_t index = hashmap_hash(map, key, len) & mask;
+  while (entries[index].key &&
+         !hashmap_key_equals(map, entries[index].key, key, len)) {
+    index = (index + 1) & mask;
+  }
+
+  return &entries[index];
+}
+
+void hashmap_init(struct hashmap *map, size_t capacity, int key_type) {
+  map->capacity = 1;
+  while (map->capacity < capacity) {
+    map->capacity *= 2;
+  }
+
+  map->entries = calloc(map->capacity, sizeof(struct hashmap_entry));
+  map->count = 0;
+  map->key_type = key_type;
+}
+
+static void hashmap_grow(struct hashmap *map) {
+  size_t capacity = map->capacity * 2;
+  struct hashmap_entry *entries =
+      calloc(capacity, sizeof(struct hashmap_entry));
+  for (size_t i = 0; i < map->capacity; i++) {
+    struct hashmap_entry *entry = &map->entries[i];
+    if (entry->key) {
+      *hashmap_slot(map, entries, capacity, entry->key,
+                    hashmap_key_len(map, entry->key)) = *entry;
+    }
+  }
+
+  free(map->entries);
+  map->entries = entries;
+  map->capacity = capacity;
+}
+
+struct hashmap_entry *hashmap_find_len(struct hashmap *map, const char *key,
+                                       size_t len) {
+  struct hashmap_entry *entry =
+      hashmap_slot(map, map->entries, map->capacity, key, len);
+  return entry->key ? entry : NULL;
+}
+
+struct hashmap_entry *hashmap_find(struct hashmap *map, const void *key) {
+  return hashmap_find_len(map, key, hashmap_key_len(map, key));
+}
+
+bool hashmap_add(struct hashmap *map, const void *key, void *value) {
+  struct hashmap_entry *entry = hashmap_slot(map, map->entries, map->capacity,
+                                             key, hashmap_key_len(map, key));
+  if (entry->key) {
+    return false;
+  }
+
+  entry->key = key;
+  entry->value = value;
+  map->count++;
+  // keep the load factor under 70%
+  if (map->count * 10 >= map->capacity * 7) {
+    hashmap_grow(map);
+  }
+
+  return true;
+}
+
+bool hashmap_remove(struct hashmap *map, const void *key) {
+  struct hashmap_entry *entries = map->entries;
+  size_t mask = map->capacity - 1;
+  struct hashmap_entry *slot = hashmap_slot(map, entries, map->capacity, key,
+                                            hashmap_key_len(map, key));
+  if (!slot->key) {
+    return false;
+  }
+
+  // shift the rest of the probe run back so no lookup stops at a hole
+  size_t hole = slot - entries;
+  slot->key = NULL;
+  slot->value = NULL;
+  map->count--;
+  for (size_t index = (hole + 1) & mask; entries[index].key;
+       index = (index + 1) & mask) {
+    const void *entry_key = entries[index].key;
+    size_t home =
+        hashmap_hash(map, entry_key, hashmap_key_len(map, entry_key)) & mask;
+    if (((index - home) & mask) >= ((index - hole) & mask)) {
+      entries[hole] = entries[index];
+      entries[index].key = NULL;
+      entries[index].value = NULL;
+      hole = index;
+    }
+  }
+
+  return true;
+}
+
+void hashmap_free(struct hashmap *map) {
+  free(map->entries);
+  map->entries = NULL;
+  map->capacity = 0;
+  map->count = 0;
+}
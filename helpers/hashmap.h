@@ -0,0 +1,65 @@
+#ifndef HASHMAP_H
+#define HASHMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum {
+  // keys are null terminated strings, equal text is the same key
+  HASHMAP_STRING_KEYS,
+  // keys are told apart by address, such as interned strings or nodes
+  HASHMAP_POINTER_KEYS,
+};
+
+struct hashmap_entry {
+  // NULL for empty slots
+  const void *key;
+  void *value;
+};
+
+/**
+ * Open addressed table with linear probing. The table grows before it is 70%
+ * full so a probe always ends at an empty slot. Entries may be walked
+ * directly, any slot with a key is in use.
+ */
+struct hashmap {
+  struct hashmap_entry *entries;
+  // always a power of two
+  size_t capacity;
+  size_t count;
+  int key_type;
+};
+
+#define HASH_FNV1A_OFFSET 14695981039346656037ULL
+
+// FNV-1a
+uint64_t hash_fnv1a(const char *str, size_t len);
+// continues the hash over more bytes, start from HASH_FNV1A_OFFSET
+uint64_t hash_fnv1a_update(uint64_t hash, const char *str, size_t len);
+
+void hashmap_init(struct hashmap *map, size_t capacity, int key_type);
+
+/**
+ * Returns the entry of the key or NULL if there is none. The entry is only
+ * valid until the next key is added.
+ */
+struct hashmap_entry *hashmap_find(struct hashmap *map, const void *key);
+
+// finds a string key that is not null terminated
+struct hashmap_entry *hashmap_find_len(struct hashmap *map, const char *key,
+                                       size_t len);
+
+/**
+ * Adds the key unless the map already has it, the first value added for a
+ * key is kept. Returns true if the key was added.
+ */
+bool hashmap_add(struct hashmap *map, const void *key, void *value);
+
+// returns true if the key was in the map
+bool hashmap_remove(struct hashmap *map, const void *key);
+
+// frees the entries, keys and values belong to the caller
+void hashmap_free(struct hashmap *map);
+
+#endif
@@ -0,0 +1,78 @@
+#include "intern.h"
+#include <stdlib.h>
+#include <string.h>
+
+static struct intern_block *intern_block_create(size_t size,
+                                                struct intern_block *next) {
+  struct intern_block *block = calloc(1, sizeof(struct intern_block));
+  block->data = malloc(size);
+  block->msize = size;
+  block->next = next;
+  return block;
+}
+
+struct intern_table *intern_table_create() {
+  struct intern_table *table = calloc(1, sizeof(struct intern_table));
+  hashmap_init(&table->strings, INTERN_TABLE_START_CAPACITY,
+               HASHMAP_STRING_KEYS);
+  table->block = intern_block_create(INTERN_BLOCK_SIZE, NULL);
+  return table;
+}
+
+static char *intern_table_copy(struct intern_table *table, const char *str,
+                               size_t len) {
+  struct intern_block *block = table->block;
+  if (block->len + len + 1 > block->msize) {
+    size_t size = INTERN_BLOCK_SIZE;
+    if (len + 1 > size) {
+      size = len + 1;
+    }
+
+    block = intern_block_create(size, table->block);
+    table->block = block;
+  }
+
+  char *copy = &block->data[block->len];
+  memcpy(copy, str, len);
+  copy[len] = 0x00;
+  block->len += len + 1;
+  return copy;
+}
+
+const char *intern_table_add_len(struct intern_table *table, const char *str,
+                                 size_t len) {
+  struct hashmap_entry *entry = hashmap_find_len(&table->strings, str, len);
+  if (entry) {
+    return entry->key;
+  }
+
+  const char *interned = intern_table_copy(table, str, len);
+  hashmap_add(&table->strings, interned, NULL);
+  return interned;
+}
+
+const char *intern_table_add(struct intern_table *table, const char *str) {
+  return intern_table_add_len(table, str, strlen(str));
+}
+
+const char *intern_table_get(struct intern_table *table, const char *str) {
+  struct hashmap_entry *entry = hashmap_find(&table->strings, str);
+  return entry ? entry->key : NULL;
+}
+
+size_t intern_table_count(struct intern_table *table) {
+  return table->strings.count;
+}
+
+void intern_table_free(struct intern_table *table) {
+  struct intern_block *block = table->block;
+  while (block) {
+    struct intern_block *next = block->next;
+    free(block->data);
+    free(block);
+    block = next;
+  }
+
+  hashmap_free(&table->strings);
+  free(table);
+}
@@ -0,0 +1,45 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "hashmap.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// Strings are copied into large blocks so that each interned string does not
+// need its own allocation
+#define INTERN_BLOCK_SIZE 65536
+#define INTERN_TABLE_START_CAPACITY 1024
+
+struct intern_block {
+  char *data;
+  size_t len;
+  size_t msize;
+  struct intern_block *next;
+};
+
+struct intern_table {
+  // interned strings keyed by their text
+  struct hashmap strings;
+
+  // block currently being filled, older blocks are linked through next
+  struct intern_block *block;
+};
+
+struct intern_table *intern_table_create();
+
+/**
+ * Returns the interned copy of the given string. Equal strings always return
+ * the same pointer, so interned strings can be compared by address.
+ */
+const char *intern_table_add(struct intern_table *table, const char *str);
+const char *intern_table_add_len(struct intern_table *table, const char *str,
+                                 size_t len);
+
+/**
+ * Returns the interned copy of the string or NULL if it was never interned
+ */
+const char *intern_table_get(struct intern_table *table, const char *str);
+size_t intern_table_count(struct intern_table *table);
+void intern_table_free(struct intern_table *table);
+
+#endif
@@ -202,6 +202,18 @@ void vector_push(struct vector *vector, void *elem) {
   }
 }
 
+void vector_push_multiple(struct vector *vector, void *ptr, int total) {
+  vector_resize_for(vector, total);
+  memcpy(vector_at(vector, vector->rindex), ptr, total * vector->esize);
+
+  vector->rindex += total;
+  vector->count += total;
+
+  if (vector->rindex >= vector->mindex) {
+    vector_resize(vector);
+  }
+}
+
 int vector_fread(struct vector *vector, int amount, FILE *fp) {
   size_t read_amount = fread(vector->data, 1, 1, fp);
   while (read_amount) {
@@ -55,6 +55,8 @@ void *vector_peek_ptr(struct vector *vector);
 void vector_set_peek_pointer(struct vector *vector, int index);
 void vector_set_peek_pointer_end(struct vector *vector);
 void vector_push(struct vector *vector, void *elem);
+// pushes total elements starting at ptr with a single copy
+void vector_push_multiple(struct vector *vector, void *ptr, int total);
 void vector_push_at(struct vector *vector, int index, void *ptr);
 void vector_pop(struct vector *vector);
 void vector_peek_pop(struct vector *vector);
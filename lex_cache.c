@@ -0,0 +1,311 @@
+#include "compiler.h"
+#include "helpers/buffer.h"
+#include "helpers/intern.h"
+#include "helpers/vector.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LEX_CACHE_DIR "./.rc_token_cache"
+#define LEX_CACHE_MAGIC 0x4b4f5452
+#define LEX_CACHE_VERSION 5
+
+/**
+ * A cache file is the header, the path of the lexed file, every distinct
+ * token string null terminated and then one record per token. Each part
+ * starts on an 8 byte boundary so the records can be read straight out of
+ * the mapping.
+ */
+struct lex_cache_header {
+  uint32_t magic;
+  uint32_t version;
+  // guards against a cache written by a build with a different layout
+  uint32_t token_size;
+  uint32_t path_len;
+
+  // the lexed file as it was when the cache was written
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t size;
+
+  uint32_t total_strings;
+  uint32_t strings_size;
+  uint64_t total_tokens;
+
+  // FNV-1a of the header with this field zero and then of the rest of the
+  // file, so damage to any value is noticed
+  uint64_t checksum;
+};
+
+struct lex_cache_token {
+  uint8_t type;
+  uint8_t flags;
+  uint8_t whitespace;
+  // the token had offsets into the source
+  uint8_t has_source;
+  int32_t num_type;
+  int32_t line;
+  int32_t col;
+  int32_t between_brackets;
+  int32_t between_args;
+  // index into the string table for tokens with text, otherwise the value
+  uint64_t value;
+};
+
+// maps the interned token strings to their string table index while writing
+struct lex_cache_strings {
+  // token strings are interned so they are told apart by address
+  struct hashmap indexes;
+  uint32_t count;
+  struct buffer *data;
+};
+
+static size_t lex_cache_align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+void lex_cache_filename(const char *path, char *out, size_t size) {
+  // the path stored in the file settles any collision
+  uint64_t hash = hash_fnv1a(path, strlen(path));
+  snprintf(out, size, "%s/%016llx.tok", LEX_CACHE_DIR,
+           (unsigned long long)hash);
+}
+
+// the checksum of the header, continued over the rest of the file by the
+// caller
+static uint64_t lex_cache_header_checksum(struct lex_cache_header *header) {
+  struct lex_cache_header copy = *header;
+  copy.checksum = 0;
+  return hash_fnv1a_update(HASH_FNV1A_OFFSET, (const char *)&copy,
+                           sizeof(copy));
+}
+
+static bool lex_cache_header_matches(struct lex_cache_header *header,
+                                     struct stat *st) {
+  return header->magic == LEX_CACHE_MAGIC &&
+         header->version == LEX_CACHE_VERSION &&
+         header->token_size == sizeof(struct lex_cache_token) &&
+         header->mtime_sec == st->st_mtim.tv_sec &&
+         header->mtime_nsec == st->st_mtim.tv_nsec &&
+         header->size == (uint64_t)st->st_size;
+}
+
+struct vector *lex_cache_load(struct compile_process *compiler) {
+  const char *path = compiler->cfile.abs_path;
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return NULL;
+  }
+
+  char filename[PATH_MAX];
+  lex_cache_filename(path, filename, sizeof(filename));
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  struct stat cache_st;
+  if (fstat(fd, &cache_st) != 0 ||
+      (size_t)cache_st.st_size < sizeof(struct lex_cache_header)) {
+    close(fd);
+    return NULL;
+  }
+
+  size_t map_size = cache_st.st_size;
+  const char *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return NULL;
+  }
+
+  struct vector *token_vec = NULL;
+  const char **strings = NULL;
+  struct token *tokens = NULL;
+  struct lex_cache_header *header = (struct lex_cache_header *)map;
+  size_t path_offset = sizeof(struct lex_cache_header);
+  size_t strings_offset = path_offset + lex_cache_align(header->path_len + 1);
+  size_t tokens_offset =
+      strings_offset + lex_cache_align(header->strings_size);
+  if (!lex_cache_header_matches(header, &st) || tokens_offset > map_size ||
+      header->total_strings > header->strings_size ||
+      header->total_tokens >
+          (map_size - tokens_offset) / sizeof(struct lex_cache_token) ||
+      tokens_offset + header->total_tokens * sizeof(struct lex_cache_token) !=
+          map_size ||
+      header->path_len != strlen(path) ||
+      memcmp(&map[path_offset], path, header->path_len) != 0 ||
+      hash_fnv1a_update(lex_cache_header_checksum(header), &map[path_offset],
+                        map_size - path_offset) != header->checksum) {
+    goto out;
+  }
+
+  // every distinct string is interned once, the tokens refer to them by
+  // index. Nothing past the table is read however the file was damaged
+  strings = malloc(sizeof(const char *) * (header->total_strings + 1));
+  const char *str = &map[strings_offset];
+  const char *strings_end = str + header->strings_size;
+  for (uint32_t i = 0; i < header->total_strings; i++) {
+    size_t len = strnlen(str, strings_end - str);
+    if (str + len == strings_end) {
+      goto out;
+    }
+
+    strings[i] = intern_table_add_len(compiler->strings, str, len);
+    str += len + 1;
+  }
+
+  struct lex_cache_token *records =
+      (struct lex_cache_token *)&map[tokens_offset];
+  tokens = calloc(header->total_tokens, sizeof(struct token));
+  for (uint64_t i = 0; i < header->total_tokens; i++) {
+    struct lex_cache_token *record = &records[i];
+    struct token *token = &tokens[i];
+    token->type = record->type;
+    token->flags = record->flags;
+    token->whitespace = record->whitespace;
+    token->num.type = record->num_type;
+    token->pos.line = record->line;
+    token->pos.col = record->col;
+    token->pos.filename = path;
+    if (token_type_has_text(record->type)) {
+      if (record->value >= header->total_strings) {
+        goto out;
+      }
+
+      token->sval = strings[record->value];
+    } else {
+      token->llnum = record->value;
+    }
+
+    if (record->has_source) {
+      // the offsets are used to read the source back
+      if (record->between_brackets < 0 || record->between_args < 0 ||
+          (size_t)record->between_brackets > compiler->cfile.size ||
+          (size_t)record->between_args > compiler->cfile.size) {
+        goto out;
+      }
+
+      token->source = compiler->cfile.data;
+      token->between_brackets = record->between_brackets;
+      token->between_args = record->between_args;
+    }
+  }
+
+  token_vec = vector_create(sizeof(struct token));
+  vector_push_multiple(token_vec, tokens, header->total_tokens);
+
+out:
+  // a damaged cache gives NULL, the file is lexed again and the cache
+  // rewritten
+  free(tokens);
+  free(strings);
+  munmap((void *)map, map_size);
+  return token_vec;
+}
+
+static uint32_t lex_cache_string_index(struct lex_cache_strings *strings,
+                                       const char *str) {
+  struct hashmap_entry *entry = hashmap_find(&strings->indexes, str);
+  if (entry) {
+    return (uintptr_t)entry->value;
+  }
+
+  hashmap_add(&strings->indexes, str, (void *)(uintptr_t)strings->count);
+  buffer_write_bytes(strings->data, str, strlen(str) + 1);
+  return strings->count++;
+}
+
+// continues the checksum over a part of the file as lex_cache_write() writes it
+static uint64_t lex_cache_checksum_part(uint64_t checksum, const void *data,
+                                        size_t size) {
+  static const char padding[8] = {};
+  checksum = hash_fnv1a_update(checksum, data, size);
+  return hash_fnv1a_update(checksum, padding, lex_cache_align(size) - size);
+}
+
+static bool lex_cache_write(FILE *file, const void *data, size_t size) {
+  static const char padding[8] = {};
+  return fwrite(data, 1, size, file) == size &&
+         fwrite(padding, 1, lex_cache_align(size) - size, file) ==
+             lex_cache_align(size) - size;
+}
+
+void lex_cache_store(struct compile_process *compiler,
+                     struct vector *token_vec) {
+  const char *path = compiler->cfile.abs_path;
+  struct stat st;
+  if (stat(path, &st) != 0 ||
+      (size_t)st.st_size != compiler->cfile.size) {
+    return;
+  }
+
+  int total = vector_count(token_vec);
+  struct lex_cache_strings strings = {};
+  hashmap_init(&strings.indexes, 1024, HASHMAP_POINTER_KEYS);
+  strings.data = buffer_create();
+
+  struct lex_cache_token *records =
+      calloc(total, sizeof(struct lex_cache_token));
+  for (int i = 0; i < total; i++) {
+    struct token *token = vector_at(token_vec, i);
+    struct lex_cache_token *record = &records[i];
+    record->type = token->type;
+    record->flags = token->flags;
+    record->whitespace = token->whitespace;
+    record->num_type = token->num.type;
+    record->line = token->pos.line;
+    record->col = token->pos.col;
+    record->value = token_type_has_text(token->type)
+                        ? lex_cache_string_index(&strings, token->sval)
+                        : token->llnum;
+    if (token->source) {
+      record->has_source = true;
+      record->between_brackets = token->between_brackets;
+      record->between_args = token->between_args;
+    }
+  }
+
+  struct lex_cache_header header = {
+      .magic = LEX_CACHE_MAGIC,
+      .version = LEX_CACHE_VERSION,
+      .token_size = sizeof(struct lex_cache_token),
+      .path_len = strlen(path),
+      .mtime_sec = st.st_mtim.tv_sec,
+      .mtime_nsec = st.st_mtim.tv_nsec,
+      .size = st.st_size,
+      .total_strings = strings.count,
+      .strings_size = strings.data->len,
+      .total_tokens = total};
+  uint64_t checksum = lex_cache_header_checksum(&header);
+  checksum = lex_cache_checksum_part(checksum, path, header.path_len + 1);
+  checksum = lex_cache_checksum_part(checksum, buffer_ptr(strings.data),
+                                     header.strings_size);
+  header.checksum = lex_cache_checksum_part(
+      checksum, records, total * sizeof(struct lex_cache_token));
+
+  // written to a temporary first so a reader never maps a partial file
+  char filename[PATH_MAX];
+  char tmp_filename[PATH_MAX + 32];
+  lex_cache_filename(path, filename, sizeof(filename));
+  snprintf(tmp_filename, sizeof(tmp_filename), "%s.%i", filename, getpid());
+  mkdir(LEX_CACHE_DIR, 0755);
+  FILE *file = fopen(tmp_filename, "wb");
+  if (file) {
+    bool ok = lex_cache_write(file, &header, sizeof(header)) &&
+              lex_cache_write(file, path, header.path_len + 1) &&
+              lex_cache_write(file, buffer_ptr(strings.data),
+                              header.strings_size) &&
+              lex_cache_write(file, records,
+                              total * sizeof(struct lex_cache_token));
+    if (fclose(file) != 0 || !ok || rename(tmp_filename, filename) != 0) {
+      unlink(tmp_filename);
+    }
+  }
+
+  free(records);
+  buffer_free(strings.data);
+  hashmap_free(&strings.indexes);
+}
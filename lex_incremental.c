@@ -0,0 +1,316 @@
+#include "compiler.h"
+#include "helpers/vector.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * The lexer state that carries from one token to the next, derived from the
+ * tokens themselves the same way lex_new_expression/lex_finish_expression
+ * track it.
+ */
+struct lex_relex_state {
+  // offset just past the token in the source
+  size_t end;
+  int expression_count;
+  int parenthesis_start;
+  int arg_string_start;
+};
+
+struct lex_relex {
+  struct vector *old_tokens;
+  // offsets of the first character of every line of the old source
+  size_t *old_lines;
+  // states of the old tokens, only derived as far as they are needed
+  struct lex_relex_state *old_states;
+  int total_derived;
+
+  struct lex_edit *edit;
+  // where the edited text ends in the old and the new source
+  size_t old_edit_end;
+  size_t new_edit_end;
+  long delta;
+
+  // old token being compared against the newly lexed ones
+  int old_index;
+  // first old token that is copied rather than lexed, -1 until the new
+  // tokens line up with the old ones
+  int resync_index;
+  // how the tokens from resync_index on move, columns only on col_line
+  int line_delta;
+  int col_line;
+  int col_delta;
+};
+
+static size_t *lex_relex_line_starts(const char *data, size_t size) {
+  int total = 1;
+  for (const char *ptr = data; (ptr = memchr(ptr, '\n', data + size - ptr));
+       ptr++) {
+    total++;
+  }
+
+  size_t *lines = malloc(sizeof(size_t) * total);
+  lines[0] = 0;
+  int line = 1;
+  for (const char *ptr = data; (ptr = memchr(ptr, '\n', data + size - ptr));
+       ptr++) {
+    lines[line++] = ptr - data + 1;
+  }
+
+  return lines;
+}
+
+static struct lex_relex_state *lex_relex_old_state(struct lex_relex *relex,
+                                                   int index) {
+  while (relex->total_derived <= index) {
+    int i = relex->total_derived;
+    struct token *token = vector_at(relex->old_tokens, i);
+    struct token *last_token =
+        i > 0 ? vector_at(relex->old_tokens, i - 1) : NULL;
+    struct lex_relex_state state = {};
+    if (i > 0) {
+      state = relex->old_states[i - 1];
+    }
+
+    // tokens hold the position just past them
+    state.end = relex->old_lines[token->pos.line - 1] + token->pos.col - 1;
+    if (token_is_operator(token, "(")) {
+      state.expression_count++;
+      if (state.expression_count == 1) {
+        state.parenthesis_start = state.end;
+      }
+
+      if (last_token && (last_token->type == TOKEN_TYPE_IDENTIFIER ||
+                         token_is_operator(last_token, ","))) {
+        state.arg_string_start = state.end;
+      }
+    } else if (token_is_symbol(token, ')')) {
+      state.expression_count--;
+    }
+
+    relex->old_states[i] = state;
+    relex->total_derived++;
+  }
+
+  return &relex->old_states[index];
+}
+
+// maps an offset of the old source into the new one, -1 if it was replaced
+static long lex_relex_map_offset(struct lex_relex *relex, size_t offset) {
+  if (offset <= relex->edit->offset) {
+    return offset;
+  }
+
+  if (offset >= relex->old_edit_end) {
+    return offset + relex->delta;
+  }
+
+  return -1;
+}
+
+static bool lex_relex_token_equals(struct token *token, struct token *other) {
+  if (token->type != other->type || token->flags != other->flags) {
+    return false;
+  }
+
+  if (token_type_has_text(token->type)) {
+    return S_EQ(token->sval, other->sval);
+  }
+
+  if (token->type == TOKEN_TYPE_NEWLINE) {
+    return true;
+  }
+
+  return token->llnum == other->llnum && token->num.type == other->num.type;
+}
+
+static bool lex_relex_state_equals(struct lex_relex *relex,
+                                   struct lex_relex_state *old_state,
+                                   struct lex_process *process) {
+  if (old_state->expression_count != process->current_expression_count) {
+    return false;
+  }
+
+  // the start of the brackets is only used while inside of them
+  if (process->current_expression_count > 0 &&
+      lex_relex_map_offset(relex, old_state->parenthesis_start) !=
+          process->parenthesis_start) {
+    return false;
+  }
+
+  return lex_relex_map_offset(relex, old_state->arg_string_start) ==
+         process->arg_string_start;
+}
+
+static bool lex_relex_token_pushed(struct lex_process *process) {
+  struct lex_relex *relex = lex_process_private(process);
+  size_t end = process->offset;
+  if (end < relex->new_edit_end) {
+    return false;
+  }
+
+  // past the edit, every old token ending at the same place is a candidate
+  size_t old_end = end - relex->delta;
+  int total = vector_count(relex->old_tokens);
+  while (relex->old_index < total &&
+         lex_relex_old_state(relex, relex->old_index)->end < old_end) {
+    relex->old_index++;
+  }
+
+  if (relex->old_index >= total ||
+      lex_relex_old_state(relex, relex->old_index)->end != old_end) {
+    return false;
+  }
+
+  struct token *token = vector_back(process->token_vec);
+  struct token *old_token = vector_at(relex->old_tokens, relex->old_index);
+  if (!lex_relex_token_equals(token, old_token) ||
+      !lex_relex_state_equals(relex, &relex->old_states[relex->old_index],
+                              process)) {
+    return false;
+  }
+
+  // everything after this token lexes exactly as before, only the old token
+  // knows if whitespace follows it
+  token->whitespace = old_token->whitespace;
+  relex->resync_index = relex->old_index + 1;
+  relex->line_delta = token->pos.line - old_token->pos.line;
+  relex->col_line = old_token->pos.line;
+  relex->col_delta = token->pos.col - old_token->pos.col;
+  return true;
+}
+
+static struct lex_process_functions lex_relex_functions = {
+    .next_char = compile_process_next_char,
+    .peek_char = compile_process_peek_char,
+    .push_char = compile_process_push_char,
+    .source = compile_process_source,
+    .skip_chars = compile_process_skip_chars,
+    .token_pushed = lex_relex_token_pushed};
+
+static char *lex_relex_apply_edit(struct compile_process *compiler,
+                                  struct lex_edit *edit, size_t *size_out) {
+  size_t text_len = strlen(edit->text);
+  size_t size = compiler->cfile.size - edit->length + text_len;
+  char *data = malloc(size + 1);
+  memcpy(data, compiler->cfile.data, edit->offset);
+  memcpy(&data[edit->offset], edit->text, text_len);
+  memcpy(&data[edit->offset + text_len],
+         &compiler->cfile.data[edit->offset + edit->length],
+         compiler->cfile.size - edit->offset - edit->length);
+  data[size] = 0x00;
+  *size_out = size;
+  return data;
+}
+
+// the last token that neither the edit nor the lexers lookahead reach
+static int lex_relex_restart_index(struct lex_relex *relex) {
+  int total = vector_count(relex->old_tokens);
+  int index = 0;
+  while (index < total &&
+         lex_relex_old_state(relex, index)->end + 2 <= relex->edit->offset) {
+    index++;
+  }
+
+  return index - 1;
+}
+
+static void lex_relex_move_token(struct lex_relex *relex, struct token *token,
+                                 const char *source) {
+  if (!token->source) {
+    return;
+  }
+
+  token->source = source;
+  if (token->between_brackets) {
+    token->between_brackets =
+        lex_relex_map_offset(relex, token->between_brackets);
+  }
+
+  if (token->between_args) {
+    token->between_args = lex_relex_map_offset(relex, token->between_args);
+  }
+}
+
+struct vector *lex_relex(struct compile_process *compiler,
+                         struct vector *old_tokens, struct lex_edit *edit) {
+  if (edit->offset + edit->length > compiler->cfile.size) {
+    return NULL;
+  }
+
+  int old_total = vector_count(old_tokens);
+  struct lex_relex relex = {};
+  relex.old_tokens = old_tokens;
+  relex.old_lines =
+      lex_relex_line_starts(compiler->cfile.data, compiler->cfile.size);
+  relex.old_states = calloc(old_total + 1, sizeof(struct lex_relex_state));
+  relex.edit = edit;
+  relex.old_edit_end = edit->offset + edit->length;
+  relex.new_edit_end = edit->offset + strlen(edit->text);
+  relex.delta = (long)relex.new_edit_end - (long)relex.old_edit_end;
+  relex.resync_index = -1;
+
+  int restart = lex_relex_restart_index(&relex);
+  relex.old_index = restart + 1;
+
+  size_t size = 0;
+  char *data = lex_relex_apply_edit(compiler, edit, &size);
+  free(compiler->cfile.data);
+  compiler->cfile.data = data;
+  compiler->cfile.size = size;
+
+  struct lex_process *process =
+      lex_process_create(compiler, &lex_relex_functions, &relex);
+  if (restart >= 0) {
+    // lexing continues as if it had just read the restart token, the token
+    // is pushed first as the lexer looks back at it
+    struct token token = *(struct token *)vector_at(old_tokens, restart);
+    struct lex_relex_state *state = &relex.old_states[restart];
+    lex_relex_move_token(&relex, &token, data);
+    vector_push(process->token_vec, &token);
+    process->offset = state->end;
+    process->pos = token.pos;
+    process->current_expression_count = state->expression_count;
+    process->parenthesis_start = state->parenthesis_start;
+    process->arg_string_start = state->arg_string_start;
+  }
+
+  // the compile process counts lines from 0
+  compiler->cfile.offset = process->offset;
+  compiler->pos = process->pos;
+  compiler->pos.line -= 1;
+  lex(process);
+
+  struct vector *token_vec = vector_create(sizeof(struct token));
+  if (restart > 0) {
+    vector_push_multiple(token_vec, vector_at(old_tokens, 0), restart);
+    for (int i = 0; i < restart; i++) {
+      lex_relex_move_token(&relex, vector_at(token_vec, i), data);
+    }
+  }
+
+  vector_push_multiple(token_vec, vector_at(process->token_vec, 0),
+                       vector_count(process->token_vec));
+
+  // the rest keeps its text, only lines after the edit move and only
+  // columns on the line the tokens lined up again
+  if (relex.resync_index >= 0 && relex.resync_index < old_total) {
+    int start = vector_count(token_vec);
+    vector_push_multiple(token_vec, vector_at(old_tokens, relex.resync_index),
+                         old_total - relex.resync_index);
+    for (int i = start; i < vector_count(token_vec); i++) {
+      struct token *token = vector_at(token_vec, i);
+      if (token->pos.line == relex.col_line) {
+        token->pos.col += relex.col_delta;
+      }
+
+      token->pos.line += relex.line_delta;
+      lex_relex_move_token(&relex, token, data);
+    }
+  }
+
+  compiler->cfile.offset = size;
+  lex_process_free(process);
+  free(relex.old_states);
+  free(relex.old_lines);
+  return token_vec;
+}
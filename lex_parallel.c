@@ -0,0 +1,361 @@
+#include "compiler.h"
+#include "helpers/intern.h"
+#include "helpers/vector.h"
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// files smaller than two chunks are lexed on the calling thread
+#define LEX_PARALLEL_MIN_CHUNK_SIZE (256 * 1024)
+#define LEX_PARALLEL_MAX_CHUNKS 64
+
+// chunk count forced by lex_parallel_set_chunks, 0 if not forced
+static int lex_parallel_forced_chunks;
+
+struct lex_chunk {
+  const char *data;
+  // [start, end) of the source this chunk lexes
+  size_t start;
+  size_t end;
+  size_t offset;
+  // line number of the first character of the chunk
+  int line;
+
+  // each chunk interns into its own table, merged once all chunks are done
+  struct intern_table *strings;
+  struct lex_process *lex_process;
+  pthread_t thread;
+  int res;
+};
+
+static char lex_chunk_next_char(struct lex_process *process) {
+  struct lex_chunk *chunk = lex_process_private(process);
+  if (chunk->offset >= chunk->end) {
+    return EOF;
+  }
+
+  return chunk->data[chunk->offset++];
+}
+
+static char lex_chunk_peek_char(struct lex_process *process) {
+  struct lex_chunk *chunk = lex_process_private(process);
+  if (chunk->offset >= chunk->end) {
+    return EOF;
+  }
+
+  return chunk->data[chunk->offset];
+}
+
+static void lex_chunk_push_char(struct lex_process *process, char c) {
+  struct lex_chunk *chunk = lex_process_private(process);
+  assert(chunk->offset > chunk->start && chunk->data[chunk->offset - 1] == c);
+  chunk->offset--;
+}
+
+static const char *lex_chunk_source(struct lex_process *process) {
+  struct lex_chunk *chunk = lex_process_private(process);
+  return chunk->data;
+}
+
+static void lex_chunk_skip_chars(struct lex_process *process, size_t amount) {
+  struct lex_chunk *chunk = lex_process_private(process);
+  // chunks end on a newline outside of strings and comments so a scanned
+  // run never crosses into the next chunk
+  assert(chunk->offset + amount <= chunk->end);
+  chunk->offset += amount;
+}
+
+static struct lex_process_functions lex_chunk_functions = {
+    .next_char = lex_chunk_next_char,
+    .peek_char = lex_chunk_peek_char,
+    .push_char = lex_chunk_push_char,
+    .source = lex_chunk_source,
+    .skip_chars = lex_chunk_skip_chars};
+
+static bool lex_parallel_is_identifier_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+// mirrors the lexer, a "<" right after the include keyword starts a string
+static bool lex_parallel_is_include_string(const char *data, size_t index) {
+  while (index > 0 && (data[index - 1] == ' ' || data[index - 1] == '\t')) {
+    index--;
+  }
+
+  if (index < 7 || strncmp(&data[index - 7], "include", 7) != 0) {
+    return false;
+  }
+
+  return index == 7 || !lex_parallel_is_identifier_char(data[index - 8]);
+}
+
+// returns the index just past the end delimiter
+static size_t lex_parallel_skip_string(const char *data, size_t size,
+                                       size_t index, char end_delim,
+                                       int *line) {
+  while (index < size) {
+    char c = data[index++];
+    if (c == end_delim) {
+      break;
+    }
+
+    if (c == '\\' && index < size) {
+      c = data[index++];
+    }
+
+    if (c == '\n') {
+      *line += 1;
+    }
+  }
+
+  return index;
+}
+
+static size_t lex_parallel_skip_multiline_comment(const char *data,
+                                                  size_t size, size_t index,
+                                                  int *line) {
+  for (; index < size; index++) {
+    if (data[index] == '*' && data[index + 1] == '/') {
+      return index + 2;
+    }
+
+    if (data[index] == '\n') {
+      *line += 1;
+    }
+  }
+
+  return size;
+}
+
+/**
+ * Cheap pre-scan that splits the source into at most max_chunks chunks. A
+ * chunk only ends after a newline that is outside of any comment, string or
+ * expression and is not followed by whitespace, at that point the only lexer
+ * state carried from one line to the next is the arguments offset.
+ */
+static int lex_parallel_split(const char *data, size_t size,
+                              struct lex_chunk *chunks, int max_chunks) {
+  size_t chunk_size = size / max_chunks;
+  size_t next_split = chunk_size;
+  int total = 1;
+  int depth = 0;
+  int line = 1;
+  size_t index = 0;
+
+  chunks[0].start = 0;
+  chunks[0].line = 1;
+  while (index < size) {
+    char c = data[index];
+    switch (c) {
+    case '\n':
+      line++;
+      index++;
+      if (index >= next_split && depth == 0 && index < size &&
+          data[index] != ' ' && data[index] != '\t' && total < max_chunks) {
+        chunks[total - 1].end = index;
+        chunks[total].start = index;
+        chunks[total].line = line;
+        total++;
+        next_split = index + chunk_size;
+      }
+      continue;
+
+    case '/':
+      if (data[index + 1] == '/') {
+        const char *end = memchr(&data[index], '\n', size - index);
+        index = end ? end - data : size;
+        continue;
+      }
+
+      if (data[index + 1] == '*') {
+        index = lex_parallel_skip_multiline_comment(data, size, index + 2,
+                                                    &line);
+        continue;
+      }
+      break;
+
+    case '"':
+      index = lex_parallel_skip_string(data, size, index + 1, '"', &line);
+      continue;
+
+    case '<':
+      if (lex_parallel_is_include_string(data, index)) {
+        index = lex_parallel_skip_string(data, size, index + 1, '>', &line);
+        continue;
+      }
+      break;
+
+    case '\'': {
+      // 'a' or '\n'
+      size_t end = index + (data[index + 1] == '\\' ? 4 : 3);
+      for (index++; index < end && index < size; index++) {
+        if (data[index] == '\n') {
+          line++;
+        }
+      }
+      continue;
+    }
+
+    case '(':
+      depth++;
+      break;
+
+    case ')':
+      depth--;
+      break;
+    }
+
+    index++;
+  }
+
+  chunks[total - 1].end = size;
+  return total;
+}
+
+// an error in a chunk fails the chunk rather than exiting, it may be in a
+// region the preprocessor skips and the other chunks are still lexing
+static void *lex_parallel_chunk_thread(void *ptr) {
+  struct lex_chunk *chunk = ptr;
+  jmp_buf *caller_jmp = compiler_error_jmp;
+  jmp_buf error_jmp;
+  chunk->res = LEXICAL_ANALYSIS_INPUT_ERROR;
+  if (!setjmp(error_jmp)) {
+    compiler_error_jmp = &error_jmp;
+    chunk->res = lex(chunk->lex_process);
+  }
+
+  compiler_error_jmp = caller_jmp;
+  return NULL;
+}
+
+void lex_parallel_set_chunks(int total) {
+  if (total > LEX_PARALLEL_MAX_CHUNKS) {
+    total = LEX_PARALLEL_MAX_CHUNKS;
+  }
+
+  lex_parallel_forced_chunks = total > 0 ? total : 0;
+}
+
+static int lex_parallel_max_chunks(size_t size) {
+  if (lex_parallel_forced_chunks) {
+    return lex_parallel_forced_chunks;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t max_chunks = size / LEX_PARALLEL_MIN_CHUNK_SIZE;
+  if (cpus > 0 && max_chunks > (size_t)cpus) {
+    max_chunks = cpus;
+  }
+
+  if (max_chunks > LEX_PARALLEL_MAX_CHUNKS) {
+    max_chunks = LEX_PARALLEL_MAX_CHUNKS;
+  }
+
+  return max_chunks;
+}
+
+int lex_parallel(struct lex_process *process) {
+  struct compile_process *compiler = process->compiler;
+  const char *data = compiler->cfile.data;
+  size_t size = compiler->cfile.size;
+
+  // only whole files being lexed from the start can be split
+  int max_chunks = lex_parallel_max_chunks(size);
+  if (process->function->source != compile_process_source ||
+      compiler->cfile.offset != 0 || max_chunks < 2) {
+    return lex(process);
+  }
+
+  // the lexer stops at the first EOF character, leave that to lex()
+  if (memchr(data, (unsigned char)EOF, size)) {
+    return lex(process);
+  }
+
+  struct lex_chunk chunks[LEX_PARALLEL_MAX_CHUNKS] = {};
+  int total = lex_parallel_split(data, size, chunks, max_chunks);
+  if (total < 2) {
+    return lex(process);
+  }
+
+  for (int i = 0; i < total; i++) {
+    struct lex_chunk *chunk = &chunks[i];
+    chunk->data = data;
+    chunk->offset = chunk->start;
+    chunk->strings = intern_table_create();
+    chunk->lex_process =
+        lex_process_create(compiler, &lex_chunk_functions, chunk);
+    chunk->lex_process->strings = chunk->strings;
+    chunk->lex_process->offset = chunk->start;
+    chunk->lex_process->pos.line = chunk->line;
+  }
+
+  // the calling thread lexes the first chunk itself
+  for (int i = 1; i < total; i++) {
+    if (pthread_create(&chunks[i].thread, NULL, lex_parallel_chunk_thread,
+                       &chunks[i]) != 0) {
+      compiler_error(compiler, "Failed to start a lexer thread");
+    }
+  }
+
+  lex_parallel_chunk_thread(&chunks[0]);
+  int res = chunks[0].res;
+  for (int i = 1; i < total; i++) {
+    pthread_join(chunks[i].thread, NULL);
+    if (chunks[i].res != LEXICAL_ANALYSIS_ALL_OK) {
+      res = chunks[i].res;
+    }
+  }
+
+  for (int i = 0; i < total; i++) {
+    if (chunks[i].lex_process->literal_past_line) {
+      process->literal_past_line = true;
+    }
+  }
+
+  // concatenate in source order, moving the text into the compilers table.
+  // The arguments offset is never reset by the lexer so until a chunk sees
+  // its own "name(" it carries on from the chunks before it
+  int arg_string_start = 0;
+  for (int i = 0; i < total; i++) {
+    struct vector *token_vec = lex_process_tokens(chunks[i].lex_process);
+    vector_set_peek_pointer(token_vec, 0);
+    struct token *token = vector_peek(token_vec);
+    while (token) {
+      if (token_type_has_text(token->type)) {
+        token->sval = intern_table_add(process->strings, token->sval);
+      }
+
+      if (token->source && !token->between_args) {
+        token->between_args = arg_string_start;
+      }
+
+      vector_push(process->token_vec, token);
+      token = vector_peek(token_vec);
+    }
+
+    if (chunks[i].lex_process->arg_string_start) {
+      arg_string_start = chunks[i].lex_process->arg_string_start;
+    }
+  }
+
+  // leave the processes where a serial lex() would have left them
+  struct lex_process *last = chunks[total - 1].lex_process;
+  process->source = data;
+  process->offset = last->offset;
+  process->pos = last->pos;
+  compiler->cfile.offset = size;
+  process->arg_string_start = arg_string_start;
+  // the compile process position starts at line 0, col 0
+  compiler->pos.line = last->pos.line - 1;
+  compiler->pos.col = last->pos.line > 1 ? last->pos.col : last->pos.col - 1;
+
+  for (int i = 0; i < total; i++) {
+    lex_process_free(chunks[i].lex_process);
+    intern_table_free(chunks[i].strings);
+  }
+
+  return res;
+}
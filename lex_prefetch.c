@@ -0,0 +1,374 @@
+#include "compiler.h"
+#include "helpers/intern.h"
+#include "helpers/vector.h"
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LEX_PREFETCH_MAX_THREADS 8
+
+enum {
+  LEX_PREFETCH_QUEUED,
+  LEX_PREFETCH_LEXING,
+  LEX_PREFETCH_LEXED,
+  LEX_PREFETCH_FAILED,
+  // handed to the preprocessor, or left to it when no thread got to it
+  LEX_PREFETCH_TAKEN
+};
+
+struct lex_prefetch_file {
+  // name as written in the #include
+  char *name;
+  // directory of the including file and whether the name was in <>, they
+  // decide which file the name refers to like the name does
+  char *dir;
+  bool angle_brackets;
+  // absolute path, the same text compile_include_resolve returns for it.
+  // Set by the thread that resolved the name, NULL until then and for names
+  // that are not found or name a file another name already queued
+  const char *path;
+  int state;
+
+  // stands in for the compile process of the file while it is lexed, only
+  // its input file, position and strings are used by the lexer
+  struct compile_process *compiler;
+  struct lex_process *lex_process;
+};
+
+struct lex_prefetch {
+  int flags;
+  // read only once preprocessing started, shared with the compile processes
+  struct vector *include_dirs;
+
+  // guards files, next_file, stopping and the state of every file
+  pthread_mutex_t lock;
+  // signaled when a file is queued, lexed or the threads have to stop
+  pthread_cond_t cond;
+  // vector of struct lex_prefetch_file*, in the order they were found
+  struct vector *files;
+  // first file no thread has picked up yet
+  int next_file;
+  bool stopping;
+
+  pthread_t threads[LEX_PREFETCH_MAX_THREADS];
+  int total_threads;
+};
+
+static struct lex_process_functions lex_prefetch_functions = {
+    .next_char = compile_process_next_char,
+    .peek_char = compile_process_peek_char,
+    .push_char = compile_process_push_char,
+    .source = compile_process_source,
+    .skip_chars = compile_process_skip_chars};
+
+// runs on any thread, built in headers are never read and never lexed
+static char *lex_prefetch_resolve(struct lex_prefetch *prefetch,
+                                  struct lex_prefetch_file *file) {
+  char path[PATH_MAX];
+  const char *found =
+      compile_include_search(file->name, file->angle_brackets, file->dir,
+                             prefetch->flags, prefetch->include_dirs, path);
+  return found == path ? strdup(path) : NULL;
+}
+
+// call with the lock held
+static struct lex_prefetch_file *
+lex_prefetch_find(struct lex_prefetch *prefetch, const char *path) {
+  for (int i = 0; i < vector_count(prefetch->files); i++) {
+    struct lex_prefetch_file *file =
+        *(struct lex_prefetch_file **)vector_at(prefetch->files, i);
+    if (S_EQ(file->path, path)) {
+      return file;
+    }
+  }
+
+  return NULL;
+}
+
+// call with the lock held
+static struct lex_prefetch_file *
+lex_prefetch_find_name(struct lex_prefetch *prefetch, const char *name,
+                       const char *dir, bool angle_brackets) {
+  for (int i = 0; i < vector_count(prefetch->files); i++) {
+    struct lex_prefetch_file *file =
+        *(struct lex_prefetch_file **)vector_at(prefetch->files, i);
+    if (S_EQ(file->name, name) && S_EQ(file->dir, dir) &&
+        file->angle_brackets == angle_brackets) {
+      return file;
+    }
+  }
+
+  return NULL;
+}
+
+// only the name is looked at here, the thread that picks it up resolves it
+static void lex_prefetch_queue(struct lex_prefetch *prefetch, const char *name,
+                               const char *dir, bool angle_brackets) {
+  pthread_mutex_lock(&prefetch->lock);
+  if (lex_prefetch_find_name(prefetch, name, dir, angle_brackets)) {
+    pthread_mutex_unlock(&prefetch->lock);
+    return;
+  }
+
+  struct lex_prefetch_file *file = calloc(1, sizeof(struct lex_prefetch_file));
+  file->name = strdup(name);
+  file->dir = strdup(dir);
+  file->angle_brackets = angle_brackets;
+  file->state = LEX_PREFETCH_QUEUED;
+  vector_push(prefetch->files, &file);
+  pthread_cond_broadcast(&prefetch->cond);
+  pthread_mutex_unlock(&prefetch->lock);
+}
+
+// queues the file of every # include "file" among tokens [start, end) of the
+// file at path
+static void lex_prefetch_scan_tokens(struct lex_prefetch *prefetch,
+                                     const char *path,
+                                     struct vector *token_vec, int start,
+                                     int end) {
+  char dir[PATH_MAX];
+  compile_include_dir_of_path(path, dir);
+  for (int i = start < 2 ? 2 : start; i < end; i++) {
+    struct token *token = vector_at(token_vec, i);
+    if (token->type == TOKEN_TYPE_STRING &&
+        token_is_keyword(vector_at(token_vec, i - 1), "include") &&
+        token_is_symbol(vector_at(token_vec, i - 2), '#')) {
+      lex_prefetch_queue(prefetch, token->sval, dir,
+                         token->flags & TOKEN_FLAG_ANGLE_INCLUDE);
+    }
+  }
+}
+
+static void lex_prefetch_free_compiler(struct compile_process *compiler) {
+  intern_table_free(compiler->strings);
+  free(compiler);
+}
+
+/**
+ * Reads and lexes the whole file. The lexer reports an error by exiting, on
+ * this thread it jumps back here instead and the file is left to the
+ * preprocessor which lexes it again and reports the error if the include is
+ * reached at all. The allocations of the lexer are abandoned with it. A file
+ * with a literal that runs past its line is left to the preprocessor too, its
+ * inactive regions may not lex the way the preprocessor skips them.
+ */
+static bool lex_prefetch_lex(struct lex_prefetch *prefetch,
+                             struct lex_prefetch_file *file) {
+  FILE *in = fopen(file->path, "r");
+  if (!in) {
+    return false;
+  }
+
+  size_t size = 0;
+  char *data = compile_process_read_file(in, &size);
+  fclose(in);
+  if (!data) {
+    return false;
+  }
+
+  struct compile_process *compiler = calloc(1, sizeof(struct compile_process));
+  compiler->flags = prefetch->flags;
+  compiler->cfile.data = data;
+  compiler->cfile.size = size;
+  compiler->cfile.abs_path = file->path;
+  compiler->strings = intern_table_create();
+
+  jmp_buf error_jmp;
+  if (setjmp(error_jmp)) {
+    compiler_error_jmp = NULL;
+    free(data);
+    lex_prefetch_free_compiler(compiler);
+    return false;
+  }
+
+  compiler_error_jmp = &error_jmp;
+  struct lex_process *lex_process =
+      lex_process_create(compiler, &lex_prefetch_functions, NULL);
+  lex(lex_process);
+  compiler_error_jmp = NULL;
+  if (lex_process->literal_past_line) {
+    free(data);
+    lex_prefetch_free_compiler(compiler);
+    lex_process_free(lex_process);
+    return false;
+  }
+
+  file->compiler = compiler;
+  file->lex_process = lex_process;
+
+  // the files this one includes are likely needed next
+  struct vector *token_vec = lex_process_tokens(lex_process);
+  lex_prefetch_scan_tokens(prefetch, file->path, token_vec, 0,
+                           vector_count(token_vec));
+  return true;
+}
+
+static void *lex_prefetch_thread(void *ptr) {
+  struct lex_prefetch *prefetch = ptr;
+  pthread_mutex_lock(&prefetch->lock);
+  while (true) {
+    while (!prefetch->stopping &&
+           prefetch->next_file >= vector_count(prefetch->files)) {
+      pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+    }
+
+    if (prefetch->stopping) {
+      break;
+    }
+
+    struct lex_prefetch_file *file = *(struct lex_prefetch_file **)vector_at(
+        prefetch->files, prefetch->next_file++);
+    if (file->state != LEX_PREFETCH_QUEUED) {
+      continue;
+    }
+
+    file->state = LEX_PREFETCH_LEXING;
+    pthread_mutex_unlock(&prefetch->lock);
+    char *path = lex_prefetch_resolve(prefetch, file);
+    pthread_mutex_lock(&prefetch->lock);
+    // every file is lexed ahead at most once, whatever name it was found by
+    if (!path || lex_prefetch_find(prefetch, path)) {
+      free(path);
+      file->state = LEX_PREFETCH_FAILED;
+      continue;
+    }
+
+    file->path = path;
+    pthread_mutex_unlock(&prefetch->lock);
+    bool lexed = lex_prefetch_lex(prefetch, file);
+    pthread_mutex_lock(&prefetch->lock);
+    file->state = lexed ? LEX_PREFETCH_LEXED : LEX_PREFETCH_FAILED;
+    pthread_cond_broadcast(&prefetch->cond);
+  }
+
+  pthread_mutex_unlock(&prefetch->lock);
+  return NULL;
+}
+
+static int lex_prefetch_max_threads() {
+  // the preprocessor keeps one cpu busy on its own
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+  if (cpus < 1) {
+    return 1;
+  }
+
+  return cpus > LEX_PREFETCH_MAX_THREADS ? LEX_PREFETCH_MAX_THREADS : cpus;
+}
+
+struct lex_prefetch *lex_prefetch_create(struct compile_process *compiler) {
+  struct lex_prefetch *prefetch = calloc(1, sizeof(struct lex_prefetch));
+  prefetch->flags = compiler->flags;
+  prefetch->include_dirs = compiler->include_dirs;
+  prefetch->files = vector_create(sizeof(struct lex_prefetch_file *));
+  pthread_mutex_init(&prefetch->lock, NULL);
+  pthread_cond_init(&prefetch->cond, NULL);
+
+  int max_threads = lex_prefetch_max_threads();
+  for (int i = 0; i < max_threads; i++) {
+    if (pthread_create(&prefetch->threads[i], NULL, lex_prefetch_thread,
+                       prefetch) != 0) {
+      break;
+    }
+    prefetch->total_threads++;
+  }
+
+  return prefetch;
+}
+
+void lex_prefetch_free(struct lex_prefetch *prefetch) {
+  pthread_mutex_lock(&prefetch->lock);
+  prefetch->stopping = true;
+  pthread_cond_broadcast(&prefetch->cond);
+  pthread_mutex_unlock(&prefetch->lock);
+  for (int i = 0; i < prefetch->total_threads; i++) {
+    pthread_join(prefetch->threads[i], NULL);
+  }
+
+  // files lexed for includes the preprocessor never reached
+  for (int i = 0; i < vector_count(prefetch->files); i++) {
+    struct lex_prefetch_file *file =
+        *(struct lex_prefetch_file **)vector_at(prefetch->files, i);
+    if (file->state == LEX_PREFETCH_LEXED) {
+      free(file->compiler->cfile.data);
+      lex_prefetch_free_compiler(file->compiler);
+      lex_process_free(file->lex_process);
+    }
+
+    // a taken file's path names the positions of its tokens
+    if (file->state != LEX_PREFETCH_TAKEN) {
+      free((char *)file->path);
+    }
+    free(file->name);
+    free(file->dir);
+    free(file);
+  }
+
+  vector_free(prefetch->files);
+  pthread_mutex_destroy(&prefetch->lock);
+  pthread_cond_destroy(&prefetch->cond);
+  free(prefetch);
+}
+
+void lex_prefetch_scan(struct compile_process *compiler) {
+  if (!compiler->lex_prefetch) {
+    return;
+  }
+
+  int total = vector_count(compiler->token_vec_original);
+  lex_prefetch_scan_tokens(compiler->lex_prefetch, compiler->cfile.abs_path,
+                           compiler->token_vec_original,
+                           compiler->lex_prefetch_index, total);
+  compiler->lex_prefetch_index = total;
+}
+
+struct compile_process *
+lex_prefetch_take(const char *path, struct compile_process *parent_process) {
+  struct lex_prefetch *prefetch = parent_process->lex_prefetch;
+  if (!prefetch) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&prefetch->lock);
+  struct lex_prefetch_file *file = lex_prefetch_find(prefetch, path);
+  if (!file || file->state == LEX_PREFETCH_TAKEN) {
+    pthread_mutex_unlock(&prefetch->lock);
+    return NULL;
+  }
+
+  // a file still being lexed is nearly done, one no thread has picked up yet
+  // cannot be found by its path and is lexed by the caller
+  while (file->state == LEX_PREFETCH_LEXING) {
+    pthread_cond_wait(&prefetch->cond, &prefetch->lock);
+  }
+
+  int state = file->state;
+  file->state = LEX_PREFETCH_TAKEN;
+  pthread_mutex_unlock(&prefetch->lock);
+  if (state != LEX_PREFETCH_LEXED) {
+    return NULL;
+  }
+
+  struct compile_process *compiler = file->compiler;
+  struct compile_process *new_process = compile_process_create_lexed(
+      file->path, compiler->cfile.data, compiler->cfile.size,
+      parent_process->flags, parent_process);
+  new_process->pos = compiler->pos;
+
+  // the tokens were interned on the thread, move them into the shared table
+  struct vector *token_vec = lex_process_tokens(file->lex_process);
+  for (int i = 0; i < vector_count(token_vec); i++) {
+    struct token *token = vector_at(token_vec, i);
+    if (token_type_has_text(token->type)) {
+      token->sval = intern_table_add(new_process->strings, token->sval);
+    }
+  }
+
+  new_process->token_vec_original = token_vec;
+  // the thread already queued what this file includes
+  new_process->lex_prefetch_index = vector_count(token_vec);
+  lex_prefetch_free_compiler(compiler);
+  file->compiler = NULL;
+  return new_process;
+}
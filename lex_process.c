@@ -1,4 +1,5 @@
 #include "compiler.h"
+#include "helpers/buffer.h"
 #include "helpers/vector.h"
 #include <stdlib.h>
 
@@ -8,7 +9,9 @@ struct lex_process *lex_process_create(struct compile_process *compiler,
   struct lex_process *process = calloc(1, sizeof(struct lex_process));
   process->function = functions;
   process->token_vec = vector_create(sizeof(struct token));
+  process->scratch = buffer_create();
   process->compiler = compiler;
+  process->strings = compiler->strings;
   process->private = private;
   process->pos.line = 1;
   process->pos.col = 1;
@@ -17,6 +20,7 @@ struct lex_process *lex_process_create(struct compile_process *compiler,
 
 void lex_process_free(struct lex_process *process) {
   vector_free(process->token_vec);
+  buffer_free(process->scratch);
   free(process);
 }
 
@@ -0,0 +1,314 @@
+#include "compiler.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEX_SCAN_X86
+#endif
+
+/**
+ * Scanners used by the lexer fast paths. Each one returns how many bytes from
+ * ptr belong to the run, every run stops at the null terminator of the source.
+ * Runs that accept any character also stop at EOF so the slow path still sees
+ * it the way next_char reports it.
+ *
+ * The vector versions only do aligned loads, an aligned load never crosses a
+ * page boundary so reading past the terminator is safe. Bytes before ptr in
+ * the first block are masked off.
+ */
+
+struct lex_scan_functions {
+  size_t (*whitespace)(const char *ptr);
+  size_t (*identifier)(const char *ptr);
+  size_t (*until_char)(const char *ptr, char c);
+  size_t (*string)(const char *ptr, char end_delim);
+};
+
+static bool lex_scan_is_identifier_char(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+static size_t lex_scan_whitespace_scalar(const char *ptr) {
+  const char *start = ptr;
+  while (*ptr == ' ' || *ptr == '\t') {
+    ptr++;
+  }
+
+  return ptr - start;
+}
+
+static size_t lex_scan_identifier_scalar(const char *ptr) {
+  const char *start = ptr;
+  while (lex_scan_is_identifier_char(*ptr)) {
+    ptr++;
+  }
+
+  return ptr - start;
+}
+
+static size_t lex_scan_until_char_scalar(const char *ptr, char c) {
+  const char *start = ptr;
+  while (*ptr && *ptr != c && *ptr != EOF) {
+    ptr++;
+  }
+
+  return ptr - start;
+}
+
+static size_t lex_scan_string_scalar(const char *ptr, char end_delim) {
+  const char *start = ptr;
+  while (*ptr && *ptr != end_delim && *ptr != '\\' && *ptr != EOF) {
+    ptr++;
+  }
+
+  return ptr - start;
+}
+
+#ifdef LEX_SCAN_X86
+
+// stop mask helpers return a bit for every byte that ends the run
+
+static inline unsigned lex_scan_sse2_identifier_stops(__m128i v) {
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                                _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+  __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)),
+                                _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+  __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+  __m128i ident = _mm_or_si128(_mm_or_si128(alpha, digit), underscore);
+  return ~_mm_movemask_epi8(ident) & 0xFFFF;
+}
+
+static inline unsigned lex_scan_sse2_whitespace_stops(__m128i v) {
+  __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+  return ~_mm_movemask_epi8(ws) & 0xFFFF;
+}
+
+static inline unsigned lex_scan_sse2_char_stops(__m128i v, char c) {
+  __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)),
+                               _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+  stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8(EOF)));
+  return _mm_movemask_epi8(stops);
+}
+
+static inline unsigned lex_scan_sse2_string_stops(__m128i v, char end_delim) {
+  __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(end_delim)),
+                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+  stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+  stops = _mm_or_si128(stops, _mm_cmpeq_epi8(v, _mm_set1_epi8(EOF)));
+  return _mm_movemask_epi8(stops);
+}
+
+#define LEX_SCAN_SSE2_LOOP(stops_expr)                                         \
+  uintptr_t misalign = (uintptr_t)ptr & 15;                                    \
+  const char *block = ptr - misalign;                                          \
+  __m128i v = _mm_load_si128((const __m128i *)block);                          \
+  unsigned mask = (stops_expr) >> misalign;                                    \
+  if (mask) {                                                                  \
+    return __builtin_ctz(mask);                                                \
+  }                                                                            \
+  for (block += 16;; block += 16) {                                            \
+    v = _mm_load_si128((const __m128i *)block);                                \
+    mask = (stops_expr);                                                       \
+    if (mask) {                                                                \
+      return (block - ptr) + __builtin_ctz(mask);                              \
+    }                                                                          \
+  }
+
+static size_t lex_scan_whitespace_sse2(const char *ptr) {
+  LEX_SCAN_SSE2_LOOP(lex_scan_sse2_whitespace_stops(v));
+}
+
+static size_t lex_scan_identifier_sse2(const char *ptr) {
+  LEX_SCAN_SSE2_LOOP(lex_scan_sse2_identifier_stops(v));
+}
+
+static size_t lex_scan_until_char_sse2(const char *ptr, char c) {
+  LEX_SCAN_SSE2_LOOP(lex_scan_sse2_char_stops(v, c));
+}
+
+static size_t lex_scan_string_sse2(const char *ptr, char end_delim) {
+  LEX_SCAN_SSE2_LOOP(lex_scan_sse2_string_stops(v, end_delim));
+}
+
+#define LEX_SCAN_AVX2 __attribute__((target("avx2")))
+
+static inline LEX_SCAN_AVX2 unsigned
+lex_scan_avx2_identifier_stops(__m256i v) {
+  __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  __m256i alpha =
+      _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+  __m256i digit =
+      _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                       _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+  __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+  __m256i ident = _mm256_or_si256(_mm256_or_si256(alpha, digit), underscore);
+  return ~(unsigned)_mm256_movemask_epi8(ident);
+}
+
+static inline LEX_SCAN_AVX2 unsigned
+lex_scan_avx2_whitespace_stops(__m256i v) {
+  __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+  return ~(unsigned)_mm256_movemask_epi8(ws);
+}
+
+static inline LEX_SCAN_AVX2 unsigned lex_scan_avx2_char_stops(__m256i v,
+                                                              char c) {
+  __m256i stops =
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)),
+                      _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+  stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(EOF)));
+  return _mm256_movemask_epi8(stops);
+}
+
+static inline LEX_SCAN_AVX2 unsigned
+lex_scan_avx2_string_stops(__m256i v, char end_delim) {
+  __m256i stops =
+      _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(end_delim)),
+                      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+  stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+  stops = _mm256_or_si256(stops, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(EOF)));
+  return _mm256_movemask_epi8(stops);
+}
+
+#define LEX_SCAN_AVX2_LOOP(stops_expr)                                         \
+  uintptr_t misalign = (uintptr_t)ptr & 31;                                    \
+  const char *block = ptr - misalign;                                          \
+  __m256i v = _mm256_load_si256((const __m256i *)block);                       \
+  unsigned mask = (stops_expr) >> misalign;                                    \
+  if (mask) {                                                                  \
+    return __builtin_ctz(mask);                                                \
+  }                                                                            \
+  for (block += 32;; block += 32) {                                            \
+    v = _mm256_load_si256((const __m256i *)block);                             \
+    mask = (stops_expr);                                                       \
+    if (mask) {                                                                \
+      return (block - ptr) + __builtin_ctz(mask);                              \
+    }                                                                          \
+  }
+
+static LEX_SCAN_AVX2 size_t lex_scan_whitespace_avx2(const char *ptr) {
+  LEX_SCAN_AVX2_LOOP(lex_scan_avx2_whitespace_stops(v));
+}
+
+static LEX_SCAN_AVX2 size_t lex_scan_identifier_avx2(const char *ptr) {
+  LEX_SCAN_AVX2_LOOP(lex_scan_avx2_identifier_stops(v));
+}
+
+static LEX_SCAN_AVX2 size_t lex_scan_until_char_avx2(const char *ptr,
+                                                     char c) {
+  LEX_SCAN_AVX2_LOOP(lex_scan_avx2_char_stops(v, c));
+}
+
+static LEX_SCAN_AVX2 size_t lex_scan_string_avx2(const char *ptr,
+                                                 char end_delim) {
+  LEX_SCAN_AVX2_LOOP(lex_scan_avx2_string_stops(v, end_delim));
+}
+
+#endif
+
+static struct lex_scan_functions lex_scan_scalar = {
+    .whitespace = lex_scan_whitespace_scalar,
+    .identifier = lex_scan_identifier_scalar,
+    .until_char = lex_scan_until_char_scalar,
+    .string = lex_scan_string_scalar};
+
+#ifdef LEX_SCAN_X86
+static struct lex_scan_functions lex_scan_sse2 = {
+    .whitespace = lex_scan_whitespace_sse2,
+    .identifier = lex_scan_identifier_sse2,
+    .until_char = lex_scan_until_char_sse2,
+    .string = lex_scan_string_sse2};
+
+static struct lex_scan_functions lex_scan_avx2 = {
+    .whitespace = lex_scan_whitespace_avx2,
+    .identifier = lex_scan_identifier_avx2,
+    .until_char = lex_scan_until_char_avx2,
+    .string = lex_scan_string_avx2};
+#endif
+
+static struct lex_scan_functions *lex_scan_current = &lex_scan_scalar;
+static int lex_scan_current_level = LEX_SCAN_LEVEL_SCALAR;
+
+static int lex_scan_best_level() {
+#ifdef LEX_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return LEX_SCAN_LEVEL_AVX2;
+  }
+
+  if (__builtin_cpu_supports("sse2")) {
+    return LEX_SCAN_LEVEL_SSE2;
+  }
+#endif
+  return LEX_SCAN_LEVEL_SCALAR;
+}
+
+int lex_scan_select(int level) {
+  int best = lex_scan_best_level();
+  if (level < 0 || level > best) {
+    level = best;
+  }
+
+  lex_scan_current = &lex_scan_scalar;
+#ifdef LEX_SCAN_X86
+  if (level == LEX_SCAN_LEVEL_SSE2) {
+    lex_scan_current = &lex_scan_sse2;
+  } else if (level == LEX_SCAN_LEVEL_AVX2) {
+    lex_scan_current = &lex_scan_avx2;
+  }
+#endif
+
+  lex_scan_current_level = level;
+  return level;
+}
+
+// the scanners are picked before main runs, lexer threads only ever read them
+__attribute__((constructor)) static void lex_scan_init() {
+  lex_scan_select(LEX_SCAN_LEVEL_BEST);
+}
+
+int lex_scan_level() { return lex_scan_current_level; }
+
+const char *lex_scan_level_name(int level) {
+  switch (level) {
+  case LEX_SCAN_LEVEL_SCALAR:
+    return "scalar";
+  case LEX_SCAN_LEVEL_SSE2:
+    return "sse2";
+  case LEX_SCAN_LEVEL_AVX2:
+    return "avx2";
+  }
+
+  return "unknown";
+}
+
+size_t lex_scan_whitespace(const char *ptr) {
+  return lex_scan_current->whitespace(ptr);
+}
+
+size_t lex_scan_identifier(const char *ptr) {
+  return lex_scan_current->identifier(ptr);
+}
+
+size_t lex_scan_until_char(const char *ptr, char c) {
+  return lex_scan_current->until_char(ptr, c);
+}
+
+size_t lex_scan_string(const char *ptr, char end_delim) {
+  return lex_scan_current->string(ptr, end_delim);
+}
+
+void lex_scan_advance_pos(struct pos *pos, const char *ptr, size_t amount) {
+  for (size_t i = 0; i < amount; i++) {
+    pos->col += 1;
+    if (ptr[i] == '\n') {
+      pos->line += 1;
+      pos->col = 1;
+    }
+  }
+}
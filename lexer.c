@@ -1,5 +1,6 @@
 #include "compiler.h"
 #include "helpers/buffer.h"
+#include "helpers/intern.h"
 #include "helpers/vector.h"
 #include <assert.h>
 #include <ctype.h>
@@ -15,20 +16,16 @@ struct token *read_next_token();
 bool lex_is_in_expression();
 char lex_get_escaped_char(char c);
 
-static struct lex_process *lex_process;
-static struct token tmp_token;
+// thread local so chunks of one file can be lexed in parallel
+static __thread struct lex_process *lex_process;
+static __thread struct token tmp_token;
 
 static char peekc() { return lex_process->function->peek_char(lex_process); }
 
 static char nextc() {
   char c = lex_process->function->next_char(lex_process);
-
-  // write paranethesis to an expression buffer (.e.g (20 + 10))
-  if (lex_is_in_expression()) {
-    buffer_write(lex_process->parenthesis_buffer, c);
-    if (lex_process->arg_string_buffer) {
-      buffer_write(lex_process->arg_string_buffer, c);
-    }
+  if (c != EOF) {
+    lex_process->offset++;
   }
 
   lex_process->pos.col += 1;
@@ -40,7 +37,15 @@ static char nextc() {
   return c;
 }
 
-static void pushc(char c) { lex_process->function->push_char(lex_process, c); }
+static void pushc(char c) {
+  // only characters of the current line are ever pushed back. The column
+  // steps back with the offset, a token keeps the position just past it and
+  // lex_relex turns that position back into a source offset, so lookahead
+  // must not leave the column one ahead
+  lex_process->function->push_char(lex_process, c);
+  lex_process->offset--;
+  lex_process->pos.col--;
+}
 
 static char assert_next_char(char c) {
   char next_c = nextc();
@@ -50,15 +55,46 @@ static char assert_next_char(char c) {
 
 static struct pos lex_file_position() { return lex_process->pos; }
 
+// the fast paths scan straight from the source when the input can skip ahead
+static const char *lex_scan_ptr() {
+  if (!lex_process->source || !lex_process->function->skip_chars) {
+    return NULL;
+  }
+
+  return &lex_process->source[lex_process->offset];
+}
+
+// moves past amount characters starting at ptr, see lex_scan_ptr
+static void lex_skip(const char *ptr, size_t amount) {
+  if (!amount) {
+    return;
+  }
+
+  lex_process->function->skip_chars(lex_process, amount);
+  lex_process->offset += amount;
+  lex_scan_advance_pos(&lex_process->pos, ptr, amount);
+}
+
+// returns the lexer scratch buffer emptied for the next token text
+static struct buffer *lex_scratch() {
+  buffer_clear(lex_process->scratch);
+  return lex_process->scratch;
+}
+
+// copies the null terminated scratch text into the interned strings
+static const char *lex_intern(struct buffer *buffer) {
+  return intern_table_add(lex_process->strings, buffer_ptr(buffer));
+}
+
 struct token *token_create(struct token *_token) {
   memcpy(&tmp_token, _token, sizeof(struct token));
   tmp_token.pos = lex_file_position();
-  if (lex_is_in_expression()) {
-    assert(lex_process->parenthesis_buffer);
-    tmp_token.between_brackets = buffer_ptr(lex_process->parenthesis_buffer);
-    if (lex_process->arg_string_buffer) {
-      tmp_token.between_args = buffer_ptr(lex_process->arg_string_buffer);
-    }
+  if (lex_is_in_expression() && lex_process->source) {
+    // only the offsets are kept, the text is rebuilt from the source on demand
+    // .e.g (20 + 10)
+    tmp_token.source = lex_process->source;
+    tmp_token.between_brackets = lex_process->parenthesis_start;
+    tmp_token.between_args = lex_process->arg_string_start;
   }
   return &tmp_token;
 }
@@ -73,25 +109,33 @@ static struct token *handle_whitespace() {
     last_token->whitespace = true;
   }
 
-  nextc();
+  const char *ptr = lex_scan_ptr();
+  size_t len = ptr ? lex_scan_whitespace(ptr) : 0;
+  if (len) {
+    // skip the whole run rather than one character per call
+    lex_skip(ptr, len);
+  } else {
+    nextc();
+  }
   return read_next_token();
 }
 
-const char *read_number_str() {
-  const char *num = NULL;
-  struct buffer *buffer = buffer_create();
-  char c = peekc();
-  LEX_GETC_IF(buffer, c, (c >= '0' && c <= '9'));
+unsigned long long read_number_for_base(int base) {
+  unsigned long long number = 0;
+  for (char c = peekc(); c >= '0' && c <= '9'; c = peekc()) {
+    if (c - '0' >= base) {
+      compiler_error(lex_process->compiler, "Not valid binary number");
+    }
 
-  buffer_write(buffer, 0x00);
-  return buffer_ptr(buffer);
-}
+    number = number * base + (c - '0');
+    nextc();
+  }
 
-unsigned long long read_number() {
-  const char *s = read_number_str();
-  return atoll(s);
+  return number;
 }
 
+unsigned long long read_number() { return read_number_for_base(10); }
+
 int lexer_number_type(char c) {
   int res = NUMBER_TYPE_NORMAL;
   if (c == 'L') {
@@ -103,17 +147,26 @@ int lexer_number_type(char c) {
   return res;
 }
 
-struct token *token_make_number_for_value(unsigned long number) {
+// flags tell how the number was written so it can be spelled out again
+struct token *token_make_number_for_value(unsigned long number, int flags) {
+  char c = peekc();
+  if (c == 'U' || c == 'u') {
+    flags |= TOKEN_FLAG_UNSIGNED_NUMBER;
+    nextc();
+  }
+
   int number_type = lexer_number_type(peekc());
   if (number_type != NUMBER_TYPE_NORMAL) {
     nextc();
   }
-  return token_create(&(struct token){
-      .type = TOKEN_TYPE_NUMBER, .llnum = number, .num.type = number_type});
+  return token_create(&(struct token){.type = TOKEN_TYPE_NUMBER,
+                                      .flags = flags,
+                                      .llnum = number,
+                                      .num.type = number_type});
 }
 
 struct token *token_make_number() {
-  return token_make_number_for_value(read_number());
+  return token_make_number_for_value(read_number(), 0);
 }
 
 static void lex_handle_escape_number(struct buffer *buf) {
@@ -140,10 +193,29 @@ static void lex_handle_escape(struct buffer *buf) {
 }
 
 static struct token *token_make_string(char start_delim, char end_delim) {
-  struct buffer *buf = buffer_create();
+  struct buffer *buf = lex_scratch();
   assert(nextc() == start_delim);
-  char c = nextc();
-  for (; c != end_delim && c != EOF; c = nextc()) {
+  while (true) {
+    const char *ptr = lex_scan_ptr();
+    if (ptr) {
+      // copy up to the next delimiter or escape in one go
+      size_t len = lex_scan_string(ptr, end_delim);
+      if (memchr(ptr, '\n', len)) {
+        lex_process->literal_past_line = true;
+      }
+      buffer_write_bytes(buf, ptr, len);
+      lex_skip(ptr, len);
+    }
+
+    char c = nextc();
+    if (c == '\n' || c == EOF) {
+      lex_process->literal_past_line = true;
+    }
+
+    if (c == end_delim || c == EOF) {
+      break;
+    }
+
     if (c == '\\') {
       // handle escape character
       lex_handle_escape(buf);
@@ -155,7 +227,7 @@ static struct token *token_make_string(char start_delim, char end_delim) {
 
   buffer_write(buf, 0x00);
   return token_create(
-      &(struct token){.type = TOKEN_TYPE_STRING, .sval = buffer_ptr(buf)});
+      &(struct token){.type = TOKEN_TYPE_STRING, .sval = lex_intern(buf)});
 }
 
 static bool op_treated_as_one(char op) {
@@ -197,7 +269,7 @@ void read_op_flush_back_keep_first(struct buffer *buffer) {
 const char *read_op() {
   bool single_operator = true;
   char op = nextc();
-  struct buffer *buffer = buffer_create();
+  struct buffer *buffer = lex_scratch();
   buffer_write(buffer, op);
   if (op == '*' && peekc() == '=') {
     buffer_write(buffer, peekc());
@@ -227,19 +299,19 @@ const char *read_op() {
                    ptr);
   }
 
-  return ptr;
+  return lex_intern(buffer);
 }
 
 static void lex_new_expression() {
   lex_process->current_expression_count++;
   if (lex_process->current_expression_count == 1) {
-    lex_process->parenthesis_buffer = buffer_create();
+    lex_process->parenthesis_start = lex_process->offset;
   }
 
   struct token *last_token = lexer_last_token();
   if (last_token && (last_token->type == TOKEN_TYPE_IDENTIFIER ||
                      token_is_operator(last_token, ","))) {
-    lex_process->arg_string_buffer = buffer_create();
+    lex_process->arg_string_start = lex_process->offset;
   }
 }
 
@@ -283,7 +355,9 @@ static struct token *token_make_operator_or_string() {
   if (op == '<') {
     struct token *last_token = lexer_last_token();
     if (token_is_keyword(last_token, "include")) {
-      return token_make_string('<', '>');
+      struct token *token = token_make_string('<', '>');
+      token->flags |= TOKEN_FLAG_ANGLE_INCLUDE;
+      return token;
     }
   }
 
@@ -296,17 +370,32 @@ static struct token *token_make_operator_or_string() {
 }
 
 struct token *token_make_one_line_comment() {
-  struct buffer *buffer = buffer_create();
+  struct buffer *buffer = lex_scratch();
+  const char *ptr = lex_scan_ptr();
+  if (ptr) {
+    size_t len = lex_scan_until_char(ptr, '\n');
+    buffer_write_bytes(buffer, ptr, len);
+    lex_skip(ptr, len);
+  }
+
   char c = 0;
   LEX_GETC_IF(buffer, c, c != '\n' && c != EOF);
+  buffer_write(buffer, 0x00);
   return token_create(
-      &(struct token){.type = TOKEN_TYPE_COMMENT, .sval = buffer_ptr(buffer)});
+      &(struct token){.type = TOKEN_TYPE_COMMENT, .sval = lex_intern(buffer)});
 }
 
 struct token *token_make_multiline_comment() {
-  struct buffer *buffer = buffer_create();
+  struct buffer *buffer = lex_scratch();
   char c = 0;
   while (42) {
+    const char *ptr = lex_scan_ptr();
+    if (ptr) {
+      size_t len = lex_scan_until_char(ptr, '*');
+      buffer_write_bytes(buffer, ptr, len);
+      lex_skip(ptr, len);
+    }
+
     LEX_GETC_IF(buffer, c, c != '*' && c != EOF);
     if (c == EOF) {
       compiler_error(lex_process->compiler, "Multiline comment was not closed");
@@ -319,8 +408,9 @@ struct token *token_make_multiline_comment() {
       }
     }
   }
+  buffer_write(buffer, 0x00);
   return token_create(
-      &(struct token){.type = TOKEN_TYPE_COMMENT, .sval = buffer_ptr(buffer)});
+      &(struct token){.type = TOKEN_TYPE_COMMENT, .sval = lex_intern(buffer)});
 }
 
 struct token *handle_comment() {
@@ -356,7 +446,14 @@ static struct token *token_make_symbol() {
 }
 
 static struct token *token_make_identifier_or_keyword() {
-  struct buffer *buffer = buffer_create();
+  struct buffer *buffer = lex_scratch();
+  const char *ptr = lex_scan_ptr();
+  if (ptr) {
+    size_t len = lex_scan_identifier(ptr);
+    buffer_write_bytes(buffer, ptr, len);
+    lex_skip(ptr, len);
+  }
+
   char c = 0;
   LEX_GETC_IF(buffer, c,
               (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
@@ -368,11 +465,11 @@ static struct token *token_make_identifier_or_keyword() {
   // check if it is a keyword
   if (is_keyword(buffer_ptr(buffer))) {
     return token_create(&(struct token){.type = TOKEN_TYPE_KEYWORD,
-                                        .sval = buffer_ptr(buffer)});
+                                        .sval = lex_intern(buffer)});
   }
 
   return token_create(&(struct token){.type = TOKEN_TYPE_IDENTIFIER,
-                                      .sval = buffer_ptr(buffer)});
+                                      .sval = lex_intern(buffer)});
 }
 
 struct token *read_special_token() {
@@ -415,42 +512,30 @@ bool is_hex_char(char c) {
   return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
 }
 
-const char *read_hex_number_str() {
-  struct buffer *buffer = buffer_create();
-  char c = peekc();
-  LEX_GETC_IF(buffer, c, is_hex_char(c));
-  // write null terminator
-  buffer_write(buffer, 0x00);
-  return buffer_ptr(buffer);
+unsigned long read_hex_number() {
+  unsigned long number = 0;
+  for (char c = peekc(); is_hex_char(c); c = peekc()) {
+    c = tolower(c);
+    number = number * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+    nextc();
+  }
+
+  return number;
 }
 
 struct token *token_make_special_number_hexadecimal() {
   // skip the 'x'
   nextc();
 
-  unsigned long number = 0;
-  const char *number_str = read_hex_number_str();
-  number = strtol(number_str, 0, 16);
-  return token_make_number_for_value(number);
-}
-
-void lexer_validate_binary_string(const char *str) {
-  size_t len = strlen(str);
-  for (int i = 0; i < len; i++) {
-    if (str[i] != '0' && str[i] != '1') {
-      compiler_error(lex_process->compiler, "Not valid binary number");
-    }
-  }
+  return token_make_number_for_value(read_hex_number(),
+                                     TOKEN_FLAG_HEX_NUMBER);
 }
 
 struct token *token_make_special_number_binary() {
   nextc(); // skip 'b'
 
-  unsigned long number = 0;
-  const char *number_str = read_number_str();
-  lexer_validate_binary_string(number_str);
-  number = strtol(number_str, 0, 2);
-  return token_make_number_for_value(number);
+  return token_make_number_for_value(read_number_for_base(2),
+                                     TOKEN_FLAG_BINARY_NUMBER);
 }
 
 struct token *token_make_special_number() {
@@ -549,20 +634,124 @@ struct token *read_next_token() {
 }
 
 int lex(struct lex_process *process) {
-  process->current_expression_count = 0;
-  process->parenthesis_buffer = NULL;
-  process->arg_string_buffer = NULL;
+  // the offset and expression state start where the creator left them, zero
+  // unless lexing a chunk or re-lexing after an edit
+  process->source = NULL;
+  if (process->function->source) {
+    process->source = process->function->source(process);
+  }
   lex_process = process;
   process->pos.filename = process->compiler->cfile.abs_path;
 
   struct token *token = read_next_token();
   while (token) {
     vector_push(process->token_vec, token);
+    if (process->function->token_pushed &&
+        process->function->token_pushed(process)) {
+      break;
+    }
     token = read_next_token();
   }
   return LEXICAL_ANALYSIS_ALL_OK;
 }
 
+// returns the length of the directive name if ptr is at a # that begins one
+static size_t lex_directive_name(const char **ptr) {
+  const char *p = *ptr;
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+
+  if (*p != '#') {
+    return 0;
+  }
+
+  p++;
+  while (*p == ' ' || *p == '\t') {
+    p++;
+  }
+
+  *ptr = p;
+  while (isalnum((unsigned char)*p) || *p == '_') {
+    p++;
+  }
+
+  return p - *ptr;
+}
+
+static bool lex_directive_is(const char *name, size_t len, const char *str) {
+  return strlen(str) == len && strncmp(name, str, len) == 0;
+}
+
+// moves past a literal that starts at ptr, unterminated ones end at the line
+static const char *lex_skip_inactive_literal(const char *ptr) {
+  char delim = *ptr++;
+  while (*ptr && *ptr != delim && *ptr != '\n') {
+    if (*ptr == '\\' && ptr[1]) {
+      ptr++;
+    }
+    ptr++;
+  }
+
+  return *ptr == delim ? ptr + 1 : ptr;
+}
+
+void lex_skip_inactive(struct lex_process *process) {
+  lex_process = process;
+  const char *start = lex_scan_ptr();
+  assert(start);
+
+  const char *ptr = start;
+  const char *line = ptr;
+  int depth = 0;
+  bool line_start = true;
+  while (*ptr) {
+    if (line_start) {
+      line_start = false;
+      line = ptr;
+      const char *name = ptr;
+      size_t len = lex_directive_name(&name);
+      if (lex_directive_is(name, len, "if") ||
+          lex_directive_is(name, len, "ifdef") ||
+          lex_directive_is(name, len, "ifndef")) {
+        depth++;
+      } else if (lex_directive_is(name, len, "endif")) {
+        if (depth == 0) {
+          break;
+        }
+        depth--;
+      } else if (depth == 0 && (lex_directive_is(name, len, "else") ||
+                                lex_directive_is(name, len, "elif"))) {
+        break;
+      }
+    }
+
+    char c = *ptr;
+    if (c == '\n') {
+      line_start = true;
+      ptr++;
+    } else if (c == '/' && ptr[1] == '*') {
+      // a line that starts inside of a comment does not start a directive
+      const char *end = strstr(ptr + 2, "*/");
+      ptr = end ? end + 2 : ptr + strlen(ptr);
+    } else if (c == '/' && ptr[1] == '/') {
+      ptr += lex_scan_until_char(ptr, '\n');
+    } else if (c == '"' || c == '\'') {
+      ptr = lex_skip_inactive_literal(ptr);
+    } else if (c == '\\' && ptr[1] == '\n') {
+      ptr += 2;
+    } else {
+      ptr++;
+    }
+  }
+
+  if (!*ptr) {
+    line = ptr;
+  }
+
+  lex_skip(start, line - start);
+}
+
 char lexer_string_buffer_next_char(struct lex_process *process) {
   struct buffer *buf = lex_process_private(process);
   return buffer_read(buf);
@@ -575,13 +764,29 @@ char lexer_string_buffer_peek_char(struct lex_process *process) {
 
 void lexer_string_buffer_push_char(struct lex_process *process, char c) {
   struct buffer *buf = lex_process_private(process);
-  buffer_write(buf, c);
+  // step back over the character, writing would move the source
+  assert(buf->rindex > 0 && buf->data[buf->rindex - 1] == c);
+  buf->rindex--;
+}
+
+const char *lexer_string_buffer_source(struct lex_process *process) {
+  struct buffer *buf = lex_process_private(process);
+  return buffer_ptr(buf);
+}
+
+void lexer_string_buffer_skip_chars(struct lex_process *process,
+                                    size_t amount) {
+  struct buffer *buf = lex_process_private(process);
+  assert(buf->rindex + amount <= buf->len);
+  buf->rindex += amount;
 }
 
 struct lex_process_functions lexer_string_buffer_functions = {
     .next_char = lexer_string_buffer_next_char,
     .peek_char = lexer_string_buffer_peek_char,
-    .push_char = lexer_string_buffer_push_char};
+    .push_char = lexer_string_buffer_push_char,
+    .source = lexer_string_buffer_source,
+    .skip_chars = lexer_string_buffer_skip_chars};
 
 struct lex_process *tokens_build_for_string(struct compile_process *compiler,
                                             const char *str) {
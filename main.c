@@ -1,29 +1,119 @@
 #include "compiler.h"
 #include "helpers/vector.h"
 #include <stdio.h>
+#include <stdlib.h>
 
 int main(int argc, char **argv) {
   const char *input_file = "./test.c";
   const char *output_file = "./test";
   const char *option = "exec";
-  if (argc > 1) {
-    input_file = argv[1];
-  }
+  const char *pch_file = NULL;
+  bool pch_create = false;
+  bool preprocess_only = false;
+  int compile_flags = COMPILE_PROCESS_EXEC_NASM;
 
-  if (argc > 2) {
-    output_file = argv[2];
-  }
+  // flags starting with "--" may appear anywhere, the rest are positional
+  int positional = 0;
+  for (int i = 1; i < argc; i++) {
+    if (S_EQ(argv[i], "--parallel-lex")) {
+      compile_flags |= COMPILE_PROCESS_PARALLEL_LEX;
+      continue;
+    }
+
+    // --lex-chunks 8 lexes in that many chunks whatever the file size
+    if (S_EQ(argv[i], "--lex-chunks") && i + 1 < argc) {
+      compile_flags |= COMPILE_PROCESS_PARALLEL_LEX;
+      lex_parallel_set_chunks(atoi(argv[++i]));
+      continue;
+    }
+
+    if (S_EQ(argv[i], "--token-cache")) {
+      compile_flags |= COMPILE_PROCESS_TOKEN_CACHE;
+      continue;
+    }
+
+    // reports the macros and included files producing the most tokens
+    if (S_EQ(argv[i], "--macro-report")) {
+      compile_flags |= COMPILE_PROCESS_MACRO_REPORT;
+      continue;
+    }
+
+    // reports the number of nodes parsed and the memory they take
+    if (S_EQ(argv[i], "--node-report")) {
+      compile_flags |= COMPILE_PROCESS_NODE_REPORT;
+      continue;
+    }
+
+    // function bodies are only parsed when the validator or code generator
+    // gets to them
+    if (S_EQ(argv[i], "--lazy-bodies")) {
+      compile_flags |= COMPILE_PROCESS_LAZY_FUNCTION_BODIES;
+      continue;
+    }
+
+    // lexes included files on worker threads ahead of the preprocessor
+    if (S_EQ(argv[i], "--prefetch-includes")) {
+      compile_flags |= COMPILE_PROCESS_PREFETCH_INCLUDES;
+      continue;
+    }
 
-  if (argc > 3) {
-    option = argv[3];
+    // reads the headers built into the compiler from rc_includes
+    if (S_EQ(argv[i], "--disk-includes")) {
+      compile_flags |= COMPILE_PROCESS_DISK_INCLUDES;
+      continue;
+    }
+
+    // --pch-create prefix.h prefix.pch
+    if (S_EQ(argv[i], "--pch-create")) {
+      pch_create = true;
+      continue;
+    }
+
+    // writes the preprocessed file to the output file or stdout
+    if (S_EQ(argv[i], "-E")) {
+      preprocess_only = true;
+      continue;
+    }
+
+    if (S_EQ(argv[i], "--pch-use") && i + 1 < argc) {
+      pch_file = argv[++i];
+      continue;
+    }
+
+    if (positional == 0) {
+      input_file = argv[i];
+    } else if (positional == 1) {
+      output_file = argv[i];
+    } else if (positional == 2) {
+      option = argv[i];
+    }
+    positional++;
   }
 
-  int compile_flags = COMPILE_PROCESS_EXEC_NASM;
   if (S_EQ(option, "object")) {
     compile_flags |= COMPILE_PROCESS_EXPORT_AS_OBJECT;
   }
 
-  int res = compile_file(input_file, output_file, compile_flags);
+  if (pch_create) {
+    int res = compile_pch_create(input_file, output_file, compile_flags);
+    if (res != COMPILER_FILE_COMPILED_OK) {
+      printf("precompiled header failed\n");
+      return -1;
+    }
+
+    printf("precompiled header created\n");
+    return 0;
+  }
+
+  if (preprocess_only) {
+    int res = compile_preprocess_file(
+        input_file, positional > 1 ? output_file : NULL, pch_file,
+        compile_flags);
+    return res == COMPILER_FILE_COMPILED_OK ? 0 : -1;
+  }
+
+  int res =
+      compile_file_with_pch(input_file, output_file, pch_file, compile_flags);
   if (res == COMPILER_FILE_COMPILED_OK) {
     printf("compiled successfuly\n");
   } else if (res == COMPILER_FAILED_WITH_ERRORS) {
@@ -1,9 +1,12 @@
 #include "compiler.h"
+#include "helpers/arena.h"
 #include "helpers/vector.h"
 #include <assert.h>
 
 struct vector *node_vector = NULL;
 struct vector *node_vector_root = NULL;
+struct arena *node_arena = NULL;
+struct arena *node_data_arena = NULL;
 
 struct node *parser_current_body = NULL;
 struct node *parser_current_function = NULL;
@@ -13,6 +16,11 @@ void node_set_vector(struct vector *vec, struct vector *root_vec) {
   node_vector_root = root_vec;
 }
 
+void node_set_arenas(struct arena *arena, struct arena *data_arena) {
+  node_arena = arena;
+  node_data_arena = data_arena;
+}
+
 void node_push(struct node *node) { vector_push(node_vector, &node); }
 
 struct node *node_peek_or_null() {
@@ -40,7 +48,8 @@ bool node_is_expressionable(struct node *node) {
   return node->type == NODE_TYPE_EXPRESSION ||
          node->type == NODE_TYPE_EXPRESSION_PARENTHESIS ||
          node->type == NODE_TYPE_UNARY || node->type == NODE_TYPE_IDENTIFIER ||
-         node->type == NODE_TYPE_NUMBER || node->type == NODE_TYPE_STRING;
+         node->type == NODE_TYPE_NUMBER || node->type == NODE_TYPE_STRING ||
+         node->type == NODE_TYPE_CAST;
 }
 
 struct node *node_peek_expressionable_or_null() {
@@ -152,12 +161,20 @@ void make_tenary_node(struct node *true_node, struct node *false_node) {
 }
 
 void make_cast_node(struct datatype *dtype, struct node *exp_node) {
-  node_create(&(struct node){
-      .type = NODE_TYPE_CAST, .cast.dtype = *dtype, .cast.exp = exp_node});
+  node_create(&(struct node){.type = NODE_TYPE_CAST,
+                             .cast.dtype = node_datatype_create(dtype),
+                             .cast.exp = exp_node});
+}
+
+struct datatype *node_datatype_create(struct datatype *dtype) {
+  struct datatype *copy =
+      arena_alloc(node_data_arena, sizeof(struct datatype));
+  memcpy(copy, dtype, sizeof(struct datatype));
+  return copy;
 }
 
 struct node *node_create(struct node *_node) {
-  struct node *node = malloc(sizeof(struct node));
+  struct node *node = arena_alloc(node_arena, sizeof(struct node));
   memcpy(node, _node, sizeof(struct node));
   node->binded.owner = parser_current_body;
   node->binded.function = parser_current_function;
@@ -204,15 +221,16 @@ void make_union_node(const char *name, struct node *body_node) {
 
 void make_function_node(struct datatype *rtype, const char *name,
                         struct vector *args, struct node *body) {
-  struct node *func_node =
-      node_create(&(struct node){.type = NODE_TYPE_FUNCTION,
-                                 .func.rtype = *rtype,
-                                 .func.name = name,
-                                 .func.args.args = args,
-                                 .func.body_n = body,
-                                 .func.args.stack_addition = DATA_SIZE_QWORD});
-  func_node->func.stack_frame.elements =
+  struct function *func =
+      arena_alloc(node_data_arena, sizeof(struct function));
+  *func = (struct function){.rtype = *rtype,
+                            .name = name,
+                            .args.args = args,
+                            .body_n = body,
+                            .args.stack_addition = DATA_SIZE_QWORD};
+  func->stack_frame.elements =
       vector_create(sizeof(struct stack_frame_element));
+  node_create(&(struct node){.type = NODE_TYPE_FUNCTION, .func = func});
 }
 
 struct node *node_from_sym(struct symbol *sym) {
@@ -270,7 +288,7 @@ bool node_is_struct_or_union_variable(struct node *node) {
     return false;
   }
 
-  return datatype_is_struct_or_union(&node->var.type);
+  return datatype_is_struct_or_union(node->var.type);
 }
 
 struct node *variable_node(struct node *node) {
@@ -294,7 +312,7 @@ struct node *variable_node(struct node *node) {
 
 bool variable_node_is_primitive(struct node *node) {
   assert(node->type == NODE_TYPE_VARIABLE);
-  return datatype_is_primitive(&node->var.type);
+  return datatype_is_primitive(node->var.type);
 }
 
 struct node *variable_node_or_list(struct node *node) {
@@ -307,21 +325,32 @@ struct node *variable_node_or_list(struct node *node) {
 
 size_t function_node_argument_stack_addition(struct node *node) {
   assert(node->type == NODE_TYPE_FUNCTION);
-  return node->func.args.stack_addition;
+  return node->func->args.stack_addition;
+}
+
+struct node *function_node_body(struct node *node) {
+  assert(node->type == NODE_TYPE_FUNCTION);
+  if (node->func->lazy_body.pending) {
+    parse_function_lazy_body(node);
+  }
+
+  return node->func->body_n;
 }
 
 size_t function_node_stack_size(struct node *node) {
   assert(node->type == NODE_TYPE_FUNCTION);
-  return node->func.stack_size;
+  // the stack size is only known once the body is parsed
+  function_node_body(node);
+  return node->func->stack_size;
 }
 
 struct vector *function_node_argument_vec(struct node *node) {
   assert(node->type == NODE_TYPE_FUNCTION);
-  return node->func.args.args;
+  return node->func->args.args;
 }
 
 bool function_node_is_prototype(struct node *node) {
-  return node->func.body_n == NULL;
+  return node->func->body_n == NULL && !node->func->lazy_body.pending;
 }
 
 bool node_is_expression_or_parentheses(struct node *node) {
@@ -356,3 +385,16 @@ bool is_node_assignment(struct node *node) {
 bool node_valid(struct node *node) {
   return node && node->type != NODE_TYPE_BLANK;
 }
+
+void node_report(struct compile_process *process, FILE *file) {
+  size_t nodes = arena_count(process->node_arena);
+  fprintf(file, "node report for %s:\n", process->cfile.abs_path);
+  fprintf(file, "%12zu nodes of %zu bytes, %zu bytes\n", nodes,
+          sizeof(struct node), arena_bytes(process->node_arena));
+  fprintf(file, "%12zu datatypes and functions out of line, %zu bytes\n",
+          arena_count(process->node_data_arena),
+          arena_bytes(process->node_data_arena));
+  fprintf(file, "%12zu bytes reserved in blocks\n",
+          arena_reserved_bytes(process->node_arena) +
+              arena_reserved_bytes(process->node_data_arena));
+}
@@ -1,15 +1,15 @@
 #include "compiler.h"
+#include "helpers/arena.h"
 #include "helpers/vector.h"
 #include <assert.h>
 
 static struct compile_process *current_process;
 static struct fixup_system *parser_fixup_sys;
 static struct token *parser_last_token;
+static struct token_cursor parser_token_cursor;
 
 extern struct node *parser_current_body;
 extern struct node *parser_current_function;
-extern struct expressionable_op_precedence_group
-    op_precedence[TOTAL_OPERATOR_GROUPS];
 
 // a blank node (.ie NODE_TYPE_BLANK)
 struct node *parser_blank_node;
@@ -53,6 +53,7 @@ enum {
   HISTORY_FLAG_INSIDE_FUNCTION_BODY = 0b00010000,
   HISTORY_FLAG_IN_SWITCH_STATEMENT = 0b00100000,
   HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL = 0b01000000,
+  HISTORY_FLAG_IS_TYPEDEF = 0b10000000,
 };
 
 struct history_cases {
@@ -65,19 +66,28 @@ struct history_cases {
 
 struct history {
   int flags;
+  // operators this limit ends the expression at are left for the caller, see
+  // expressionable_right_operand_limit()
+  int precedence_limit;
   struct parser_history_switch {
     struct history_cases *case_data;
   } _switch;
 };
 
+// history frames only live until the top level node they were made for is
+// done, the arena is reset before the next one
+static struct arena *parser_history_arena = NULL;
+
 static struct history *history_begin(int flags) {
-  struct history *history = calloc(1, sizeof(struct history));
+  struct history *history =
+      arena_alloc(parser_history_arena, sizeof(struct history));
   history->flags = flags;
   return history;
 }
 
 static struct history *history_down(struct history *history, int flags) {
-  struct history *new_history = calloc(1, sizeof(struct history));
+  struct history *new_history =
+      arena_alloc(parser_history_arena, sizeof(struct history));
   memcpy(new_history, history, sizeof(struct history));
   new_history->flags = flags;
   return new_history;
@@ -114,7 +124,7 @@ void parse_tenary(struct history *history);
 void parse_datatype(struct datatype *dtype);
 void parse_for_cast();
 void parse_for_parentheses(struct history *history);
-void parser_deal_with_additional_expression();
+void parser_deal_with_additional_expression(struct history *history);
 int parser_get_pointer_depth();
 
 void parser_scope_new() { scope_new(current_process, 0); }
@@ -132,20 +142,19 @@ void parser_scope_push(struct parser_scope_entity *entity, size_t size) {
 static void parser_ignore_nl_or_comment(struct token *token) {
   while (token && token_is_nl_or_comment_or_newline_separator(token)) {
     // Skip the token
-    vector_peek(current_process->token_vec);
-    token = vector_peek_no_increment(current_process->token_vec);
+    token_cursor_next(&parser_token_cursor);
+    token = token_cursor_peek(&parser_token_cursor);
   }
 }
 
 static struct token *token_next() {
-  struct token *next_token =
-      vector_peek_no_increment(current_process->token_vec);
+  struct token *next_token = token_cursor_peek(&parser_token_cursor);
   parser_ignore_nl_or_comment(next_token);
   if (next_token) {
     current_process->pos = next_token->pos;
   }
   parser_last_token = next_token;
-  return vector_peek(current_process->token_vec);
+  return token_cursor_next(&parser_token_cursor);
 }
 
 static void expect_sym(char c) {
@@ -173,10 +182,9 @@ static void expect_keyword(const char *keyword) {
 }
 
 static struct token *token_peek_next() {
-  struct token *next_token =
-      vector_peek_no_increment(current_process->token_vec);
+  struct token *next_token = token_cursor_peek(&parser_token_cursor);
   parser_ignore_nl_or_comment(next_token);
-  return vector_peek_no_increment(current_process->token_vec);
+  return token_cursor_peek(&parser_token_cursor);
 }
 
 static bool token_next_is_operator(const char *op) {
@@ -194,6 +202,18 @@ static bool token_next_is_symbol(char c) {
   return token_is_symbol(token, c);
 }
 
+// typedef names start a declaration just like the datatype keywords do
+static bool token_is_typedef_name(struct token *token) {
+  return token && token->type == TOKEN_TYPE_IDENTIFIER &&
+         typedef_table_get(current_process->typedefs, token->sval);
+}
+
+// keywords and typedef names, the tokens parse_keyword() is called for
+static bool token_is_keyword_or_typedef_name(struct token *token) {
+  return token && (token->type == TOKEN_TYPE_KEYWORD ||
+                   token_is_typedef_name(token));
+}
+
 void parse_single_token_to_node() {
   struct token *token = token_next();
   struct node *node = NULL;
@@ -221,103 +241,6 @@ void parse_expressionable_for_op(struct history *history, const char *op) {
   parse_expressionable(history);
 }
 
-static int parser_get_precedence_for_operator(
-    const char *op, struct expressionable_op_precedence_group **group_out) {
-  *group_out = NULL;
-  for (int i = 0; i < TOTAL_OPERATOR_GROUPS; i++) {
-    for (int b = 0; op_precedence[i].operators[b]; b++) {
-      const char *_op = op_precedence[i].operators[b];
-      if (S_EQ(op, _op)) {
-        *group_out = &op_precedence[i];
-        return i;
-      }
-    }
-  }
-
-  return -1;
-}
-
-static bool parser_left_op_has_priority(const char *op_left,
-                                        const char *op_right) {
-  struct expressionable_op_precedence_group *group_left = NULL;
-  struct expressionable_op_precedence_group *group_right = NULL;
-  if (S_EQ(op_left, op_right)) {
-    return false;
-  }
-
-  int precedence_left =
-      parser_get_precedence_for_operator(op_left, &group_left);
-  int precedence_right =
-      parser_get_precedence_for_operator(op_right, &group_right);
-  if (group_left->associativity == ASSOCIATIVITY_RIGHT_TO_LEFT) {
-    return false;
-  }
-
-  return precedence_left <= precedence_right;
-}
-
-void parser_node_shift_children_left(struct node *node) {
-  assert(node->type == NODE_TYPE_EXPRESSION);
-  assert(node->exp.right->type == NODE_TYPE_EXPRESSION);
-
-  const char *right_op = node->exp.right->exp.op;
-  struct node *new_exp_left_node = node->exp.left;
-  struct node *new_exp_right_node = node->exp.right->exp.left;
-  make_exp_node(new_exp_left_node, new_exp_right_node, node->exp.op);
-
-  struct node *new_left_operand = node_pop();
-  struct node *new_right_operand = node->exp.right->exp.right;
-  node->exp.left = new_left_operand;
-  node->exp.right = new_right_operand;
-  node->exp.op = right_op;
-}
-
-void parser_node_move_right_left_to_left(struct node *node) {
-  make_exp_node(node->exp.left, node->exp.right->exp.left, node->exp.op);
-  struct node *completed_node = node_pop();
-
-  // deal with right node
-  const char *new_op = node->exp.right->exp.op;
-  node->exp.left = completed_node;
-  node->exp.right = node->exp.right->exp.right;
-  node->exp.op = new_op;
-}
-
-void parser_reorder_expression(struct node **node_out) {
-  struct node *node = *node_out;
-  if (node->type != NODE_TYPE_EXPRESSION) {
-    return;
-  }
-
-  // no expression, nothing to do
-  if (node->exp.left->type != NODE_TYPE_EXPRESSION && node->exp.right &&
-      node->exp.right->type != NODE_TYPE_EXPRESSION) {
-    return;
-  }
-
-  // 50*(30+20)
-  // 50*EXPRESSION
-  // EXPRESSION(50*EXPRESSION(30+20))
-  if (node->exp.left->type != NODE_TYPE_EXPRESSION && node->exp.right &&
-      node->exp.right->type == NODE_TYPE_EXPRESSION) {
-    const char *right_op = node->exp.right->exp.op;
-    if (parser_left_op_has_priority(node->exp.op, right_op)) {
-      // 50*E(30+20)
-      // E(50*30)+20
-      parser_node_shift_children_left(node);
-      parser_reorder_expression(&node->exp.left);
-      parser_reorder_expression(&node->exp.right);
-    }
-  }
-
-  if ((is_array_node(node->exp.left) && is_node_assignment(node->exp.right)) ||
-      ((node_is_expression(node->exp.left, "()") ||
-        node_is_expression(node->exp.left, "[]")) &&
-       node_is_expression(node->exp.right, ","))) {
-    parser_node_move_right_left_to_left(node);
-  }
-}
-
 void parse_for_indirection_unary() {
   int depth = parser_get_pointer_depth();
   parse_expressionable(history_begin(EXPRESSION_IS_UNARY));
@@ -335,15 +258,16 @@ void parse_for_normal_unary() {
   make_unary_node(unary_op, unary_operand_node, 0);
 }
 
-void parse_for_unary() {
+void parse_for_unary(struct history *history) {
   const char *unary_op = token_peek_next()->sval;
   if (op_is_indirection(unary_op)) {
     parse_for_indirection_unary();
-    return;
+  } else {
+    parse_for_normal_unary();
   }
 
-  parse_for_normal_unary();
-  parser_deal_with_additional_expression();
+  // *a + 1
+  parser_deal_with_additional_expression(history);
 }
 
 bool parser_is_unary_operator(const char *op) { return is_unary_operator(op); }
@@ -364,7 +288,7 @@ void parse_exp_normal(struct history *history) {
                      op);
     }
 
-    parse_for_unary();
+    parse_for_unary(history);
     return;
   }
 
@@ -379,43 +303,52 @@ void parse_exp_normal(struct history *history) {
   }
 
   node_left->flags |= NODE_FLAG_INSIDE_EXPRESSION;
+
+  // the right operand ends at the first operator that binds no tighter than
+  // this one, the expression continues from there with this node as its left
+  struct history *right_history = history_down(history, history->flags);
+  right_history->precedence_limit = expressionable_right_operand_limit(op);
   if (token_peek_next()->type == TOKEN_TYPE_OPERATOR) {
     if (S_EQ(token_peek_next()->sval, "(")) {
       parse_for_parentheses(history_down(
-          history,
-          history->flags | HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL));
+          right_history, right_history->flags |
+                             HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL));
     } else if (parser_is_unary_operator(token_peek_next()->sval)) {
-      parse_for_unary();
+      parse_for_unary(right_history);
     } else {
       compiler_error(current_process,
                      "Expected expressionable for operator: %s", op);
     }
   } else {
-    parse_expressionable_for_op(history_down(history, history->flags), op);
+    parse_expressionable_for_op(right_history, op);
   }
 
   struct node *node_right = node_pop();
   node_right->flags |= NODE_FLAG_INSIDE_EXPRESSION;
 
   make_exp_node(node_left, node_right, op);
-  struct node *exp_node = node_pop();
-
-  // reorder the expression
-  parser_reorder_expression(&exp_node);
+}
 
-  node_push(exp_node);
+static bool parser_token_ends_expression(struct history *history,
+                                         struct token *token) {
+  return token && token->type == TOKEN_TYPE_OPERATOR &&
+         expressionable_op_ends_operand(token->sval,
+                                        history->precedence_limit);
 }
 
-void parser_deal_with_additional_expression() {
-  if (token_peek_next()->type == TOKEN_TYPE_OPERATOR) {
-    parse_expressionable(history_begin(0));
+void parser_deal_with_additional_expression(struct history *history) {
+  struct token *token = token_peek_next();
+  if (token->type == TOKEN_TYPE_OPERATOR &&
+      !parser_token_ends_expression(history, token)) {
+    parse_expressionable(history);
   }
 }
 
 void parse_for_parentheses(struct history *history) {
   expect_op("(");
-  if (token_peek_next()->type == TOKEN_TYPE_KEYWORD) {
+  if (token_is_keyword_or_typedef_name(token_peek_next())) {
     parse_for_cast();
+    parser_deal_with_additional_expression(history);
     return;
   }
   struct node *left_node = NULL;
@@ -441,14 +374,16 @@ void parse_for_parentheses(struct history *history) {
     make_exp_node(left_node, parenthesis_node, "()");
   }
 
-  parser_deal_with_additional_expression();
+  parser_deal_with_additional_expression(history);
 }
 
 void parse_for_comma(struct history *history) {
   // skip comma
   token_next();
   struct node *left_node = node_pop();
-  parse_expressionable_root(history);
+  struct history *right_history = history_down(history, history->flags);
+  right_history->precedence_limit = expressionable_right_operand_limit(",");
+  parse_expressionable_root(right_history);
   struct node *right_node = node_pop();
   make_exp_node(left_node, right_node, ",");
 }
@@ -460,7 +395,7 @@ void parse_for_array(struct history *history) {
   }
 
   expect_op("[");
-  parse_expressionable_root(history);
+  parse_expressionable_root(history_begin(0));
   expect_sym(']');
 
   struct node *exp_node = node_pop();
@@ -478,7 +413,10 @@ void parse_for_cast() {
   parse_datatype(&dtype);
   expect_sym(')');
 
-  parse_expressionable(history_begin(0));
+  // (int) a + b casts a only
+  struct history *history = history_begin(0);
+  history->precedence_limit = EXPRESSIONABLE_UNARY_OPERAND_LIMIT;
+  parse_expressionable(history);
 
   struct node *operand_node = node_pop();
   make_cast_node(&dtype, operand_node);
@@ -737,7 +675,37 @@ void parser_datatype_init(struct token *datatype_token,
   }
 }
 
+// size_t x; is an int x; with the modifiers written before size_t kept
+void parse_datatype_alias(struct datatype *dtype) {
+  struct datatype *alias =
+      typedef_table_get(current_process->typedefs, token_next()->sval);
+  int modifier_flags = dtype->flags & ~DATATYPE_FLAG_IS_SIGNED;
+  *dtype = *alias;
+  dtype->flags |= modifier_flags;
+  if (datatype_is_struct_or_union(dtype) && !dtype->struct_node) {
+    // typedef struct abc abc_t; before struct abc has a body
+    parser_datatype_init_type_and_size(
+        &(struct token){.type = TOKEN_TYPE_IDENTIFIER,
+                        .sval = dtype->type_str},
+        NULL, dtype, dtype->pointer_depth,
+        dtype->type == DATA_TYPE_STRUCT ? DATA_TYPE_EXPECT_STRUCT
+                                        : DATA_TYPE_EXPECT_UNION);
+  }
+
+  // size_t* x;
+  int pointer_depth = parser_get_pointer_depth();
+  if (pointer_depth > 0) {
+    dtype->flags |= DATATYPE_FLAG_IS_POINTER;
+    dtype->pointer_depth += pointer_depth;
+  }
+}
+
 void parse_datatype_type(struct datatype *dtype) {
+  if (token_is_typedef_name(token_peek_next())) {
+    parse_datatype_alias(dtype);
+    return;
+  }
+
   struct token *datatype_token = NULL;
   struct token *datatype_secondary_token = NULL;
   parser_get_datatype_tokens(&datatype_token, &datatype_secondary_token);
@@ -803,7 +771,7 @@ struct datatype_struct_node_fix_private {
 
 bool datatype_struct_node_fix(struct fixup *fixup) {
   struct datatype_struct_node_fix_private *private = fixup_private(fixup);
-  struct datatype *dtype = &private->node->var.type;
+  struct datatype *dtype = private->node->var.type;
   dtype->type = DATA_TYPE_STRUCT;
   dtype->size = size_of_struct(dtype->type_str);
   dtype->struct_node = struct_node_for_name(current_process, dtype->type_str);
@@ -829,12 +797,12 @@ void make_variable_node(struct datatype *dtype, struct token *name_token,
       .type = NODE_TYPE_VARIABLE,
       .var.name = name_str,
       .var.val = value_node,
-      .var.type = *dtype,
+      .var.type = node_datatype_create(dtype),
   });
 
   struct node *var_node = node_peek_or_null();
-  if (var_node->var.type.type == DATA_TYPE_STRUCT &&
-      !var_node->var.type.struct_node) {
+  if (var_node->var.type->type == DATA_TYPE_STRUCT &&
+      !var_node->var.type->struct_node) {
     struct datatype_struct_node_fix_private *private =
         calloc(1, sizeof(struct datatype_struct_node_fix_private));
     private->node = var_node;
@@ -855,7 +823,7 @@ void parser_scope_offset_for_stack(struct node *node, struct history *history) {
         function_node_argument_stack_addition(parser_current_function);
     offset = stack_addition;
     if (last_entity) {
-      offset = datatype_size(&variable_node(last_entity->node)->var.type);
+      offset = datatype_size(variable_node(last_entity->node)->var.type);
     }
   }
 
@@ -863,7 +831,7 @@ void parser_scope_offset_for_stack(struct node *node, struct history *history) {
     offset += variable_node(last_entity->node)->var.aoffset;
     if (variable_node_is_primitive(node)) {
       variable_node(node)->var.padding =
-          padding(upward_stack ? offset : -offset, node->var.type.size);
+          padding(upward_stack ? offset : -offset, node->var.type->size);
     }
   }
 
@@ -887,9 +855,9 @@ void parser_scope_offset_for_struct(struct node *node,
   int offset = 0;
   struct parser_scope_entity *last_entity = parser_scope_last_entity();
   if (last_entity) {
-    offset += last_entity->stack_offset + last_entity->node->var.type.size;
+    offset += last_entity->stack_offset + last_entity->node->var.type->size;
     if (variable_node_is_primitive(node)) {
-      node->var.padding = padding(offset, node->var.type.size);
+      node->var.padding = padding(offset, node->var.type->size);
     }
 
     node->var.aoffset = offset + node->var.padding;
@@ -922,7 +890,7 @@ void make_variable_node_and_register(struct history *history,
 
   // push the variable node to the current scope
   parser_scope_push(parser_new_scope_entity(var_node, var_node->var.aoffset, 0),
-                    var_node->var.type.size);
+                    var_node->var.type->size);
 
   // add new entity to resolver
   resolver_default_new_scope_entity(current_process->resolver, var_node,
@@ -970,7 +938,10 @@ void parse_variable(struct datatype *dtype, struct token *name_token,
   if (token_next_is_operator("=")) {
     // ignore the =
     token_next();
-    parse_expressionable_root(history);
+    // int a = 1, b = 2; the comma ends the value
+    struct history *value_history = history_down(history, history->flags);
+    value_history->precedence_limit = expressionable_right_operand_limit("=");
+    parse_expressionable_root(value_history);
     value_node = node_pop();
   }
 
@@ -1035,6 +1006,76 @@ struct vector *parse_function_arguments(struct history *history) {
   return args_vec;
 }
 
+// records where the body starts and moves past its closing brace
+static void parse_function_skip_body(struct node *function_node) {
+  token_peek_next();
+  struct function_lazy_body *lazy_body = &function_node->func->lazy_body;
+  lazy_body->pending = true;
+  lazy_body->start = parser_token_cursor;
+  lazy_body->typedefs = typedef_table_count(current_process->typedefs);
+
+  int depth = 0;
+  do {
+    struct token *token = token_next();
+    if (!token) {
+      compiler_error(current_process, "Expected symbol: }");
+    }
+
+    if (token_is_symbol(token, '{')) {
+      depth++;
+    } else if (token_is_symbol(token, '}')) {
+      depth--;
+    }
+  } while (depth);
+}
+
+void parse_function_lazy_body(struct node *function_node) {
+  struct function_lazy_body *lazy_body = &function_node->func->lazy_body;
+  assert(lazy_body->pending);
+  lazy_body->pending = false;
+
+  // the body is parsed as it would have been in place, with the validator or
+  // code generator state this is called from put aside
+  struct token_cursor token_cursor = parser_token_cursor;
+  struct token *last_token = parser_last_token;
+  struct pos pos = current_process->pos;
+  struct node *current_function = parser_current_function;
+  struct node *current_body = parser_current_body;
+  struct arena *history_arena = parser_history_arena;
+  struct scope *scope_root = current_process->scope.root;
+  struct scope *scope_current = current_process->scope.current;
+  current_process->scope.root = NULL;
+  current_process->scope.current = NULL;
+
+  scope_create_root(current_process);
+  parser_history_arena = arena_create();
+  parser_token_cursor = lazy_body->start;
+  parser_current_function = function_node;
+  parser_current_body = NULL;
+  typedef_table_hide_after(current_process->typedefs, lazy_body->typedefs);
+  parser_scope_new();
+  resolver_default_new_scope(current_process->resolver, 0);
+
+  parse_function_body(history_begin(0));
+  function_node->func->body_n = node_pop();
+
+  resolver_default_finish_scope(current_process->resolver);
+  parser_scope_finish();
+  typedef_table_show_all(current_process->typedefs);
+  assert(fixups_resolve(parser_fixup_sys));
+  arena_free(parser_history_arena);
+  scope_free_root(current_process);
+
+  parser_token_cursor = token_cursor;
+  parser_last_token = last_token;
+  current_process->pos = pos;
+  parser_current_function = current_function;
+  parser_current_body = current_body;
+  parser_history_arena = history_arena;
+  current_process->scope.root = scope_root;
+  current_process->scope.current = scope_current;
+}
+
 void parse_function(struct datatype *rtype, struct token *name_token,
                     struct history *history) {
   struct vector *args_vec = NULL;
@@ -1044,23 +1085,26 @@ void parse_function(struct datatype *rtype, struct token *name_token,
   struct node *function_node = node_peek();
   parser_current_function = function_node;
   if (datatype_is_struct_or_union(rtype)) {
-    function_node->func.args.stack_addition += DATA_SIZE_DWORD;
+    function_node->func->args.stack_addition += DATA_SIZE_DWORD;
   }
 
   expect_op("(");
   args_vec = parse_function_arguments(history_begin(0));
   expect_sym(')');
 
-  function_node->func.args.args = args_vec;
+  function_node->func->args.args = args_vec;
   if (symresolver_get_symbol_for_native_function(current_process,
                                                  name_token->sval)) {
-    function_node->func.flags |= FUNCTION_NODE_FLAG_IS_NATIVE;
+    function_node->func->flags |= FUNCTION_NODE_FLAG_IS_NATIVE;
   }
 
-  if (token_next_is_symbol('{')) {
+  if (token_next_is_symbol('{') &&
+      current_process->flags & COMPILE_PROCESS_LAZY_FUNCTION_BODIES) {
+    parse_function_skip_body(function_node);
+  } else if (token_next_is_symbol('{')) {
     parse_function_body(history_begin(0));
     struct node *body_node = node_pop();
-    function_node->func.body_n = body_node;
+    function_node->func->body_n = body_node;
   } else {
     expect_sym(';');
   }
@@ -1086,7 +1130,7 @@ void parse_symbol() {
 }
 
 void parse_statement(struct history *history) {
-  if (token_peek_next()->type == TOKEN_TYPE_KEYWORD) {
+  if (token_is_keyword_or_typedef_name(token_peek_next())) {
     parse_keyword(history);
     return;
   }
@@ -1106,7 +1150,7 @@ void parser_append_size_for_node_struct_union(struct history *history,
                                               size_t *_variable_size,
                                               struct node *node) {
   *_variable_size += variable_size(node);
-  if (node->var.type.flags & DATATYPE_FLAG_IS_POINTER) {
+  if (node->var.type->flags & DATATYPE_FLAG_IS_POINTER) {
     return;
   }
 
@@ -1114,7 +1158,7 @@ void parser_append_size_for_node_struct_union(struct history *history,
       variable_struct_or_union_body_node(node)->body.largest_variable_node;
   if (largest_var_node) {
     *_variable_size +=
-        align_value(*_variable_size, largest_var_node->var.type.size);
+        align_value(*_variable_size, largest_var_node->var.type->size);
   }
 }
 
@@ -1165,7 +1209,7 @@ void parser_finalize_body(struct history *history, struct node *body_node,
   *_variable_size += padding;
   if (largest_aligned_eligible_var_node) {
     *_variable_size = align_value(
-        *_variable_size, largest_aligned_eligible_var_node->var.type.size);
+        *_variable_size, largest_aligned_eligible_var_node->var.type->size);
   }
 
   bool padded = padding != 0;
@@ -1218,15 +1262,15 @@ void parse_body_multiple_statements(size_t *var_size, struct vector *body_vec,
     stmt_node = node_pop();
     if (stmt_node->type == NODE_TYPE_VARIABLE) {
       if (!largest_possible_var_node ||
-          largest_possible_var_node->var.type.size <=
-              stmt_node->var.type.size) {
+          largest_possible_var_node->var.type->size <=
+              stmt_node->var.type->size) {
         largest_possible_var_node = stmt_node;
       }
 
       if (variable_node_is_primitive(stmt_node)) {
         if (!largest_aligned_eligible_var_node ||
-            largest_aligned_eligible_var_node->var.type.size <=
-                stmt_node->var.type.size) {
+            largest_aligned_eligible_var_node->var.type->size <=
+                stmt_node->var.type->size) {
           largest_aligned_eligible_var_node = stmt_node;
         }
       }
@@ -1274,13 +1318,14 @@ void parse_body(size_t *variable_size, struct history *history) {
 
   if (variable_size) {
     if (history->flags & HISTORY_FLAG_INSIDE_FUNCTION_BODY) {
-      parser_current_function->func.stack_size += *variable_size;
+      parser_current_function->func->stack_size += *variable_size;
     }
   }
 }
 
 void parse_struct_no_new_scope(struct datatype *dtype,
-                               bool is_forward_declaration) {
+                               bool is_forward_declaration,
+                               struct history *history) {
   struct node *body_node = NULL;
   size_t body_variable_size = 0;
   if (!is_forward_declaration) {
@@ -1295,6 +1340,12 @@ void parse_struct_no_new_scope(struct datatype *dtype,
   }
 
   dtype->struct_node = struct_node;
+  if (history->flags & HISTORY_FLAG_IS_TYPEDEF) {
+    // typedef struct abc {...} abc_t; the name belongs to the typedef
+    node_push(struct_node);
+    return;
+  }
+
   if (token_is_identifier(token_peek_next())) {
     struct token *var_name = token_next();
     struct_node->flags |= NODE_FLAG_HAS_VARIABLE_COMBINED;
@@ -1315,7 +1366,8 @@ void parse_struct_no_new_scope(struct datatype *dtype,
   node_push(struct_node);
 }
 
-void parse_union_no_scope(struct datatype *dtype, bool is_forward_declaration) {
+void parse_union_no_scope(struct datatype *dtype, bool is_forward_declaration,
+                          struct history *history) {
   struct node *body_node = NULL;
   size_t body_variable_size = 0;
   if (!is_forward_declaration) {
@@ -1329,6 +1381,12 @@ void parse_union_no_scope(struct datatype *dtype, bool is_forward_declaration) {
     dtype->size = body_node->body.size;
   }
 
+  if (history->flags & HISTORY_FLAG_IS_TYPEDEF) {
+    dtype->union_node = union_node;
+    node_push(union_node);
+    return;
+  }
+
   if (token_peek_next()->type == TOKEN_TYPE_IDENTIFIER) {
     struct token *var_name = token_next();
     union_node->flags |= NODE_FLAG_HAS_VARIABLE_COMBINED;
@@ -1340,14 +1398,14 @@ void parse_union_no_scope(struct datatype *dtype, bool is_forward_declaration) {
   node_push(union_node);
 }
 
-void parse_union(struct datatype *dtype) {
+void parse_union(struct datatype *dtype, struct history *history) {
   bool is_forward_declaration = !token_is_symbol(token_peek_next(), '{');
   if (!is_forward_declaration) {
     parser_scope_new();
     resolver_default_new_scope(current_process->resolver, 0);
   }
 
-  parse_union_no_scope(dtype, is_forward_declaration);
+  parse_union_no_scope(dtype, is_forward_declaration, history);
   if (!is_forward_declaration) {
     // end the scope
     resolver_default_finish_scope(current_process->resolver);
@@ -1355,14 +1413,14 @@ void parse_union(struct datatype *dtype) {
   }
 }
 
-void parse_struct(struct datatype *dtype) {
+void parse_struct(struct datatype *dtype, struct history *history) {
   bool is_forward_declaration = !token_is_symbol(token_peek_next(), '{');
   if (!is_forward_declaration) {
     parser_scope_new();
     resolver_default_new_scope(current_process->resolver, 0);
   }
 
-  parse_struct_no_new_scope(dtype, is_forward_declaration);
+  parse_struct_no_new_scope(dtype, is_forward_declaration, history);
   if (!is_forward_declaration) {
     // end the scope
     resolver_default_finish_scope(current_process->resolver);
@@ -1370,13 +1428,13 @@ void parse_struct(struct datatype *dtype) {
   }
 }
 
-void parse_struct_or_union(struct datatype *dtype) {
+void parse_struct_or_union(struct datatype *dtype, struct history *history) {
   switch (dtype->type) {
   case DATA_TYPE_STRUCT:
-    parse_struct(dtype);
+    parse_struct(dtype, history);
     break;
   case DATA_TYPE_UNION:
-    parse_union(dtype);
+    parse_union(dtype, history);
     break;
   default:
     compiler_error(current_process, "Invalid struct or union type");
@@ -1385,7 +1443,7 @@ void parse_struct_or_union(struct datatype *dtype) {
 
 void parse_forward_declaration(struct datatype *dtype) {
   // since this is a forward declaration we don't need to parse the body
-  parse_struct(dtype);
+  parse_struct(dtype, history_begin(0));
 }
 
 void parse_variable_function_or_struct_union(struct history *history) {
@@ -1393,7 +1451,7 @@ void parse_variable_function_or_struct_union(struct history *history) {
   parse_datatype(&dtype);
 
   if (datatype_is_struct_or_union(&dtype) && token_next_is_symbol('{')) {
-    parse_struct_or_union(&dtype);
+    parse_struct_or_union(&dtype, history);
     struct node *su_node = node_pop();
     symresolver_build_for_node(current_process, su_node);
     node_push(su_node);
@@ -1443,6 +1501,58 @@ void parse_variable_function_or_struct_union(struct history *history) {
   expect_sym(';');
 }
 
+// typedef unsigned int uint;
+// typedef struct abc {...} abc_t;
+void parse_typedef(struct history *history) {
+  expect_keyword("typedef");
+  struct datatype dtype;
+  parse_datatype(&dtype);
+
+  // the typedef only declares a name unless it also declares a struct or union
+  struct node *node = parser_blank_node;
+  if (datatype_is_struct_or_union(&dtype) && token_next_is_symbol('{')) {
+    parse_struct_or_union(
+        &dtype, history_down(history, history->flags | HISTORY_FLAG_IS_TYPEDEF));
+    node = node_pop();
+    struct token *name_token = token_peek_next();
+    if (dtype.flags & DATATYPE_FLAG_STRUCT_UNION_NO_NAME &&
+        token_is_identifier(name_token)) {
+      // typedef struct {...} abc_t; the struct takes the typedef name
+      dtype.type_str = name_token->sval;
+      dtype.flags &= ~DATATYPE_FLAG_STRUCT_UNION_NO_NAME;
+      if (dtype.type == DATA_TYPE_STRUCT) {
+        node->_struct.name = name_token->sval;
+      } else {
+        node->_union.name = name_token->sval;
+      }
+    }
+
+    symresolver_build_for_node(current_process, node);
+
+    // typedef struct abc {...}* abc_ptr;
+    int pointer_depth = parser_get_pointer_depth();
+    if (pointer_depth > 0) {
+      dtype.flags |= DATATYPE_FLAG_IS_POINTER;
+      dtype.pointer_depth += pointer_depth;
+    }
+  }
+
+  parser_ignore_int(&dtype);
+  struct token *name_token = token_next();
+  if (!token_is_identifier(name_token)) {
+    compiler_error(current_process, "Expected a name for the typedef");
+  }
+
+  if (!typedef_table_add(current_process->typedefs, name_token->sval,
+                         &dtype)) {
+    compiler_error(current_process,
+                   "typedef %s redefined with a different type",
+                   name_token->sval);
+  }
+  expect_sym(';');
+  node_push(node);
+}
+
 void parse_if_stmt(struct history *history);
 
 struct node *parse_else(struct history *history) {
@@ -1647,12 +1757,16 @@ void parse_return(struct history *history) {
 void parse_tenary(struct history *history) {
   struct node *cond_node = node_pop();
   expect_op("?");
-  parse_expressionable_root(
-      history_down(history, HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL));
+  struct history *true_history =
+      history_down(history, HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL);
+  true_history->precedence_limit = 0;
+  parse_expressionable_root(true_history);
   struct node *true_result_node = node_pop();
   expect_sym(':');
-  parse_expressionable_root(
-      history_down(history, HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL));
+  struct history *false_history =
+      history_down(history, HISTORY_FLAG_PARENTHESES_IS_NOT_A_FUNCTION_CALL);
+  false_history->precedence_limit = expressionable_right_operand_limit("?");
+  parse_expressionable_root(false_history);
   struct node *false_result_node = node_pop();
   make_tenary_node(true_result_node, false_result_node);
   struct node *tenary_node = node_pop();
@@ -1679,11 +1793,16 @@ void parse_keyword(struct history *history) {
   }
 
   if (is_keyword_variable_modifier(token->sval) ||
-      keyword_is_datatype(token->sval)) {
+      keyword_is_datatype(token->sval) || token_is_typedef_name(token)) {
     parse_variable_function_or_struct_union(history);
     return;
   }
 
+  if (S_EQ(token->sval, "typedef")) {
+    parse_typedef(history);
+    return;
+  }
+
   if (S_EQ(token->sval, "break")) {
     parse_break(history);
     return;
@@ -1741,7 +1860,12 @@ int parse_expressionable_single(struct history *history) {
     res = parse_exp(history);
     break;
   case TOKEN_TYPE_IDENTIFIER:
-    parse_identifier(history);
+    if (token_is_typedef_name(token)) {
+      // typedef names are parsed like the datatype keywords
+      parse_keyword(history);
+    } else {
+      parse_identifier(history);
+    }
     res = 0;
     break;
   case TOKEN_TYPE_KEYWORD:
@@ -1757,7 +1881,13 @@ int parse_expressionable_single(struct history *history) {
 }
 
 void parse_expressionable(struct history *history) {
-  while (parse_expressionable_single(history) == 0) {
+  // the first token always starts an operand, - and ( are not binary there
+  if (parse_expressionable_single(history) != 0) {
+    return;
+  }
+
+  while (!parser_token_ends_expression(history, token_peek_next()) &&
+         parse_expressionable_single(history) == 0) {
   }
 }
 
@@ -1782,7 +1912,13 @@ int parse_next() {
     return -1;
   }
 
+  arena_reset(parser_history_arena);
   int res = 0;
+  if (token_is_typedef_name(token)) {
+    parse_keyword_for_global();
+    return 0;
+  }
+
   switch (token->type) {
   case TOKEN_TYPE_NUMBER:
   case TOKEN_TYPE_IDENTIFIER:
@@ -1806,16 +1942,21 @@ int parse(struct compile_process *process) {
   current_process = process;
   parser_last_token = NULL;
   node_set_vector(process->node_vec, process->node_tree_vec);
+  node_set_arenas(process->node_arena, process->node_data_arena);
   parser_blank_node = node_create(&(struct node){.type = NODE_TYPE_BLANK});
   parser_fixup_sys = fixup_sys_new();
+  parser_history_arena = arena_create();
   struct node *node = NULL;
-  vector_set_peek_pointer(process->token_vec, 0);
+  token_cursor_init(&parser_token_cursor, process->token_segments);
   while (parse_next() == 0) {
     node = node_peek();
     vector_push(process->node_tree_vec, &node);
   }
 
-  assert(fixups_resolve(parser_fixup_sys));
+  // a struct that is never defined is left for the caller to report
+  bool fixups_resolved = fixups_resolve(parser_fixup_sys);
+  arena_free(parser_history_arena);
+  parser_history_arena = NULL;
   scope_free_root(process);
-  return PARSE_ALL_OK;
+  return fixups_resolved ? PARSE_ALL_OK : PARSE_GENERAL_ERROR;
 }
@@ -0,0 +1,1249 @@
+#include "compiler.h"
+#include "helpers/arena.h"
+#include "helpers/buffer.h"
+#include "helpers/intern.h"
+#include "helpers/vector.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PCH_MAGIC 0x48435052
+#define PCH_VERSION 5
+#define PCH_NO_STRING 0xffffffff
+#define PCH_NO_INDEX 0xffffffff
+
+/**
+ * A precompiled header is this header, a table of every string it refers to
+ * null terminated, the included files, the macro definitions, the parsed
+ * declarations and then the preprocessed tokens, one token segment after the
+ * other. Each part starts on an 8 byte boundary.
+ */
+struct pch_header {
+  uint32_t magic;
+  uint32_t version;
+  // guards against a file written by a build with a different layout
+  uint32_t token_size;
+  uint32_t total_strings;
+  uint64_t strings_size;
+};
+
+struct pch_file {
+  uint32_t filename;
+  uint32_t guard;
+  uint32_t once;
+  // files that were not read from disk (static includes) are not checked
+  uint32_t on_disk;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint64_t size;
+};
+
+struct pch_definition {
+  uint32_t type;
+  uint32_t name;
+  uint32_t total_args;
+  uint32_t arg_size;
+  uint64_t total_tokens;
+};
+
+struct pch_token {
+  uint8_t type;
+  uint8_t flags;
+  uint8_t whitespace;
+  uint8_t padding;
+  int32_t num_type;
+  int32_t line;
+  int32_t col;
+  uint32_t filename;
+  // "(brackets)(args)" text the source offsets point into, the source file
+  // itself is not part of the precompiled header
+  uint32_t source;
+  int32_t between_brackets;
+  int32_t between_args;
+  // index into the string table for tokens with text, otherwise the value
+  uint64_t value;
+};
+
+// the tokens of a segment follow it
+struct pch_segment {
+  uint32_t filename;
+  uint32_t padding;
+  uint64_t total_tokens;
+};
+
+/**
+ * The declarations are only there when the header parsed on its own into
+ * nothing but declarations. This header is followed by the nodes, datatypes,
+ * functions, list entries, top level nodes, symbols and typedefs. Pointers
+ * are written as indexes into their part and vectors of nodes as the offset
+ * of their length in the list entries, which is followed by the indexes.
+ */
+struct pch_ast_header {
+  uint32_t present;
+  uint32_t total_nodes;
+  uint32_t total_datatypes;
+  uint32_t total_functions;
+  uint32_t total_list_entries;
+  uint32_t total_roots;
+  uint32_t total_symbols;
+  uint32_t total_typedefs;
+};
+
+// what name, refs, ints and value hold depends on the type, see
+// pch_ast_write_node()
+struct pch_node {
+  uint32_t type;
+  uint32_t flags;
+  int32_t line;
+  int32_t col;
+  uint32_t filename;
+  uint32_t owner;
+  uint32_t function;
+  uint32_t name;
+  uint32_t refs[2];
+  int32_t ints[2];
+  uint64_t value;
+};
+
+struct pch_datatype {
+  uint32_t flags;
+  uint32_t type;
+  uint32_t secondary;
+  uint32_t type_str;
+  uint64_t size;
+  int32_t pointer_depth;
+  uint32_t struct_node;
+  uint32_t brackets;
+  uint32_t padding;
+  uint64_t array_size;
+};
+
+struct pch_function {
+  uint32_t flags;
+  uint32_t rtype;
+  uint32_t name;
+  uint32_t args;
+  uint64_t stack_addition;
+  uint64_t stack_size;
+};
+
+struct pch_symbol {
+  uint32_t name;
+  uint32_t node;
+};
+
+struct pch_typedef {
+  uint32_t name;
+  uint32_t dtype;
+};
+
+struct pch_writer {
+  struct buffer *body;
+  struct buffer *strings;
+
+  // string table index of every string written, keyed by content
+  struct hashmap indexes;
+  uint32_t count;
+};
+
+struct pch_reader {
+  const char *ptr;
+  const char *end;
+  const char **strings;
+  uint32_t total_strings;
+};
+
+static size_t pch_align(size_t size) { return (size + 7) & ~(size_t)7; }
+
+static uint32_t pch_string(struct pch_writer *writer, const char *str) {
+  if (!str) {
+    return PCH_NO_STRING;
+  }
+
+  struct hashmap_entry *entry = hashmap_find(&writer->indexes, str);
+  if (entry) {
+    return (uintptr_t)entry->value;
+  }
+
+  // the string may not outlive the writer, keep a copy in the table
+  buffer_write_bytes(writer->strings, str, strlen(str) + 1);
+  hashmap_add(&writer->indexes, strdup(str), (void *)(uintptr_t)writer->count);
+  return writer->count++;
+}
+
+static void pch_write(struct pch_writer *writer, const void *data,
+                      size_t size) {
+  buffer_write_bytes(writer->body, data, size);
+}
+
+static void pch_write_padding(struct pch_writer *writer) {
+  static const char padding[8] = {};
+  pch_write(writer, padding,
+            pch_align(writer->body->len) - writer->body->len);
+}
+
+static uint32_t pch_token_source(struct pch_writer *writer,
+                                 struct token *token, int *brackets_out,
+                                 int *args_out) {
+  const char *brackets = token_between_brackets(token);
+  const char *args = token_between_args(token);
+  if (!brackets && !args) {
+    return PCH_NO_STRING;
+  }
+
+  struct buffer *text = buffer_create();
+  if (brackets) {
+    buffer_write(text, '(');
+    *brackets_out = text->len;
+    buffer_write_bytes(text, brackets, strlen(brackets));
+    buffer_write(text, ')');
+  }
+
+  if (args) {
+    buffer_write(text, '(');
+    *args_out = text->len;
+    buffer_write_bytes(text, args, strlen(args));
+    buffer_write(text, ')');
+  }
+
+  buffer_write(text, 0x00);
+  uint32_t index = pch_string(writer, buffer_ptr(text));
+  buffer_free(text);
+  free((void *)brackets);
+  free((void *)args);
+  return index;
+}
+
+static void pch_write_tokens(struct pch_writer *writer,
+                             struct vector *token_vec, int start, int end) {
+  for (int i = start; i < end; i++) {
+    struct token *token = vector_at(token_vec, i);
+    struct pch_token record = {
+        .type = token->type,
+        .flags = token->flags,
+        .whitespace = token->whitespace,
+        .num_type = token->num.type,
+        .line = token->pos.line,
+        .col = token->pos.col,
+        .filename = pch_string(writer, token->pos.filename)};
+    record.value = token_type_has_text(token->type)
+                       ? pch_string(writer, token->sval)
+                       : token->llnum;
+    record.source = pch_token_source(writer, token, &record.between_brackets,
+                                     &record.between_args);
+    pch_write(writer, &record, sizeof(record));
+  }
+}
+
+static void pch_write_files(struct pch_writer *writer,
+                            struct preprocessor *preprocessor,
+                            const char *prefix_path) {
+  uint64_t total = vector_count(preprocessor->includes);
+  pch_write(writer, &total, sizeof(total));
+  for (uint64_t i = 0; i < total; i++) {
+    struct preprocessor_included_file *included_file =
+        *(struct preprocessor_included_file **)vector_at(
+            preprocessor->includes, i);
+    struct pch_file file = {
+        .filename = pch_string(writer, included_file->filename),
+        .guard = pch_string(writer, included_file->guard),
+        // the prefix is already part of every compile that uses it
+        .once = included_file->once ||
+                S_EQ(included_file->filename, prefix_path)};
+
+    struct stat st;
+    if (included_file->filename[0] == '/' &&
+        stat(included_file->filename, &st) == 0) {
+      file.on_disk = true;
+      file.mtime_sec = st.st_mtim.tv_sec;
+      file.mtime_nsec = st.st_mtim.tv_nsec;
+      file.size = st.st_size;
+    }
+
+    pch_write(writer, &file, sizeof(file));
+  }
+}
+
+static void pch_write_definitions(struct pch_writer *writer,
+                                  struct preprocessor *preprocessor) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < preprocessor->defs.capacity; i++) {
+    struct preprocessor_definition *def = preprocessor->defs.entries[i].value;
+    // native definitions are recreated with the preprocessor
+    if (def && def->type != PREPROCESSOR_DEFINITION_NATIVE_CALLBACK) {
+      total++;
+    }
+  }
+
+  pch_write(writer, &total, sizeof(total));
+  for (size_t i = 0; i < preprocessor->defs.capacity; i++) {
+    struct preprocessor_definition *def = preprocessor->defs.entries[i].value;
+    if (!def || def->type == PREPROCESSOR_DEFINITION_NATIVE_CALLBACK) {
+      continue;
+    }
+
+    struct vector *value = def->standard.value;
+    struct vector *args = def->standard.args;
+    struct pch_definition record = {
+        .type = def->type,
+        .name = pch_string(writer, def->name),
+        .total_args = args ? vector_count(args) : 0,
+        .arg_size = args ? vector_element_size(args) : 0,
+        .total_tokens = vector_count(value)};
+    pch_write(writer, &record, sizeof(record));
+    if (record.total_args) {
+      // arguments are kept exactly as the definition stored them
+      pch_write(writer, vector_data_ptr(args),
+                record.total_args * record.arg_size);
+      pch_write_padding(writer);
+    }
+
+    pch_write_tokens(writer, value, 0, vector_count(value));
+  }
+}
+
+// gives every pointer reached an index, in the order they are reached
+struct pch_index_table {
+  // index of every pointer reached, keyed by address
+  struct hashmap indexes;
+  // pointers by index, the first done of them are written
+  struct vector *items;
+  uint32_t done;
+};
+
+struct pch_ast_writer {
+  struct pch_writer *writer;
+  struct pch_index_table nodes;
+  struct pch_index_table datatypes;
+  struct pch_index_table functions;
+  struct buffer *node_records;
+  struct buffer *datatype_records;
+  struct buffer *function_records;
+  // uint32_t entries, every list is its length followed by its node indexes
+  struct buffer *lists;
+  // set when a node that is not a declaration is reached
+  bool unsupported;
+};
+
+static void pch_index_table_init(struct pch_index_table *table) {
+  hashmap_init(&table->indexes, 1024, HASHMAP_POINTER_KEYS);
+  table->items = vector_create(sizeof(const void *));
+  table->done = 0;
+}
+
+static void pch_index_table_free(struct pch_index_table *table) {
+  hashmap_free(&table->indexes);
+  vector_free(table->items);
+}
+
+static uint32_t pch_index(struct pch_index_table *table, const void *ptr) {
+  if (!ptr) {
+    return PCH_NO_INDEX;
+  }
+
+  struct hashmap_entry *entry = hashmap_find(&table->indexes, ptr);
+  if (entry) {
+    return (uintptr_t)entry->value;
+  }
+
+  uint32_t new_index = vector_count(table->items);
+  hashmap_add(&table->indexes, ptr, (void *)(uintptr_t)new_index);
+  vector_push(table->items, &ptr);
+  return new_index;
+}
+
+static uint32_t pch_ast_list(struct pch_ast_writer *ast, struct vector *vec) {
+  if (!vec) {
+    return PCH_NO_INDEX;
+  }
+
+  uint32_t offset = ast->lists->len / sizeof(uint32_t);
+  uint32_t total = vector_count(vec);
+  buffer_write_bytes(ast->lists, &total, sizeof(total));
+  for (uint32_t i = 0; i < total; i++) {
+    uint32_t index =
+        pch_index(&ast->nodes, *(struct node **)vector_at(vec, i));
+    buffer_write_bytes(ast->lists, &index, sizeof(index));
+  }
+
+  return offset;
+}
+
+static void pch_ast_write_node(struct pch_ast_writer *ast, struct node *node) {
+  struct pch_writer *writer = ast->writer;
+  struct pch_node record = {
+      .type = node->type,
+      .flags = node->flags,
+      .line = node->pos.line,
+      .col = node->pos.col,
+      .filename = pch_string(writer, node->pos.filename),
+      .owner = pch_index(&ast->nodes, node->binded.owner),
+      .function = pch_index(&ast->nodes, node->binded.function),
+      .name = PCH_NO_STRING,
+      .refs = {PCH_NO_INDEX, PCH_NO_INDEX}};
+  switch (node->type) {
+  case NODE_TYPE_EXPRESSION:
+    record.name = pch_string(writer, node->exp.op);
+    record.refs[0] = pch_index(&ast->nodes, node->exp.left);
+    record.refs[1] = pch_index(&ast->nodes, node->exp.right);
+    break;
+
+  case NODE_TYPE_EXPRESSION_PARENTHESIS:
+    record.refs[0] = pch_index(&ast->nodes, node->paren.exp);
+    break;
+
+  case NODE_TYPE_NUMBER:
+    record.value = node->llnum;
+    break;
+
+  case NODE_TYPE_IDENTIFIER:
+  case NODE_TYPE_STRING:
+    record.name = pch_string(writer, node->sval);
+    break;
+
+  case NODE_TYPE_VARIABLE:
+    record.name = pch_string(writer, node->var.name);
+    record.refs[0] = pch_index(&ast->datatypes, node->var.type);
+    record.refs[1] = pch_index(&ast->nodes, node->var.val);
+    record.ints[0] = node->var.padding;
+    record.ints[1] = node->var.aoffset;
+    break;
+
+  case NODE_TYPE_VARIABLE_LIST:
+    record.refs[0] = pch_ast_list(ast, node->var_list.list);
+    break;
+
+  case NODE_TYPE_FUNCTION:
+    // only prototypes, a body is code rather than a declaration
+    if (node->func->body_n || node->func->lazy_body.pending) {
+      ast->unsupported = true;
+    }
+
+    record.refs[0] = pch_index(&ast->functions, node->func);
+    break;
+
+  case NODE_TYPE_BODY:
+    record.refs[0] = pch_ast_list(ast, node->body.statements);
+    record.refs[1] = pch_index(&ast->nodes, node->body.largest_variable_node);
+    record.ints[0] = node->body.padded;
+    record.value = node->body.size;
+    break;
+
+  case NODE_TYPE_UNARY:
+    record.name = pch_string(writer, node->unary.op);
+    record.refs[0] = pch_index(&ast->nodes, node->unary.operand);
+    record.ints[0] = node->unary.flags;
+    record.ints[1] = node->unary.indirection.depth;
+    break;
+
+  case NODE_TYPE_TENARY:
+    record.refs[0] = pch_index(&ast->nodes, node->tenary.true_node);
+    record.refs[1] = pch_index(&ast->nodes, node->tenary.false_node);
+    break;
+
+  case NODE_TYPE_STRUCT:
+    record.name = pch_string(writer, node->_struct.name);
+    record.refs[0] = pch_index(&ast->nodes, node->_struct.body_n);
+    record.refs[1] = pch_index(&ast->nodes, node->_struct.var);
+    break;
+
+  case NODE_TYPE_UNION:
+    record.name = pch_string(writer, node->_union.name);
+    record.refs[0] = pch_index(&ast->nodes, node->_union.body_n);
+    record.refs[1] = pch_index(&ast->nodes, node->_union.var);
+    break;
+
+  case NODE_TYPE_BRACKET:
+    record.refs[0] = pch_index(&ast->nodes, node->bracket.inner);
+    break;
+
+  case NODE_TYPE_CAST:
+    record.refs[0] = pch_index(&ast->datatypes, node->cast.dtype);
+    record.refs[1] = pch_index(&ast->nodes, node->cast.exp);
+    break;
+
+  case NODE_TYPE_BLANK:
+    break;
+
+  default:
+    // statements only appear in function bodies
+    ast->unsupported = true;
+    break;
+  }
+
+  buffer_write_bytes(ast->node_records, &record, sizeof(record));
+}
+
+static void pch_ast_write_datatype(struct pch_ast_writer *ast,
+                                   struct datatype *dtype) {
+  struct pch_datatype record = {
+      .flags = dtype->flags,
+      .type = dtype->type,
+      .secondary = pch_index(&ast->datatypes, dtype->secondary),
+      .type_str = pch_string(ast->writer, dtype->type_str),
+      .size = dtype->size,
+      .pointer_depth = dtype->pointer_depth,
+      // the union node shares the pointer
+      .struct_node = pch_index(&ast->nodes, dtype->struct_node),
+      .brackets = PCH_NO_INDEX,
+      .array_size = dtype->array.size};
+  if (dtype->array.brackets) {
+    record.brackets = pch_ast_list(ast, dtype->array.brackets->n_brackets);
+  }
+
+  buffer_write_bytes(ast->datatype_records, &record, sizeof(record));
+}
+
+static void pch_ast_write_function(struct pch_ast_writer *ast,
+                                   struct function *func) {
+  struct pch_function record = {
+      .flags = func->flags,
+      .rtype = pch_index(&ast->datatypes, &func->rtype),
+      .name = pch_string(ast->writer, func->name),
+      .args = pch_ast_list(ast, func->args.args),
+      .stack_addition = func->args.stack_addition,
+      .stack_size = func->stack_size};
+  buffer_write_bytes(ast->function_records, &record, sizeof(record));
+}
+
+// writes everything indexed so far, which may index more
+static void pch_ast_write_pending(struct pch_ast_writer *ast) {
+  bool wrote = true;
+  while (wrote) {
+    wrote = false;
+    while (ast->nodes.done < vector_count(ast->nodes.items)) {
+      pch_ast_write_node(
+          ast, *(struct node **)vector_at(ast->nodes.items, ast->nodes.done++));
+      wrote = true;
+    }
+
+    while (ast->datatypes.done < vector_count(ast->datatypes.items)) {
+      pch_ast_write_datatype(ast, *(struct datatype **)vector_at(
+                                      ast->datatypes.items,
+                                      ast->datatypes.done++));
+      wrote = true;
+    }
+
+    while (ast->functions.done < vector_count(ast->functions.items)) {
+      pch_ast_write_function(ast, *(struct function **)vector_at(
+                                      ast->functions.items,
+                                      ast->functions.done++));
+      wrote = true;
+    }
+  }
+}
+
+static void pch_write_section(struct pch_writer *writer, struct buffer *buffer) {
+  pch_write(writer, buffer_ptr(buffer), buffer->len);
+  pch_write_padding(writer);
+}
+
+static void pch_write_declarations(struct pch_writer *writer,
+                                   struct compile_process *compiler,
+                                   bool parsed) {
+  struct pch_ast_writer ast = {.writer = writer};
+  pch_index_table_init(&ast.nodes);
+  pch_index_table_init(&ast.datatypes);
+  pch_index_table_init(&ast.functions);
+  ast.node_records = buffer_create();
+  ast.datatype_records = buffer_create();
+  ast.function_records = buffer_create();
+  ast.lists = buffer_create();
+  struct buffer *roots = buffer_create();
+  struct buffer *symbols = buffer_create();
+  struct buffer *typedefs = buffer_create();
+
+  struct pch_ast_header header = {};
+  if (parsed) {
+    for (int i = 0; i < vector_count(compiler->node_tree_vec); i++) {
+      uint32_t index = pch_index(
+          &ast.nodes, *(struct node **)vector_at(compiler->node_tree_vec, i));
+      buffer_write_bytes(roots, &index, sizeof(index));
+      header.total_roots++;
+    }
+
+    // native functions are registered again by their static include
+    struct vector *table = compiler->symbols.table;
+    for (int i = 0; i < vector_count(table); i++) {
+      struct symbol *symbol = *(struct symbol **)vector_at(table, i);
+      if (symbol->type != SYMBOL_TYPE_NODE) {
+        continue;
+      }
+
+      struct pch_symbol record = {
+          .name = pch_string(writer, symbol->name),
+          .node = pch_index(&ast.nodes, symbol->data)};
+      buffer_write_bytes(symbols, &record, sizeof(record));
+      header.total_symbols++;
+    }
+
+    const char *name = NULL;
+    struct datatype *dtype = NULL;
+    while ((dtype = typedef_table_at(compiler->typedefs,
+                                     header.total_typedefs, &name))) {
+      struct pch_typedef record = {
+          .name = pch_string(writer, name),
+          .dtype = pch_index(&ast.datatypes, dtype)};
+      buffer_write_bytes(typedefs, &record, sizeof(record));
+      header.total_typedefs++;
+    }
+
+    pch_ast_write_pending(&ast);
+    header.present = !ast.unsupported;
+  }
+
+  if (header.present) {
+    header.total_nodes = vector_count(ast.nodes.items);
+    header.total_datatypes = vector_count(ast.datatypes.items);
+    header.total_functions = vector_count(ast.functions.items);
+    header.total_list_entries = ast.lists->len / sizeof(uint32_t);
+    pch_write(writer, &header, sizeof(header));
+    pch_write_section(writer, ast.node_records);
+    pch_write_section(writer, ast.datatype_records);
+    pch_write_section(writer, ast.function_records);
+    pch_write_section(writer, ast.lists);
+    pch_write_section(writer, roots);
+    pch_write_section(writer, symbols);
+    pch_write_section(writer, typedefs);
+  } else {
+    // the header is only usable as tokens
+    header = (struct pch_ast_header){};
+    pch_write(writer, &header, sizeof(header));
+  }
+
+  pch_index_table_free(&ast.nodes);
+  pch_index_table_free(&ast.datatypes);
+  pch_index_table_free(&ast.functions);
+  buffer_free(ast.node_records);
+  buffer_free(ast.datatype_records);
+  buffer_free(ast.function_records);
+  buffer_free(ast.lists);
+  buffer_free(roots);
+  buffer_free(symbols);
+  buffer_free(typedefs);
+}
+
+int pch_create(struct compile_process *compiler, const char *filename,
+               bool parsed) {
+  struct pch_writer writer = {};
+  writer.body = buffer_create();
+  writer.strings = buffer_create();
+  hashmap_init(&writer.indexes, 1024, HASHMAP_STRING_KEYS);
+
+  pch_write_files(&writer, compiler->preprocessor, compiler->cfile.abs_path);
+  pch_write_definitions(&writer, compiler->preprocessor);
+  pch_write_declarations(&writer, compiler, parsed);
+  uint64_t total_segments = vector_count(compiler->token_segments);
+  pch_write(&writer, &total_segments, sizeof(total_segments));
+  for (int i = 0; i < total_segments; i++) {
+    struct token_segment *segment = vector_at(compiler->token_segments, i);
+    struct pch_segment record = {
+        .filename = pch_string(&writer, segment->filename),
+        .total_tokens = segment->end - segment->start};
+    pch_write(&writer, &record, sizeof(record));
+    pch_write_tokens(&writer, segment->token_vec, segment->start,
+                     segment->end);
+  }
+
+  struct pch_header header = {.magic = PCH_MAGIC,
+                              .version = PCH_VERSION,
+                              .token_size = sizeof(struct pch_token),
+                              .total_strings = writer.count,
+                              .strings_size = writer.strings->len};
+  static const char padding[8] = {};
+  int res = -1;
+  FILE *file = fopen(filename, "wb");
+  if (file) {
+    size_t strings_padding = pch_align(header.strings_size) -
+                             header.strings_size;
+    if (fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(buffer_ptr(writer.strings), 1, header.strings_size, file) ==
+            header.strings_size &&
+        fwrite(padding, 1, strings_padding, file) == strings_padding &&
+        fwrite(buffer_ptr(writer.body), 1, writer.body->len, file) ==
+            writer.body->len) {
+      res = 0;
+    }
+
+    if (fclose(file) != 0) {
+      res = -1;
+    }
+  }
+
+  for (size_t i = 0; i < writer.indexes.capacity; i++) {
+    free((void *)writer.indexes.entries[i].key);
+  }
+  hashmap_free(&writer.indexes);
+  buffer_free(writer.body);
+  buffer_free(writer.strings);
+  return res;
+}
+
+static const void *pch_read(struct compile_process *compiler,
+                            struct pch_reader *reader, size_t size) {
+  if (reader->end - reader->ptr < size) {
+    compiler_error(compiler, "Precompiled header is truncated");
+  }
+
+  const void *ptr = reader->ptr;
+  reader->ptr += pch_align(size);
+  return ptr;
+}
+
+// reads total records of size bytes, the count is checked before it is
+// multiplied so a damaged count cannot wrap past the truncation check
+static const void *pch_read_array(struct compile_process *compiler,
+                                  struct pch_reader *reader, uint64_t total,
+                                  size_t size) {
+  if (size && total > (size_t)(reader->end - reader->ptr) / size) {
+    compiler_error(compiler, "Precompiled header is truncated");
+  }
+
+  return pch_read(compiler, reader, total * size);
+}
+
+static const char *pch_read_string(struct compile_process *compiler,
+                                   struct pch_reader *reader, uint32_t index) {
+  if (index == PCH_NO_STRING) {
+    return NULL;
+  }
+
+  if (index >= reader->total_strings) {
+    compiler_error(compiler, "Precompiled header is corrupt");
+  }
+
+  return reader->strings[index];
+}
+
+static struct vector *pch_read_tokens(struct compile_process *compiler,
+                                      struct pch_reader *reader,
+                                      uint64_t total) {
+  const struct pch_token *records =
+      pch_read_array(compiler, reader, total, sizeof(struct pch_token));
+  struct token *tokens = calloc(total, sizeof(struct token));
+  for (uint64_t i = 0; i < total; i++) {
+    const struct pch_token *record = &records[i];
+    struct token *token = &tokens[i];
+    token->type = record->type;
+    token->flags = record->flags;
+    token->whitespace = record->whitespace;
+    token->num.type = record->num_type;
+    token->pos.line = record->line;
+    token->pos.col = record->col;
+    token->pos.filename = pch_read_string(compiler, reader, record->filename);
+    if (token_type_has_text(record->type)) {
+      token->sval = pch_read_string(compiler, reader, record->value);
+    } else {
+      token->llnum = record->value;
+    }
+
+    token->source = pch_read_string(compiler, reader, record->source);
+    if (token->source) {
+      token->between_brackets = record->between_brackets;
+      token->between_args = record->between_args;
+    }
+  }
+
+  struct vector *token_vec = vector_create(sizeof(struct token));
+  vector_push_multiple(token_vec, tokens, total);
+  free(tokens);
+  return token_vec;
+}
+
+/**
+ * The tokens of each file come before those of the compile process in
+ * segments of their own, so -E writes them under their own file.
+ */
+static void pch_read_segments(struct compile_process *compiler,
+                              struct pch_reader *reader) {
+  uint64_t total = *(const uint64_t *)pch_read(compiler, reader,
+                                               sizeof(uint64_t));
+  for (uint64_t i = 0; i < total; i++) {
+    const struct pch_segment *record =
+        pch_read(compiler, reader, sizeof(struct pch_segment));
+    struct vector *token_vec =
+        pch_read_tokens(compiler, reader, record->total_tokens);
+    struct token_segment segment = {
+        .token_vec = token_vec,
+        .start = 0,
+        .end = vector_count(token_vec),
+        .filename = pch_read_string(compiler, reader, record->filename)};
+    vector_push(compiler->token_segments, &segment);
+  }
+}
+
+static void pch_read_files(struct compile_process *compiler,
+                           struct pch_reader *reader) {
+  struct preprocessor *preprocessor = compiler->preprocessor;
+  uint64_t total = *(const uint64_t *)pch_read(compiler, reader,
+                                               sizeof(uint64_t));
+  for (uint64_t i = 0; i < total; i++) {
+    const struct pch_file *file =
+        pch_read(compiler, reader, sizeof(struct pch_file));
+    const char *filename = pch_read_string(compiler, reader, file->filename);
+    if (file->on_disk) {
+      struct stat st;
+      if (stat(filename, &st) != 0 || st.st_mtim.tv_sec != file->mtime_sec ||
+          st.st_mtim.tv_nsec != file->mtime_nsec ||
+          (uint64_t)st.st_size != file->size) {
+        compiler_error(compiler,
+                       "Precompiled header is out of date, %s has changed",
+                       filename);
+      }
+    }
+
+    struct preprocessor_included_file *included_file = NULL;
+    PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION handler =
+        preprocessor_static_include_handler_for(filename);
+    if (!file->on_disk && handler) {
+      // static includes register their native functions again
+      preprocessor_create_static_include(preprocessor, filename, handler);
+      continue;
+    }
+
+    included_file = preprocessor_add_included_file(preprocessor, filename);
+    included_file->guard = pch_read_string(compiler, reader, file->guard);
+    included_file->once = file->once;
+  }
+}
+
+static void pch_read_definitions(struct compile_process *compiler,
+                                 struct pch_reader *reader) {
+  uint64_t total = *(const uint64_t *)pch_read(compiler, reader,
+                                               sizeof(uint64_t));
+  for (uint64_t i = 0; i < total; i++) {
+    const struct pch_definition *record =
+        pch_read(compiler, reader, sizeof(struct pch_definition));
+    const char *name = pch_read_string(compiler, reader, record->name);
+    struct vector *args = vector_create(sizeof(const char *));
+    if (record->total_args) {
+      if (record->arg_size != sizeof(const char *)) {
+        compiler_error(compiler, "Precompiled header is corrupt");
+      }
+
+      const char *data = pch_read_array(compiler, reader, record->total_args,
+                                        record->arg_size);
+      for (uint32_t arg = 0; arg < record->total_args; arg++) {
+        vector_push(args, (void *)&data[arg * record->arg_size]);
+      }
+    }
+
+    struct vector *value =
+        pch_read_tokens(compiler, reader, record->total_tokens);
+    preprocessor_definition_create(name, value, args, compiler->preprocessor);
+  }
+}
+
+struct pch_ast_reader {
+  struct pch_reader *reader;
+  const struct pch_ast_header *header;
+  const uint32_t *lists;
+  struct node **nodes;
+  struct datatype **datatypes;
+  struct function **functions;
+};
+
+static void pch_ast_corrupt(struct compile_process *compiler) {
+  compiler_error(compiler, "Precompiled header is corrupt");
+}
+
+static struct node *pch_ast_node_at(struct compile_process *compiler,
+                                    struct pch_ast_reader *ast,
+                                    uint32_t index) {
+  if (index == PCH_NO_INDEX) {
+    return NULL;
+  }
+
+  if (index >= ast->header->total_nodes) {
+    pch_ast_corrupt(compiler);
+  }
+
+  return ast->nodes[index];
+}
+
+static struct datatype *pch_ast_datatype_at(struct compile_process *compiler,
+                                            struct pch_ast_reader *ast,
+                                            uint32_t index) {
+  if (index == PCH_NO_INDEX) {
+    return NULL;
+  }
+
+  if (index >= ast->header->total_datatypes) {
+    pch_ast_corrupt(compiler);
+  }
+
+  return ast->datatypes[index];
+}
+
+static struct function *pch_ast_function_at(struct compile_process *compiler,
+                                            struct pch_ast_reader *ast,
+                                            uint32_t index) {
+  if (index >= ast->header->total_functions) {
+    pch_ast_corrupt(compiler);
+  }
+
+  return ast->functions[index];
+}
+
+static struct vector *pch_ast_list_at(struct compile_process *compiler,
+                                      struct pch_ast_reader *ast,
+                                      uint32_t offset) {
+  if (offset == PCH_NO_INDEX) {
+    return NULL;
+  }
+
+  uint32_t total_entries = ast->header->total_list_entries;
+  if (offset >= total_entries ||
+      ast->lists[offset] > total_entries - offset - 1) {
+    pch_ast_corrupt(compiler);
+  }
+
+  struct vector *vec = vector_create(sizeof(struct node *));
+  for (uint32_t i = 0; i < ast->lists[offset]; i++) {
+    struct node *node =
+        pch_ast_node_at(compiler, ast, ast->lists[offset + 1 + i]);
+    vector_push(vec, &node);
+  }
+
+  return vec;
+}
+
+static void pch_ast_read_node(struct compile_process *compiler,
+                              struct pch_ast_reader *ast,
+                              const struct pch_node *record,
+                              struct node *node) {
+  node->type = record->type;
+  node->flags = record->flags;
+  node->pos.line = record->line;
+  node->pos.col = record->col;
+  node->pos.filename = pch_read_string(compiler, ast->reader, record->filename);
+  node->binded.owner = pch_ast_node_at(compiler, ast, record->owner);
+  node->binded.function = pch_ast_node_at(compiler, ast, record->function);
+  const char *name = pch_read_string(compiler, ast->reader, record->name);
+  switch (record->type) {
+  case NODE_TYPE_EXPRESSION:
+    node->exp.op = name;
+    node->exp.left = pch_ast_node_at(compiler, ast, record->refs[0]);
+    node->exp.right = pch_ast_node_at(compiler, ast, record->refs[1]);
+    break;
+
+  case NODE_TYPE_EXPRESSION_PARENTHESIS:
+    node->paren.exp = pch_ast_node_at(compiler, ast, record->refs[0]);
+    break;
+
+  case NODE_TYPE_NUMBER:
+    node->llnum = record->value;
+    break;
+
+  case NODE_TYPE_IDENTIFIER:
+  case NODE_TYPE_STRING:
+    node->sval = name;
+    break;
+
+  case NODE_TYPE_VARIABLE:
+    node->var.name = name;
+    node->var.type = pch_ast_datatype_at(compiler, ast, record->refs[0]);
+    node->var.val = pch_ast_node_at(compiler, ast, record->refs[1]);
+    node->var.padding = record->ints[0];
+    node->var.aoffset = record->ints[1];
+    if (!node->var.type) {
+      pch_ast_corrupt(compiler);
+    }
+    break;
+
+  case NODE_TYPE_VARIABLE_LIST:
+    node->var_list.list = pch_ast_list_at(compiler, ast, record->refs[0]);
+    break;
+
+  case NODE_TYPE_FUNCTION:
+    node->func = pch_ast_function_at(compiler, ast, record->refs[0]);
+    break;
+
+  case NODE_TYPE_BODY:
+    node->body.statements = pch_ast_list_at(compiler, ast, record->refs[0]);
+    node->body.largest_variable_node =
+        pch_ast_node_at(compiler, ast, record->refs[1]);
+    node->body.padded = record->ints[0];
+    node->body.size = record->value;
+    break;
+
+  case NODE_TYPE_UNARY:
+    node->unary.op = name;
+    node->unary.operand = pch_ast_node_at(compiler, ast, record->refs[0]);
+    node->unary.flags = record->ints[0];
+    node->unary.indirection.depth = record->ints[1];
+    break;
+
+  case NODE_TYPE_TENARY:
+    node->tenary.true_node = pch_ast_node_at(compiler, ast, record->refs[0]);
+    node->tenary.false_node = pch_ast_node_at(compiler, ast, record->refs[1]);
+    break;
+
+  case NODE_TYPE_STRUCT:
+    node->_struct.name = name;
+    node->_struct.body_n = pch_ast_node_at(compiler, ast, record->refs[0]);
+    node->_struct.var = pch_ast_node_at(compiler, ast, record->refs[1]);
+    break;
+
+  case NODE_TYPE_UNION:
+    node->_union.name = name;
+    node->_union.body_n = pch_ast_node_at(compiler, ast, record->refs[0]);
+    node->_union.var = pch_ast_node_at(compiler, ast, record->refs[1]);
+    break;
+
+  case NODE_TYPE_BRACKET:
+    node->bracket.inner = pch_ast_node_at(compiler, ast, record->refs[0]);
+    break;
+
+  case NODE_TYPE_CAST:
+    node->cast.dtype = pch_ast_datatype_at(compiler, ast, record->refs[0]);
+    node->cast.exp = pch_ast_node_at(compiler, ast, record->refs[1]);
+    if (!node->cast.dtype) {
+      pch_ast_corrupt(compiler);
+    }
+    break;
+
+  case NODE_TYPE_BLANK:
+    break;
+
+  default:
+    pch_ast_corrupt(compiler);
+  }
+}
+
+static void pch_ast_read_datatype(struct compile_process *compiler,
+                                  struct pch_ast_reader *ast,
+                                  const struct pch_datatype *record,
+                                  struct datatype *dtype) {
+  dtype->flags = record->flags;
+  dtype->type = record->type;
+  dtype->secondary = pch_ast_datatype_at(compiler, ast, record->secondary);
+  dtype->type_str = pch_read_string(compiler, ast->reader, record->type_str);
+  dtype->size = record->size;
+  dtype->pointer_depth = record->pointer_depth;
+  dtype->struct_node = pch_ast_node_at(compiler, ast, record->struct_node);
+  dtype->array.size = record->array_size;
+  if (record->brackets != PCH_NO_INDEX) {
+    dtype->array.brackets = calloc(1, sizeof(struct array_brackets));
+    dtype->array.brackets->n_brackets =
+        pch_ast_list_at(compiler, ast, record->brackets);
+  }
+}
+
+static void pch_ast_read_function(struct compile_process *compiler,
+                                  struct pch_ast_reader *ast,
+                                  const struct pch_function *record,
+                                  struct function *func) {
+  struct datatype *rtype = pch_ast_datatype_at(compiler, ast, record->rtype);
+  if (!rtype) {
+    pch_ast_corrupt(compiler);
+  }
+
+  func->flags = record->flags;
+  func->rtype = *rtype;
+  func->name = pch_read_string(compiler, ast->reader, record->name);
+  func->args.args = pch_ast_list_at(compiler, ast, record->args);
+  func->args.stack_addition = record->stack_addition;
+  func->stack_size = record->stack_size;
+  func->stack_frame.elements =
+      vector_create(sizeof(struct stack_frame_element));
+}
+
+// the parser registers the variables it finds at file scope with the resolver
+static void pch_ast_register_global(struct compile_process *compiler,
+                                    struct node *node) {
+  switch (node->type) {
+  case NODE_TYPE_VARIABLE:
+    resolver_default_new_scope_entity(compiler->resolver, node,
+                                      node->var.aoffset, 0);
+    break;
+
+  case NODE_TYPE_VARIABLE_LIST:
+    for (int i = 0; i < vector_count(node->var_list.list); i++) {
+      pch_ast_register_global(
+          compiler, *(struct node **)vector_at(node->var_list.list, i));
+    }
+    break;
+
+  case NODE_TYPE_STRUCT:
+    if (node->_struct.var) {
+      pch_ast_register_global(compiler, node->_struct.var);
+    }
+    break;
+
+  case NODE_TYPE_UNION:
+    if (node->_union.var) {
+      pch_ast_register_global(compiler, node->_union.var);
+    }
+    break;
+  }
+}
+
+/**
+ * Reads the declarations written by pch_write_declarations(). They are only
+ * taken into the compile process when use is true, returns true if they were.
+ */
+static bool pch_read_declarations(struct compile_process *compiler,
+                                  struct pch_reader *reader, bool use) {
+  struct pch_ast_reader ast = {.reader = reader};
+  ast.header = pch_read(compiler, reader, sizeof(struct pch_ast_header));
+  const struct pch_ast_header *header = ast.header;
+  if (!header->present) {
+    return false;
+  }
+
+  const struct pch_node *node_records = pch_read_array(
+      compiler, reader, header->total_nodes, sizeof(struct pch_node));
+  const struct pch_datatype *datatype_records = pch_read_array(
+      compiler, reader, header->total_datatypes, sizeof(struct pch_datatype));
+  const struct pch_function *function_records = pch_read_array(
+      compiler, reader, header->total_functions, sizeof(struct pch_function));
+  ast.lists = pch_read_array(compiler, reader, header->total_list_entries,
+                             sizeof(uint32_t));
+  const uint32_t *roots =
+      pch_read_array(compiler, reader, header->total_roots, sizeof(uint32_t));
+  const struct pch_symbol *symbols = pch_read_array(
+      compiler, reader, header->total_symbols, sizeof(struct pch_symbol));
+  const struct pch_typedef *typedefs = pch_read_array(
+      compiler, reader, header->total_typedefs, sizeof(struct pch_typedef));
+  if (!use) {
+    return false;
+  }
+
+  // everything is allocated first so that the records can point anywhere
+  ast.nodes = malloc(sizeof(struct node *) * header->total_nodes);
+  for (uint32_t i = 0; i < header->total_nodes; i++) {
+    ast.nodes[i] = arena_alloc(compiler->node_arena, sizeof(struct node));
+  }
+
+  ast.datatypes = malloc(sizeof(struct datatype *) * header->total_datatypes);
+  for (uint32_t i = 0; i < header->total_datatypes; i++) {
+    ast.datatypes[i] =
+        arena_alloc(compiler->node_data_arena, sizeof(struct datatype));
+  }
+
+  ast.functions = malloc(sizeof(struct function *) * header->total_functions);
+  for (uint32_t i = 0; i < header->total_functions; i++) {
+    ast.functions[i] =
+        arena_alloc(compiler->node_data_arena, sizeof(struct function));
+  }
+
+  for (uint32_t i = 0; i < header->total_nodes; i++) {
+    pch_ast_read_node(compiler, &ast, &node_records[i], ast.nodes[i]);
+  }
+
+  for (uint32_t i = 0; i < header->total_datatypes; i++) {
+    pch_ast_read_datatype(compiler, &ast, &datatype_records[i],
+                          ast.datatypes[i]);
+  }
+
+  // return types are copied out of the datatypes so they are read last
+  for (uint32_t i = 0; i < header->total_functions; i++) {
+    pch_ast_read_function(compiler, &ast, &function_records[i],
+                          ast.functions[i]);
+  }
+
+  for (uint32_t i = 0; i < header->total_roots; i++) {
+    struct node *node = pch_ast_node_at(compiler, &ast, roots[i]);
+    if (!node) {
+      pch_ast_corrupt(compiler);
+    }
+
+    vector_push(compiler->node_tree_vec, &node);
+    pch_ast_register_global(compiler, node);
+  }
+
+  for (uint32_t i = 0; i < header->total_symbols; i++) {
+    struct node *node = pch_ast_node_at(compiler, &ast, symbols[i].node);
+    if (!node) {
+      pch_ast_corrupt(compiler);
+    }
+
+    symresolver_register_symbol(
+        compiler, pch_read_string(compiler, reader, symbols[i].name),
+        SYMBOL_TYPE_NODE, node);
+  }
+
+  for (uint32_t i = 0; i < header->total_typedefs; i++) {
+    struct datatype *dtype =
+        pch_ast_datatype_at(compiler, &ast, typedefs[i].dtype);
+    if (!dtype) {
+      pch_ast_corrupt(compiler);
+    }
+
+    if (!typedef_table_add(compiler->typedefs,
+                           pch_read_string(compiler, reader, typedefs[i].name),
+                           dtype)) {
+      pch_ast_corrupt(compiler);
+    }
+  }
+
+  free(ast.nodes);
+  free(ast.datatypes);
+  free(ast.functions);
+  return true;
+}
+
+int pch_load(struct compile_process *compiler, const char *filename) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(struct pch_header)) {
+    close(fd);
+    return -1;
+  }
+
+  size_t map_size = st.st_size;
+  const char *map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return -1;
+  }
+
+  const struct pch_header *header = (const struct pch_header *)map;
+  if (header->magic != PCH_MAGIC || header->version != PCH_VERSION ||
+      header->token_size != sizeof(struct pch_token) ||
+      sizeof(struct pch_header) + header->strings_size > map_size) {
+    munmap((void *)map, map_size);
+    return -1;
+  }
+
+  // every string is interned once, everything else refers to it by index
+  struct pch_reader reader = {};
+  reader.end = map + map_size;
+  reader.total_strings = header->total_strings;
+  reader.strings = malloc(sizeof(const char *) * header->total_strings);
+  const char *str = map + sizeof(struct pch_header);
+  const char *strings_end = str + header->strings_size;
+  for (uint32_t i = 0; i < header->total_strings; i++) {
+    size_t len = strnlen(str, strings_end - str);
+    if (str + len >= strings_end) {
+      compiler_error(compiler, "Precompiled header is corrupt");
+    }
+
+    reader.strings[i] = intern_table_add_len(compiler->strings, str, len);
+    str += len + 1;
+  }
+
+  reader.ptr = map + sizeof(struct pch_header) +
+               pch_align(header->strings_size);
+  pch_read_files(compiler, &reader);
+  pch_read_definitions(compiler, &reader);
+  // the tokens are only needed to preprocess or when there are no
+  // declarations to parse on from
+  if (!pch_read_declarations(compiler, &reader,
+                             !compiler->preprocess_output)) {
+    pch_read_segments(compiler, &reader);
+  }
+
+  free(reader.strings);
+  munmap((void *)map, map_size);
+  return 0;
+}
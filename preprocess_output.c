@@ -0,0 +1,209 @@
+#include "compiler.h"
+#include "helpers/vector.h"
+#include <ctype.h>
+#include <stdio.h>
+
+// a gap of more lines than this is closed with a line marker
+#define PREPROCESS_OUTPUT_MAX_BLANK_LINES 8
+
+void preprocess_output_init(struct preprocess_output *output, FILE *file) {
+  output->file = file;
+  output->segment = 0;
+  output->filename = NULL;
+  output->line = 0;
+  output->line_started = false;
+}
+
+static void preprocess_output_write_string(FILE *file, const char *str) {
+  fputc('"', file);
+  for (const char *ptr = str; *ptr; ptr++) {
+    unsigned char c = *ptr;
+    switch (c) {
+    case '\n':
+      fputs("\\n", file);
+      break;
+    case '\t':
+      fputs("\\t", file);
+      break;
+    case '\\':
+    case '"':
+      fputc('\\', file);
+      fputc(c, file);
+      break;
+    default:
+      if (isprint(c)) {
+        fputc(c, file);
+      } else {
+        fprintf(file, "\\%03o", c);
+      }
+      break;
+    }
+  }
+  fputc('"', file);
+}
+
+static void preprocess_output_write_token(FILE *file, struct token *token) {
+  switch (token->type) {
+  case TOKEN_TYPE_IDENTIFIER:
+  case TOKEN_TYPE_OPERATOR:
+  case TOKEN_TYPE_KEYWORD:
+    fputs(token->sval, file);
+    break;
+
+  case TOKEN_TYPE_STRING:
+    preprocess_output_write_string(file, token->sval);
+    break;
+
+  case TOKEN_TYPE_NUMBER: {
+    char spelling[TOKEN_NUMBER_SPELLING_MAX];
+    token_number_spelling(token, spelling);
+    fputs(spelling, file);
+    break;
+  }
+
+  case TOKEN_TYPE_SYMBOL:
+    fputc(token->cval, file);
+    break;
+  }
+}
+
+static bool preprocess_output_is_word(struct token *token) {
+  return token->type == TOKEN_TYPE_IDENTIFIER ||
+         token->type == TOKEN_TYPE_KEYWORD || token->type == TOKEN_TYPE_NUMBER;
+}
+
+static bool preprocess_output_is_joining_operator(struct token *token) {
+  return token->type == TOKEN_TYPE_OPERATOR &&
+         strchr("+-*/%&|^!<>=", token->sval[0]);
+}
+
+// tokens from macro expansions have no whitespace between them where the
+// text would otherwise read as a single token, .e.g a b or + +
+static bool preprocess_output_needs_space(struct token *last_token,
+                                          struct token *token) {
+  if (last_token->whitespace) {
+    return true;
+  }
+
+  return (preprocess_output_is_word(last_token) &&
+          preprocess_output_is_word(token)) ||
+         (preprocess_output_is_joining_operator(last_token) &&
+          preprocess_output_is_joining_operator(token));
+}
+
+static void preprocess_output_end_line(struct preprocess_output *output) {
+  if (output->line_started) {
+    fputc('\n', output->file);
+    output->line_started = false;
+  }
+}
+
+static void preprocess_output_line_marker(struct preprocess_output *output,
+                                          const char *filename, int line) {
+  preprocess_output_end_line(output);
+  fprintf(output->file, "# %i \"%s\"\n", line, filename);
+  output->filename = filename;
+  output->line = line;
+}
+
+static bool preprocess_output_is_blank(struct token *token) {
+  return token->type == TOKEN_TYPE_COMMENT ||
+         token->type == TOKEN_TYPE_NEWLINE;
+}
+
+// tokens expanded from a macro keep the position of its definition, only
+// tokens of the file at or past the current line say where the text is
+static bool preprocess_output_is_placed(struct preprocess_output *output,
+                                        struct token_segment *segment,
+                                        struct token *token) {
+  return !preprocess_output_is_blank(token) &&
+         token->pos.filename == segment->filename &&
+         token->pos.line >= output->line;
+}
+
+// index of the first placed token from index on, end of the segment if none
+static int preprocess_output_next_placed(struct preprocess_output *output,
+                                         struct token_segment *segment,
+                                         int index) {
+  while (index < segment->end &&
+         !preprocess_output_is_placed(output, segment,
+                                      vector_at(segment->token_vec, index))) {
+    index++;
+  }
+
+  return index;
+}
+
+static void preprocess_output_move_to(struct preprocess_output *output,
+                                      int line) {
+  if (line <= output->line) {
+    return;
+  }
+
+  if (line - output->line > PREPROCESS_OUTPUT_MAX_BLANK_LINES) {
+    preprocess_output_line_marker(output, output->filename, line);
+    return;
+  }
+
+  while (output->line < line) {
+    fputc('\n', output->file);
+    output->line++;
+  }
+  output->line_started = false;
+}
+
+static void preprocess_output_write_segment(struct preprocess_output *output,
+                                            struct token_segment *segment) {
+  // the tokens up to a placed token are written on its line
+  int placed = segment->start - 1;
+  for (int i = segment->start; i < segment->end; i++) {
+    struct token *token = vector_at(segment->token_vec, i);
+    if (preprocess_output_is_blank(token)) {
+      continue;
+    }
+
+    if (segment->filename != output->filename) {
+      // a segment that writes nothing leaves no line marker behind
+      output->line = 0;
+      placed = preprocess_output_next_placed(output, segment, i);
+      int line = placed < segment->end
+                     ? ((struct token *)vector_at(segment->token_vec, placed))
+                           ->pos.line
+                     : 1;
+      preprocess_output_line_marker(output, segment->filename, line);
+    }
+
+    if (placed < i) {
+      placed = preprocess_output_next_placed(output, segment, i);
+    }
+
+    if (placed < segment->end) {
+      preprocess_output_move_to(
+          output,
+          ((struct token *)vector_at(segment->token_vec, placed))->pos.line);
+    }
+
+    if (output->line_started &&
+        preprocess_output_needs_space(&output->last_token, token)) {
+      fputc(' ', output->file);
+    }
+
+    preprocess_output_write_token(output->file, token);
+    output->last_token = *token;
+    output->line_started = true;
+  }
+}
+
+void preprocess_output_write(struct preprocess_output *output,
+                             struct vector *token_segments) {
+  while (output->segment < vector_count(token_segments)) {
+    preprocess_output_write_segment(output,
+                                    vector_at(token_segments, output->segment));
+    output->segment++;
+  }
+}
+
+void preprocess_output_finish(struct preprocess_output *output) {
+  preprocess_output_end_line(output);
+  fflush(output->file);
+}
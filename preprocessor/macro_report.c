@@ -0,0 +1,105 @@
+#include "compiler.h"
+#include "helpers/vector.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// how many macros and files the report lists
+#define PREPROCESSOR_MACRO_REPORT_TOP 20
+
+static int preprocessor_macro_report_compare_defs(const void *a,
+                                                  const void *b) {
+  const struct preprocessor_definition *def_a =
+      *(struct preprocessor_definition *const *)a;
+  const struct preprocessor_definition *def_b =
+      *(struct preprocessor_definition *const *)b;
+  if (def_a->expanded_tokens != def_b->expanded_tokens) {
+    return def_a->expanded_tokens < def_b->expanded_tokens ? 1 : -1;
+  }
+
+  if (def_a->expansions != def_b->expansions) {
+    return def_a->expansions < def_b->expansions ? 1 : -1;
+  }
+
+  return 0;
+}
+
+static int preprocessor_macro_report_compare_files(const void *a,
+                                                   const void *b) {
+  const struct preprocessor_included_file *file_a =
+      *(struct preprocessor_included_file *const *)a;
+  const struct preprocessor_included_file *file_b =
+      *(struct preprocessor_included_file *const *)b;
+  if (file_a->tokens != file_b->tokens) {
+    return file_a->tokens < file_b->tokens ? 1 : -1;
+  }
+
+  if (file_a->times_included != file_b->times_included) {
+    return file_a->times_included < file_b->times_included ? 1 : -1;
+  }
+
+  return 0;
+}
+
+static void preprocessor_macro_report_defs(struct preprocessor *preprocessor,
+                                           FILE *file) {
+  int total = vector_count(preprocessor->expanded_defs);
+  fprintf(file, "%i macros expanded, top by tokens produced:\n", total);
+  if (!total) {
+    return;
+  }
+
+  struct preprocessor_definition **defs =
+      malloc(sizeof(struct preprocessor_definition *) * total);
+  memcpy(defs, vector_at(preprocessor->expanded_defs, 0),
+         sizeof(struct preprocessor_definition *) * total);
+  qsort(defs, total, sizeof(struct preprocessor_definition *),
+        preprocessor_macro_report_compare_defs);
+  fprintf(file, "%12s %12s  %s\n", "tokens", "expansions", "macro");
+  for (int i = 0; i < total && i < PREPROCESSOR_MACRO_REPORT_TOP; i++) {
+    fprintf(file, "%12zu %12zu  %s\n", defs[i]->expanded_tokens,
+            defs[i]->expansions, defs[i]->name);
+  }
+
+  free(defs);
+}
+
+static void preprocessor_macro_report_files(struct preprocessor *preprocessor,
+                                            FILE *file) {
+  int total = 0;
+  struct preprocessor_included_file **files = malloc(
+      sizeof(struct preprocessor_included_file *) *
+      (vector_count(preprocessor->includes) + 1));
+  for (int i = 0; i < vector_count(preprocessor->includes); i++) {
+    struct preprocessor_included_file *included_file =
+        *(struct preprocessor_included_file **)vector_at(
+            preprocessor->includes, i);
+    if (included_file->times_included) {
+      files[total++] = included_file;
+    }
+  }
+
+  fprintf(file, "%i files included, top by tokens contributed:\n", total);
+  qsort(files, total, sizeof(struct preprocessor_included_file *),
+        preprocessor_macro_report_compare_files);
+  if (total) {
+    fprintf(file, "%12s %12s  %s\n", "tokens", "includes", "file");
+  }
+
+  for (int i = 0; i < total && i < PREPROCESSOR_MACRO_REPORT_TOP; i++) {
+    fprintf(file, "%12zu %12zu  %s\n", files[i]->tokens,
+            files[i]->times_included, files[i]->filename);
+  }
+
+  free(files);
+}
+
+void preprocessor_macro_report(struct compile_process *compiler, FILE *file) {
+  struct preprocessor *preprocessor = compiler->preprocessor;
+  fprintf(file, "macro report for %s: %i tokens after preprocessing\n",
+          compiler->cfile.abs_path,
+          token_segments_count(compiler->token_segments));
+  fprintf(file, "%zu definition lookups, %zu of them not defined\n",
+          preprocessor->def_lookups, preprocessor->def_misses);
+  preprocessor_macro_report_defs(preprocessor, file);
+  preprocessor_macro_report_files(preprocessor, file);
+}
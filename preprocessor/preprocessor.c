@@ -3,19 +3,7 @@
 #include "helpers/vector.h"
 #include <assert.h>
 
-enum {
-  TYPEDEF_TYPE_STANDARD,
-  TYPEDEF_TYPE_STRUCT_TYPEDEF, // typedef struct { ... } name;
-};
-
-struct typedef_type {
-  int type;
-  const char *def_name;
-  struct vector *value;
-  struct typedef_struct {
-    const char *name;
-  } _struct;
-};
+#define PREPROCESSOR_DEFS_START_CAPACITY 256
 
 enum {
   PREPROCESSOR_FLAG_EVALUATE_NODE = 0b00000001,
@@ -111,12 +99,29 @@ struct preprocessor_included_file *
 preprocessor_add_included_file(struct preprocessor *preprocessor,
                                const char *filename) {
   struct preprocessor_included_file *included_file =
-      malloc(sizeof(struct preprocessor_included_file));
+      calloc(1, sizeof(struct preprocessor_included_file));
   strncpy(included_file->filename, filename, sizeof(included_file->filename));
   vector_push(preprocessor->includes, &included_file);
   return included_file;
 }
 
+struct preprocessor_included_file *
+preprocessor_get_included_file(struct preprocessor *preprocessor,
+                               const char *filename) {
+  vector_set_peek_pointer(preprocessor->includes, 0);
+  struct preprocessor_included_file *included_file =
+      vector_peek_ptr(preprocessor->includes);
+  while (included_file) {
+    if (S_EQ(included_file->filename, filename)) {
+      return included_file;
+    }
+
+    included_file = vector_peek_ptr(preprocessor->includes);
+  }
+
+  return NULL;
+}
+
 void preprocessor_create_static_include(
     struct preprocessor *preprocessor, const char *filename,
     PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION creation_handler) {
@@ -136,19 +141,6 @@ struct vector *preprocessor_build_value_vector_for_integer(int value) {
   return token_vec;
 }
 
-void preprocessor_token_vec_push_keyword_and_identifier(
-    struct vector *token_vec, const char *keyword, const char *identifier) {
-  struct token t1 = {};
-  t1.type = TOKEN_TYPE_KEYWORD;
-  t1.sval = keyword;
-  vector_push(token_vec, &t1);
-
-  struct token t2 = {};
-  t2.type = TOKEN_TYPE_IDENTIFIER;
-  t2.sval = identifier;
-  vector_push(token_vec, &t2);
-}
-
 void *preprocessor_node_create(struct preprocessor_node *node) {
   struct preprocessor_node *res = malloc(sizeof(struct preprocessor_node));
   memcpy(res, node, sizeof(struct preprocessor_node));
@@ -172,27 +164,73 @@ int preprocessor_definition_argument_exists(struct preprocessor_definition *def,
   return -1;
 }
 
+static void preprocessor_vector_pop_to(struct vector *vec, int count) {
+  while (vector_count(vec) > count) {
+    vector_pop(vec);
+  }
+}
+
+void preprocessor_function_args_init(struct preprocessor *preprocessor,
+                                     struct preprocessor_function_args *args) {
+  args->preprocessor = preprocessor;
+  args->start = vector_count(preprocessor->arg_stack);
+  args->total = 0;
+  args->token_start = vector_count(preprocessor->arg_token_stack);
+}
+
+// pops the arguments and their tokens off of the preprocessors stacks
+void preprocessor_function_args_free(struct preprocessor_function_args *args) {
+  struct preprocessor *preprocessor = args->preprocessor;
+  preprocessor_vector_pop_to(preprocessor->arg_stack, args->start);
+  preprocessor_vector_pop_to(preprocessor->arg_token_stack, args->token_start);
+}
+
 struct preprocessor_function_arg *
 preprocessor_function_argument_at(struct preprocessor_function_args *args,
                                   int index) {
-  return vector_at(args->args, index);
+  return vector_at(args->preprocessor->arg_stack, args->start + index);
+}
+
+// the tokens of the argument, only valid until the next token is pushed
+struct token *
+preprocessor_function_argument_tokens(struct preprocessor_function_args *args,
+                                      struct preprocessor_function_arg *arg) {
+  if (!arg->total) {
+    return NULL;
+  }
+
+  return vector_at(args->preprocessor->arg_token_stack, arg->start);
+}
+
+// the tokens pushed since the last argument ended make up the next argument
+void preprocessor_function_argument_push(
+    struct preprocessor_function_args *args) {
+  struct preprocessor *preprocessor = args->preprocessor;
+  struct preprocessor_function_arg arg = {};
+  arg.start = args->token_start;
+  if (args->total) {
+    struct preprocessor_function_arg *last =
+        preprocessor_function_argument_at(args, args->total - 1);
+    arg.start = last->start + last->total;
+  }
+
+  arg.total = vector_count(preprocessor->arg_token_stack) - arg.start;
+  vector_push(preprocessor->arg_stack, &arg);
+  args->total++;
 }
 
 void preprocessor_token_push_to_function_arguments(
     struct preprocessor_function_args *args, struct token *token) {
-  struct preprocessor_function_arg arg = {};
-  arg.tokens = vector_create(sizeof(struct token));
-  vector_push(arg.tokens, token);
-  vector_push(args->args, &arg);
+  vector_push(args->preprocessor->arg_token_stack, token);
+  preprocessor_function_argument_push(args);
 }
 
 void preprocessor_function_argument_push_to_vec(
+    struct preprocessor_function_args *args,
     struct preprocessor_function_arg *arg, struct vector *vec) {
-  vector_set_peek_pointer(arg->tokens, 0);
-  struct token *token = vector_peek(arg->tokens);
-  while (token) {
-    vector_push(vec, token);
-    token = vector_peek(arg->tokens);
+  if (arg->total) {
+    vector_push_multiple(vec, preprocessor_function_argument_tokens(args, arg),
+                         arg->total);
   }
 }
 
@@ -207,23 +245,6 @@ void preprocessor_token_push_dst(struct compile_process *compiler,
   preprocessor_token_push_to_dst(compiler->token_vec, token);
 }
 
-void preprocessor_token_vec_push_src_to_dst(struct compile_process *compiler,
-                                            struct vector *src_vec,
-                                            struct vector *dst_vec) {
-  vector_set_peek_pointer(src_vec, 0);
-  struct token *token = vector_peek(src_vec);
-  while (token) {
-    vector_push(dst_vec, token);
-    token = vector_peek(src_vec);
-  }
-}
-
-void preprocessor_token_vec_push_src(struct compile_process *compiler,
-                                     struct vector *src_vec) {
-  preprocessor_token_vec_push_src_to_dst(compiler, src_vec,
-                                         compiler->token_vec);
-}
-
 void preprocessor_token_vec_push_src_token(struct compile_process *compiler,
                                            struct token *token) {
   vector_push(compiler->token_vec, token);
@@ -231,9 +252,15 @@ void preprocessor_token_vec_push_src_token(struct compile_process *compiler,
 
 void preprocessor_init(struct preprocessor *preprocessor) {
   memset(preprocessor, 0, sizeof(struct preprocessor));
-  preprocessor->defs = vector_create(sizeof(struct preprocessor_definition *));
+  hashmap_init(&preprocessor->defs, PREPROCESSOR_DEFS_START_CAPACITY,
+               HASHMAP_STRING_KEYS);
   preprocessor->includes =
       vector_create(sizeof(struct preprocessor_included_file *));
+  preprocessor->expanded_defs =
+      vector_create(sizeof(struct preprocessor_definition *));
+  preprocessor->arg_stack =
+      vector_create(sizeof(struct preprocessor_function_arg));
+  preprocessor->arg_token_stack = vector_create(sizeof(struct token));
   preprocessor_create_defs(preprocessor);
 }
 
@@ -249,44 +276,37 @@ struct token *preprocessor_prev_token(struct compile_process *compiler) {
                         compiler->token_vec_original->pindex - 1);
 }
 
-struct token *preprocessor_next_token(struct compile_process *compiler) {
-  return vector_peek(compiler->token_vec_original);
-}
-
-struct token *
-preprocessor_next_token_no_increment(struct compile_process *compiler) {
-  return vector_peek_no_increment(compiler->token_vec_original);
-}
+// lexes the tokens up to the next conditional directive when the file is
+// lexed as it is preprocessed, returns false once there is nothing to lex
+static bool preprocessor_lex_more(struct compile_process *compiler) {
+  if (!compiler->lex_process) {
+    return false;
+  }
 
-struct token *
-preprocessor_peek_next_token_skip_nl(struct compile_process *compiler) {
-  struct token *token = preprocessor_next_token_no_increment(compiler);
-  while (token && token->type == TOKEN_TYPE_NEWLINE) {
-    token = preprocessor_next_token(compiler);
+  lex(compiler->lex_process);
+  if (compiler->cfile.offset >= compiler->cfile.size) {
+    compiler->lex_process = NULL;
   }
 
-  token = preprocessor_next_token_no_increment(compiler);
-  return token;
+  lex_prefetch_scan(compiler);
+
+  return true;
 }
 
-struct token *preprocessor_peek_next_token_with_vector_no_increment(
-    struct compile_process *compiler, struct vector *priority_token_vec,
-    bool overflow_use_compiler_tokens) {
-  struct token *token = vector_peek_no_increment(priority_token_vec);
-  if (!token && overflow_use_compiler_tokens) {
-    token = preprocessor_peek_next_token_skip_nl(compiler);
+struct token *preprocessor_next_token(struct compile_process *compiler) {
+  struct token *token = vector_peek(compiler->token_vec_original);
+  while (!token && preprocessor_lex_more(compiler)) {
+    token = vector_peek(compiler->token_vec_original);
   }
 
   return token;
 }
 
 struct token *
-preprocessor_peek_next_token_with_vector(struct compile_process *compiler,
-                                         struct vector *priority_token_vec,
-                                         bool overflow_use_compiler_tokens) {
-  struct token *token = vector_peek(priority_token_vec);
-  if (!token && overflow_use_compiler_tokens) {
-    token = preprocessor_peek_next_token_skip_nl(compiler);
+preprocessor_next_token_no_increment(struct compile_process *compiler) {
+  struct token *token = vector_peek_no_increment(compiler->token_vec_original);
+  while (!token && preprocessor_lex_more(compiler)) {
+    token = vector_peek_no_increment(compiler->token_vec_original);
   }
 
   return token;
@@ -415,28 +435,6 @@ const char *preprocessor_get_node_op(struct expressionable *expressionable,
   return preprocessor_node->exp.op;
 }
 
-void **preprocessor_get_left_node_address(struct expressionable *expressionable,
-                                          void *node) {
-  struct preprocessor_node *preprocessor_node = node;
-  return (void **)&preprocessor_node->exp.left;
-}
-
-void **
-preprocessor_get_right_node_address(struct expressionable *expressionable,
-                                    void *node) {
-  struct preprocessor_node *preprocessor_node = node;
-  return (void **)&preprocessor_node->exp.right;
-}
-
-void preprocessor_set_expression_node(struct expressionable *expressionable,
-                                      void *node, void *left, void *right,
-                                      const char *op) {
-  struct preprocessor_node *preprocessor_node = node;
-  preprocessor_node->exp.left = left;
-  preprocessor_node->exp.right = right;
-  preprocessor_node->exp.op = op;
-}
-
 bool preprocessor_should_join_nodes(struct expressionable *expressionable,
                                     void *prev_node, void *node) {
   return true;
@@ -481,9 +479,6 @@ struct expressionable_config preprocessor_expressionable_config = {
         .get_node_left = preprocessor_get_node_left,
         .get_node_right = preprocessor_get_node_right,
         .get_node_op = preprocessor_get_node_op,
-        .get_left_node_address = preprocessor_get_left_node_address,
-        .get_right_node_address = preprocessor_get_right_node_address,
-        .set_expression_node = preprocessor_set_expression_node,
         .should_join_nodes = preprocessor_should_join_nodes,
         .join_nodes = preprocessor_join_nodes,
         .expecting_additional_node = preprocessor_expecting_additional_node,
@@ -496,7 +491,7 @@ bool preprocessor_is_preprocessor_keyword(const char *keyword) {
          S_EQ(keyword, "if") || S_EQ(keyword, "ifdef") ||
          S_EQ(keyword, "ifndef") || S_EQ(keyword, "elif") ||
          S_EQ(keyword, "else") || S_EQ(keyword, "endif") ||
-         S_EQ(keyword, "include") || S_EQ(keyword, "typedef");
+         S_EQ(keyword, "include") || S_EQ(keyword, "pragma");
 }
 
 bool preprocessor_token_is_preprocessor_keyword(struct token *token) {
@@ -561,20 +556,20 @@ bool preprocessor_token_is_if(struct token *token) {
   return S_EQ(token->sval, "if");
 }
 
-bool preprocessor_token_is_typedef(struct token *token) {
+bool preprocessor_token_is_include(struct token *token) {
   if (!preprocessor_token_is_preprocessor_keyword(token)) {
     return false;
   }
 
-  return S_EQ(token->sval, "typedef");
+  return S_EQ(token->sval, "include");
 }
 
-bool preprocessor_token_is_include(struct token *token) {
+bool preprocessor_token_is_pragma(struct token *token) {
   if (!preprocessor_token_is_preprocessor_keyword(token)) {
     return false;
   }
 
-  return S_EQ(token->sval, "include");
+  return S_EQ(token->sval, "pragma");
 }
 
 struct buffer *
@@ -620,18 +615,18 @@ void preprocessor_multi_value_insert_to_vector(struct compile_process *compiler,
   }
 }
 
+static void preprocessor_definition_add(struct preprocessor *preprocessor,
+                                        struct preprocessor_definition *def) {
+  // the first definition of a name wins
+  if (hashmap_add(&preprocessor->defs, def->name, def)) {
+    preprocessor->generation++;
+  }
+}
+
 void preprocessor_definition_remove(struct preprocessor *preprocessor,
                                     const char *name) {
-  vector_set_peek_pointer(preprocessor->defs, 0);
-  struct preprocessor_definition *cur_def = vector_peek_ptr(preprocessor->defs);
-  while (cur_def) {
-    if (S_EQ(cur_def->name, name)) {
-      // remove definition
-      vector_pop_last_peek(preprocessor->defs);
-      return;
-    }
-
-    cur_def = vector_peek_ptr(preprocessor->defs);
+  if (hashmap_remove(&preprocessor->defs, name)) {
+    preprocessor->generation++;
   }
 }
 
@@ -643,17 +638,18 @@ preprocessor_definition_create(const char *name, struct vector *value,
   preprocessor_definition_remove(preprocessor, name);
 
   struct preprocessor_definition *def =
-      malloc(sizeof(struct preprocessor_definition));
+      calloc(1, sizeof(struct preprocessor_definition));
   def->type = PREPROCESSOR_DEFINITION_STANDARD;
   def->name = name;
   def->standard.value = value;
   def->standard.args = args;
+  def->standard.expansion = NULL;
   def->preprocessor = preprocessor;
   if (args && vector_count(def->standard.args)) {
     def->type = PREPROCESSOR_DEFINITION_MACRO_FUNCTION;
   }
 
-  vector_push(preprocessor->defs, &def);
+  preprocessor_definition_add(preprocessor, def);
   return def;
 }
 
@@ -662,44 +658,27 @@ struct preprocessor_definition *preprocessor_definition_create_native(
     PREPROCESSOR_DEFINITION_NATIVE_CALL_VALUE value,
     struct preprocessor *preprocessor) {
   struct preprocessor_definition *def =
-      malloc(sizeof(struct preprocessor_definition));
+      calloc(1, sizeof(struct preprocessor_definition));
   def->type = PREPROCESSOR_DEFINITION_NATIVE_CALLBACK;
   def->name = name;
   def->native.evaluate = evaluate;
   def->native.value = value;
   def->preprocessor = preprocessor;
-  vector_push(preprocessor->defs, &def);
-  return def;
-}
-
-struct preprocessor_definition *
-preprocessor_definition_create_typedef(const char *name,
-                                       struct vector *value_vec,
-                                       struct preprocessor *preprocessor) {
-  struct preprocessor_definition *def =
-      malloc(sizeof(struct preprocessor_definition));
-  def->type = PREPROCESSOR_DEFINITION_TYPEDEF;
-  def->name = name;
-  def->_typedef.value = value_vec;
-  def->preprocessor = preprocessor;
-  vector_push(preprocessor->defs, &def);
+  preprocessor_definition_add(preprocessor, def);
   return def;
 }
 
 struct preprocessor_definition *
 preprocessor_get_definition(struct preprocessor *preprocessor,
                             const char *name) {
-  vector_set_peek_pointer(preprocessor->defs, 0);
-  struct preprocessor_definition *def = vector_peek_ptr(preprocessor->defs);
-  while (def) {
-    if (S_EQ(def->name, name)) {
-      return def;
-    }
-
-    def = vector_peek_ptr(preprocessor->defs);
+  struct hashmap_entry *entry = hashmap_find(&preprocessor->defs, name);
+  preprocessor->def_lookups++;
+  if (!entry) {
+    preprocessor->def_misses++;
+    return NULL;
   }
 
-  return NULL;
+  return entry->value;
 }
 
 struct vector *preprocessor_definition_value_for_standard(
@@ -707,23 +686,10 @@ struct vector *preprocessor_definition_value_for_standard(
   return def->standard.value;
 }
 
-struct vector *preprocessor_definition_value_for_typedef_or_other(
-    struct preprocessor_definition *def) {
-  if (def->type != PREPROCESSOR_DEFINITION_TYPEDEF) {
-    return preprocessor_definition_value(def);
-  }
-
-  return def->_typedef.value;
-}
-
-struct vector *
-preprocessor_definition_value_for_typedef(struct preprocessor_definition *def) {
-  return preprocessor_definition_value_for_typedef_or_other(def);
-}
-
 struct vector *preprocessor_definition_value_for_native(
     struct preprocessor_definition *def,
     struct preprocessor_function_args *args) {
+  def->preprocessor->native_expansions++;
   return def->native.value(def, args);
 }
 
@@ -732,8 +698,6 @@ struct vector *preprocessor_definition_value_with_arguments(
     struct preprocessor_function_args *args) {
   if (def->type == PREPROCESSOR_DEFINITION_NATIVE_CALLBACK) {
     return preprocessor_definition_value_for_native(def, args);
-  } else if (def->type == PREPROCESSOR_DEFINITION_TYPEDEF) {
-    return preprocessor_definition_value_for_typedef(def);
   }
 
   return preprocessor_definition_value_for_standard(def);
@@ -907,21 +871,85 @@ void preprocessor_skip_to_endif(struct compile_process *compiler) {
   }
 }
 
+static bool preprocessor_is_hashtag_and_any_ending_clause(
+    struct compile_process *compiler) {
+  struct token *token = preprocessor_next_token_no_increment(compiler);
+  if (!token_is_symbol(token, '#')) {
+    return false;
+  }
+
+  struct token *name_token =
+      vector_peek_at(compiler->token_vec_original,
+                     compiler->token_vec_original->pindex + 1);
+  return name_token &&
+         (token_is_identifier(name_token) || name_token->type ==
+                                                 TOKEN_TYPE_KEYWORD) &&
+         (S_EQ(name_token->sval, "elif") || S_EQ(name_token->sval, "else") ||
+          S_EQ(name_token->sval, "endif"));
+}
+
+/**
+ * Moves past the inactive lines that follow a conditional directive up to the
+ * #elif, #else or #endif that ends them, which is left to be read. When the
+ * file is lexed as it is preprocessed the lexer skips the lines unlexed.
+ */
+void preprocessor_skip_inactive(struct compile_process *compiler) {
+  struct vector *token_vec = compiler->token_vec_original;
+  struct token *token = vector_peek_no_increment(token_vec);
+  while (token && token->type != TOKEN_TYPE_NEWLINE) {
+    vector_peek(token_vec);
+    token = vector_peek_no_increment(token_vec);
+  }
+
+  if (token) {
+    vector_peek(token_vec);
+  }
+
+  if (!vector_peek_no_increment(token_vec) && compiler->lex_process) {
+    lex_skip_inactive(compiler->lex_process);
+    return;
+  }
+
+  while (preprocessor_next_token_no_increment(compiler) &&
+         !preprocessor_is_hashtag_and_any_ending_clause(compiler)) {
+    if (preprocessor_is_hashtag_and_any_starting_if(compiler)) {
+      preprocessor_skip_to_endif(compiler);
+      continue;
+    }
+
+    preprocessor_next_token(compiler);
+  }
+}
+
 void preprocessor_read_to_endif(struct compile_process *compiler,
                                 bool true_clause) {
+  // once a clause was taken the rest up to the #endif is skipped
+  bool taken = true_clause;
+  if (!true_clause) {
+    preprocessor_skip_inactive(compiler);
+  }
+
   while (preprocessor_next_token_no_increment(compiler) &&
          !preprocessor_hashtag_and_identifier(compiler, "endif")) {
-    if (true_clause) {
-      preprocessor_handle_token(compiler, preprocessor_next_token(compiler));
+    if (preprocessor_hashtag_and_identifier(compiler, "else")) {
+      if (taken) {
+        preprocessor_skip_inactive(compiler);
+      }
+      taken = true;
       continue;
     }
 
-    // skip unexpanded tokens
-    preprocessor_next_token(compiler);
-
-    if (preprocessor_is_hashtag_and_any_starting_if(compiler)) {
-      preprocessor_skip_to_endif(compiler);
+    if (preprocessor_hashtag_and_identifier(compiler, "elif")) {
+      if (taken || preprocessor_parse_evaluate(
+                       compiler, compiler->token_vec_original) <= 0) {
+        preprocessor_skip_inactive(compiler);
+        continue;
+      }
+      taken = true;
+      continue;
     }
+
+    preprocessor_handle_token(compiler, preprocessor_next_token(compiler));
   }
 }
 
@@ -967,13 +995,6 @@ int preprocessor_arithmetic(struct compile_process *compiler, long left,
   return res;
 }
 
-struct preprocessor_function_args *preprocessor_function_args_create() {
-  struct preprocessor_function_args *args =
-      malloc(sizeof(struct preprocessor_function_args));
-  args->args = vector_create(sizeof(struct preprocessor_function_arg));
-  return args;
-}
-
 bool preprocessor_exp_is_macro_function_call(struct preprocessor_node *node) {
   return node->type == PREPROCESSOR_EXPRESSION_NODE &&
          S_EQ(node->exp.op, "()") &&
@@ -982,7 +1003,7 @@ bool preprocessor_exp_is_macro_function_call(struct preprocessor_node *node) {
 
 void preprocessor_number_push_to_function_arguments(
     struct preprocessor_function_args *args, int64_t value) {
-  struct token t;
+  struct token t = {};
   t.type = TOKEN_TYPE_NUMBER;
   t.llnum = value;
   preprocessor_token_push_to_function_arguments(args, &t);
@@ -1021,7 +1042,7 @@ int preprocessor_function_args_count(struct preprocessor_function_args *args) {
     return 0;
   }
 
-  return vector_count(args->args);
+  return args->total;
 }
 
 int preprocessor_macro_function_push_arg(
@@ -1031,7 +1052,8 @@ int preprocessor_macro_function_push_arg(
   int arg_index = preprocessor_definition_argument_exists(def, arg_name);
   if (arg_index != -1) {
     preprocessor_function_argument_push_to_vec(
-        preprocessor_function_argument_at(args, arg_index), value_vec_target);
+        args, preprocessor_function_argument_at(args, arg_index),
+        value_vec_target);
   }
 
   return arg_index;
@@ -1043,169 +1065,9 @@ void preprocessor_token_vec_push_src_token_to_dst(
   vector_push(dst_vec, token);
 }
 
-void preprocessor_handle_typedef_body_for_no_struct_or_union(
-    struct compile_process *compiler, struct vector *token_vec,
-    struct typedef_type *td, struct vector *src_vec,
-    bool overflow_use_token_vec) {
-  td->type = TYPEDEF_TYPE_STANDARD;
-  struct token *token = preprocessor_peek_next_token_with_vector(
-      compiler, src_vec, overflow_use_token_vec);
-  while (token) {
-    if (token_is_symbol(token, ';')) {
-      break;
-    }
-
-    preprocessor_token_vec_push_src_resolve_definition(compiler, src_vec,
-                                                       token_vec, token);
-    token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                     overflow_use_token_vec);
-  }
-}
-
-void preprocessor_handle_typedef_body_for_braces(
-    struct compile_process *compiler, struct vector *token_vec,
-    struct vector *src_vec, bool overflow_use_token_vec) {
-  struct token *token = preprocessor_peek_next_token_with_vector(
-      compiler, src_vec, overflow_use_token_vec);
-  while (token) {
-    if (token_is_symbol(token, '{')) {
-      vector_push(token_vec, token);
-      preprocessor_handle_typedef_body_for_braces(compiler, token_vec, src_vec,
-                                                  overflow_use_token_vec);
-      token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                       overflow_use_token_vec);
-      continue;
-    }
-
-    vector_push(token_vec, token);
-    if (token_is_symbol(token, '}')) {
-      break;
-    }
-
-    token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                     overflow_use_token_vec);
-  }
-}
-
-void preprocessor_handle_typedef_body_for_struct_or_union(
-    struct compile_process *compiler, struct vector *token_vec,
-    struct typedef_type *td, struct vector *src_vec,
-    bool overflow_use_token_vec) {
-  struct token *token = preprocessor_peek_next_token_with_vector(
-      compiler, src_vec, overflow_use_token_vec);
-  assert(token_is_keyword(token, "struct"));
-
-  td->type = TYPEDEF_TYPE_STRUCT_TYPEDEF;
-  // push struct keyword
-  vector_push(token_vec, token);
-
-  token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                   overflow_use_token_vec);
-
-  // do we have a name?
-  if (token->type == TOKEN_TYPE_IDENTIFIER) {
-    td->_struct.name = token->sval;
-    vector_push(token_vec, token);
-    token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                     overflow_use_token_vec);
-    if (token->type == TOKEN_TYPE_IDENTIFIER) {
-      // just declaration
-      vector_push(token_vec, token);
-      return;
-    }
-  }
-
-  // handle struct body
-  while (token) {
-    if (token_is_symbol(token, '{')) {
-      td->type = TYPEDEF_TYPE_STRUCT_TYPEDEF;
-      vector_push(token_vec, token);
-      preprocessor_handle_typedef_body_for_braces(compiler, token_vec, src_vec,
-                                                  overflow_use_token_vec);
-      token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                       overflow_use_token_vec);
-      continue;
-    }
-
-    if (token_is_symbol(token, ';')) {
-      break;
-    }
-
-    preprocessor_token_vec_push_src_resolve_definition(compiler, src_vec,
-                                                       token_vec, token);
-    token = preprocessor_peek_next_token_with_vector(compiler, src_vec,
-                                                     overflow_use_token_vec);
-  }
-}
-
-void preprocessor_handle_typedef_body(struct compile_process *compiler,
-                                      struct vector *token_vec,
-                                      struct typedef_type *td,
-                                      struct vector *src_vec,
-                                      bool overflow_use_token_vec) {
-  memset(td, 0, sizeof(struct typedef_type));
-
-  struct token *token = preprocessor_peek_next_token_with_vector_no_increment(
-      compiler, src_vec, overflow_use_token_vec);
-  if (token_is_keyword(token, "struct") || token_is_keyword(token, "union")) {
-    preprocessor_handle_typedef_body_for_struct_or_union(
-        compiler, token_vec, td, src_vec, overflow_use_token_vec);
-  } else {
-    preprocessor_handle_typedef_body_for_no_struct_or_union(
-        compiler, token_vec, td, src_vec, overflow_use_token_vec);
-  }
-}
-
-void preprocessor_token_push_semicolon(struct compile_process *compiler) {
-  struct token t1;
-  t1.type = TOKEN_TYPE_SYMBOL;
-  t1.cval = ';';
-  vector_push(compiler->token_vec, &t1);
-}
-
-void preprocessor_handle_typedef_token(struct compile_process *compiler,
-                                       struct vector *src_vec,
-                                       bool overflow_use_token_vec) {
-  // "typdef unsigned int x;"
-  struct vector *token_vec = vector_create(sizeof(struct token));
-  struct typedef_type td;
-  preprocessor_handle_typedef_body(compiler, token_vec, &td, src_vec,
-                                   overflow_use_token_vec);
-  struct token *name_token = vector_back_or_null(token_vec);
-  if (!name_token) {
-    compiler_error(compiler, "expected name");
-  }
-
-  if (name_token->type != TOKEN_TYPE_IDENTIFIER) {
-    compiler_error(compiler, "expected identifier");
-  }
-
-  td.def_name = name_token->sval;
-
-  // pop off name token
-  vector_pop(token_vec);
-
-  if (td.type == TYPEDEF_TYPE_STRUCT_TYPEDEF) {
-    preprocessor_token_vec_push_src(compiler, token_vec);
-    preprocessor_token_push_semicolon(compiler);
-
-    token_vec = vector_create(sizeof(struct token));
-    preprocessor_token_vec_push_keyword_and_identifier(token_vec, "struct",
-                                                       td._struct.name);
-  }
-
-  struct preprocessor *preprocessor = compiler->preprocessor;
-  preprocessor_definition_create_typedef(td.def_name, token_vec, preprocessor);
-}
-
 void preprocessor_token_vec_push_src_resolve_definition(
     struct compile_process *compiler, struct vector *src_vec,
     struct vector *dst_vec, struct token *token) {
-  if (preprocessor_token_is_typedef(token)) {
-    preprocessor_handle_typedef_token(compiler, src_vec, true);
-    return;
-  }
-
   if (token->type == TOKEN_TYPE_IDENTIFIER) {
     preprocessor_handle_identifier_for_token_vector(compiler, src_vec, dst_vec,
                                                     token);
@@ -1228,6 +1090,31 @@ void preprocessor_token_vec_push_src_resolve_definitions(
   }
 }
 
+static void preprocessor_count_expansion(struct compile_process *compiler,
+                                         struct preprocessor_definition *def,
+                                         int total_tokens) {
+  if (!(compiler->flags & COMPILE_PROCESS_MACRO_REPORT)) {
+    return;
+  }
+
+  if (!def->expansions) {
+    vector_push(compiler->preprocessor->expanded_defs, &def);
+  }
+
+  def->expansions++;
+  def->expanded_tokens += total_tokens;
+}
+
+// the tokens pushed past start for token end the way token did, .e.g the
+// space after b in a ## b = 1
+static void preprocessor_keep_whitespace(struct token *token,
+                                         struct vector *token_vec, int start) {
+  if (vector_count(token_vec) > start) {
+    struct token *last_token = vector_back(token_vec);
+    last_token->whitespace = token->whitespace;
+  }
+}
+
 int preprocessor_macro_function_push_something_definition(
     struct compile_process *compiler, struct preprocessor_definition *def,
     struct preprocessor_function_args *args, struct token *arg_token,
@@ -1237,9 +1124,11 @@ int preprocessor_macro_function_push_something_definition(
   }
 
   const char *arg_name = arg_token->sval;
+  int start = vector_count(value_vec_target);
   int res = preprocessor_macro_function_push_arg(
       compiler, def, args, arg_name, def_token_vec, value_vec_target);
   if (res != -1) {
+    preprocessor_keep_whitespace(arg_token, value_vec_target, start);
     return 0;
   }
 
@@ -1248,7 +1137,10 @@ int preprocessor_macro_function_push_something_definition(
       preprocessor_get_definition(compiler->preprocessor, arg_name);
   if (arg_def) {
     preprocessor_token_vec_push_src_resolve_definitions(
-        compiler, preprocessor_definition_value(arg_def), compiler->token_vec);
+        compiler, preprocessor_definition_value(arg_def), value_vec_target);
+    preprocessor_count_expansion(compiler, arg_def,
+                                 vector_count(value_vec_target) - start);
+    preprocessor_keep_whitespace(arg_token, value_vec_target, start);
     return 0;
   }
 
@@ -1281,15 +1173,44 @@ void preprocessor_handle_concat_part(struct compile_process *compiler,
                                      struct token *token,
                                      struct vector *def_token_vec,
                                      struct vector *value_vec_target) {
-  preprocessor_macro_function_push_something(compiler, def, args, token,
-                                             def_token_vec, value_vec_target);
+  int res = preprocessor_macro_function_push_something_definition(
+      compiler, def, args, token, def_token_vec, value_vec_target);
+  if (res == -1) {
+    vector_push(value_vec_target, token);
+  }
 }
 
 void preprocessor_handle_concat_finalize(struct compile_process *compiler,
-                                         struct vector *tmp_vec,
-                                         struct vector *value_vec_target) {
-  struct vector *joined_vec = tokens_join_vector(compiler, tmp_vec);
-  vector_insert(value_vec_target, joined_vec, 0);
+                                         struct vector *value_vec_target,
+                                         int left_start, int right_start) {
+  // only the last token of the left operand and the first of the right one
+  // are pasted, an empty operand pastes nothing
+  int total = vector_count(value_vec_target);
+  if (right_start == left_start || right_start >= total) {
+    return;
+  }
+
+  struct token left_token =
+      *(struct token *)vector_at(value_vec_target, right_start - 1);
+  struct token right_token =
+      *(struct token *)vector_at(value_vec_target, right_start);
+
+  // whatever follows the pair waits on the argument token stack while the
+  // pasted tokens take the place of the pair
+  struct vector *tail_vec = compiler->preprocessor->arg_token_stack;
+  int tail_start = vector_count(tail_vec);
+  if (total > right_start + 1) {
+    vector_push_multiple(tail_vec, vector_at(value_vec_target, right_start + 1),
+                         total - right_start - 1);
+  }
+
+  preprocessor_vector_pop_to(value_vec_target, right_start - 1);
+  tokens_paste(compiler, &left_token, &right_token, value_vec_target);
+  if (vector_count(tail_vec) > tail_start) {
+    vector_push_multiple(value_vec_target, vector_at(tail_vec, tail_start),
+                         vector_count(tail_vec) - tail_start);
+  }
+  preprocessor_vector_pop_to(tail_vec, tail_start);
 }
 
 void preprocessor_handle_concat(struct compile_process *compiler,
@@ -1307,12 +1228,15 @@ void preprocessor_handle_concat(struct compile_process *compiler,
     compiler_error(compiler, "Expected an operand");
   }
 
-  struct vector *tmp_vec = vector_create(sizeof(struct token));
+  int left_start = vector_count(value_vec_target);
   preprocessor_handle_concat_part(compiler, def, args, arg_token, def_token_vec,
-                                  tmp_vec);
-  preprocessor_handle_concat_part(compiler, def, args, right_token,
-                                  def_token_vec, tmp_vec);
-  preprocessor_handle_concat_finalize(compiler, tmp_vec, value_vec_target);
+                                  value_vec_target);
+  // the right operand may itself be pasted onto what follows it
+  int right_start = vector_count(value_vec_target);
+  preprocessor_macro_function_push_something(compiler, def, args, right_token,
+                                             def_token_vec, value_vec_target);
+  preprocessor_handle_concat_finalize(compiler, value_vec_target, left_start,
+                                      right_start);
 }
 
 void preprocessor_macro_function_push_something(
@@ -1353,12 +1277,18 @@ void preprocessor_handle_function_arg_to_string(
     compiler_error(compiler, "argument not found");
   }
 
-  struct token *first_token_for_argument = vector_peek_at(arg->tokens, 0);
+  // the argument as written in the source, spelled out from its tokens when
+  // the source text is not known
+  struct token *arg_tokens = preprocessor_function_argument_tokens(args, arg);
+  const char *text = arg_tokens ? token_between_brackets(arg_tokens) : NULL;
+  if (!text) {
+    text = tokens_spelling(compiler, arg_tokens, arg->total);
+  }
 
   // create string token
-  struct token str_token;
+  struct token str_token = {};
   str_token.type = TOKEN_TYPE_STRING;
-  str_token.sval = first_token_for_argument->between_brackets;
+  str_token.sval = text;
   vector_push(value_vec_target, &str_token);
 }
 
@@ -1384,7 +1314,14 @@ int preprocessor_macro_function_execute(struct compile_process *compiler,
                    func_name);
   }
 
-  struct vector *value_vec_target = vector_create(sizeof(struct token));
+  // the expansion is written straight to the output, only a value that is
+  // evaluated needs a vector of its own
+  struct vector *value_vec_target = compiler->token_vec;
+  if (flags & PREPROCESSOR_FLAG_EVALUATE_NODE) {
+    value_vec_target = vector_create(sizeof(struct token));
+  }
+
+  int start = vector_count(value_vec_target);
   struct vector *def_token_vec =
       preprocessor_definition_value_with_arguments(def, args);
   vector_set_peek_pointer(def_token_vec, 0);
@@ -1402,11 +1339,14 @@ int preprocessor_macro_function_execute(struct compile_process *compiler,
     token = vector_peek(def_token_vec);
   }
 
+  preprocessor_count_expansion(compiler, def,
+                               vector_count(value_vec_target) - start);
   if (flags & PREPROCESSOR_FLAG_EVALUATE_NODE) {
-    return preprocessor_parse_evaluate(compiler, value_vec_target);
+    int res = preprocessor_parse_evaluate(compiler, value_vec_target);
+    vector_free(value_vec_target);
+    return res;
   }
 
-  preprocessor_token_vec_push_src(compiler, value_vec_target);
   return 0;
 }
 
@@ -1414,13 +1354,16 @@ int preprocessor_evaluate_function_call(struct compile_process *compiler,
                                         struct preprocessor_node *node) {
   const char *macro_func_name = node->exp.left->sval;
   struct preprocessor_node *call_args = node->exp.right->paren_node.exp;
-  struct preprocessor_function_args *args = preprocessor_function_args_create();
+  struct preprocessor_function_args args;
+  preprocessor_function_args_init(compiler->preprocessor, &args);
 
   // evaluate preprocessor arguments
-  preprocessor_evaluate_function_call_args(compiler, call_args, args);
+  preprocessor_evaluate_function_call_args(compiler, call_args, &args);
 
-  return preprocessor_macro_function_execute(compiler, macro_func_name, args,
-                                             PREPROCESSOR_FLAG_EVALUATE_NODE);
+  int res = preprocessor_macro_function_execute(
+      compiler, macro_func_name, &args, PREPROCESSOR_FLAG_EVALUATE_NODE);
+  preprocessor_function_args_free(&args);
+  return res;
 }
 
 int preprocessor_evaluate_exp(struct compile_process *compiler,
@@ -1600,14 +1543,72 @@ preprocessor_next_token_skip_nl(struct compile_process *compiler) {
   return token;
 }
 
+void preprocessor_handle_pragma_token(struct compile_process *compiler) {
+  struct token *token = preprocessor_next_token(compiler);
+  if (token_is_identifier(token) && S_EQ(token->sval, "once")) {
+    struct preprocessor_included_file *included_file =
+        preprocessor_get_included_file(compiler->preprocessor,
+                                       compiler->cfile.abs_path);
+    included_file->once = true;
+  }
+
+  // other pragmas are ignored
+  while (token && token->type != TOKEN_TYPE_NEWLINE) {
+    token = preprocessor_next_token(compiler);
+  }
+}
+
+static bool preprocessor_include_is_skipped(struct preprocessor *preprocessor,
+                                            const char *path) {
+  struct preprocessor_included_file *included_file =
+      preprocessor_get_included_file(preprocessor, path);
+  if (!included_file) {
+    return false;
+  }
+
+  return included_file->once ||
+         (included_file->guard &&
+          preprocessor_get_definition(preprocessor, included_file->guard));
+}
+
+static void
+preprocessor_count_include(struct compile_process *compiler,
+                           struct compile_process *included_process) {
+  if (!(compiler->flags & COMPILE_PROCESS_MACRO_REPORT)) {
+    return;
+  }
+
+  struct preprocessor_included_file *included_file =
+      preprocessor_get_included_file(compiler->preprocessor,
+                                     included_process->cfile.abs_path);
+  included_file->times_included++;
+  // the files it included were counted when they were included
+  for (int i = 0; i < vector_count(included_process->token_segments); i++) {
+    struct token_segment *segment =
+        vector_at(included_process->token_segments, i);
+    if (segment->token_vec == included_process->token_vec) {
+      included_file->tokens += segment->end - segment->start;
+    }
+  }
+}
+
 void preprocessor_handle_include_token(struct compile_process *compiler) {
   struct token *file_path_token = preprocessor_next_token_skip_nl(compiler);
   if (!file_path_token) {
     compiler_error(compiler, "expected file path");
   }
 
+  // a file seen before whose guard is still defined would preprocess to
+  // nothing, so it is not opened again
+  bool angle_brackets = file_path_token->flags & TOKEN_FLAG_ANGLE_INCLUDE;
+  const char *path =
+      compile_include_resolve(file_path_token->sval, angle_brackets, compiler);
+  if (path && preprocessor_include_is_skipped(compiler->preprocessor, path)) {
+    return;
+  }
+
   struct compile_process *new_compile_process =
-      compile_include(file_path_token->sval, compiler);
+      compile_include(file_path_token->sval, angle_brackets, compiler);
   if (!new_compile_process) {
     PREPROCESSOR_STATIC_INCLUDE_HANDLER_POST_CREATION handler =
         preprocessor_static_include_handler_for(file_path_token->sval);
@@ -1621,7 +1622,8 @@ void preprocessor_handle_include_token(struct compile_process *compiler) {
     compiler_error(compiler, "failed to include file");
   }
 
-  preprocessor_token_vec_push_src(compiler, new_compile_process->token_vec);
+  compile_process_splice_tokens(compiler, new_compile_process);
+  preprocessor_count_include(compiler, new_compile_process);
 }
 
 int preprocessor_handle_hashtag_token(struct compile_process *compiler,
@@ -1652,6 +1654,9 @@ int preprocessor_handle_hashtag_token(struct compile_process *compiler,
   } else if (preprocessor_token_is_include(next_token)) {
     preprocessor_handle_include_token(compiler);
     is_preprocessed = true;
+  } else if (preprocessor_token_is_pragma(next_token)) {
+    preprocessor_handle_pragma_token(compiler);
+    is_preprocessed = true;
   }
 
   return is_preprocessed;
@@ -1671,8 +1676,8 @@ void preprocessor_handle_symbol(struct compile_process *compiler,
 
 struct token *preprocessor_handle_identifier_macro_call_arg_parse_paren(
     struct compile_process *compiler, struct vector *src_vec,
-    struct vector *value_vec, struct preprocessor_function_args *args,
-    struct token *left_paren_token) {
+    struct preprocessor_function_args *args, struct token *left_paren_token) {
+  struct vector *value_vec = args->preprocessor->arg_token_stack;
   // push left paren
   vector_push(value_vec, left_paren_token);
 
@@ -1680,7 +1685,7 @@ struct token *preprocessor_handle_identifier_macro_call_arg_parse_paren(
   while (next_token && !token_is_symbol(next_token, ')')) {
     if (token_is_operator(next_token, "(")) {
       next_token = preprocessor_handle_identifier_macro_call_arg_parse_paren(
-          compiler, src_vec, value_vec, args, next_token);
+          compiler, src_vec, args, next_token);
     }
 
     vector_push(value_vec, next_token);
@@ -1696,62 +1701,96 @@ struct token *preprocessor_handle_identifier_macro_call_arg_parse_paren(
   return vector_peek(src_vec);
 }
 
-void preprocessor_function_argument_push(
-    struct preprocessor_function_args *args, struct vector *value_vec) {
-  struct preprocessor_function_arg arg;
-  arg.tokens = vector_clone(value_vec);
-  vector_push(args->args, &arg);
-}
-
 void preprocessor_handle_identifier_macro_call_arg(
-    struct preprocessor_function_args *args, struct vector *token_vec) {
-  preprocessor_function_argument_push(args, token_vec);
+    struct preprocessor_function_args *args) {
+  preprocessor_function_argument_push(args);
 }
 
 struct token *preprocessor_handle_identifier_macro_call_arg_parse(
     struct compile_process *compiler, struct vector *src_vec,
-    struct vector *value_vec, struct preprocessor_function_args *args,
-    struct token *token) {
+    struct preprocessor_function_args *args, struct token *token) {
   if (token_is_operator(token, "(")) {
     return preprocessor_handle_identifier_macro_call_arg_parse_paren(
-        compiler, src_vec, value_vec, args, token);
+        compiler, src_vec, args, token);
   }
 
   if (token_is_symbol(token, ')')) {
     // end of arguments
-    preprocessor_handle_identifier_macro_call_arg(args, value_vec);
+    preprocessor_handle_identifier_macro_call_arg(args);
     return NULL;
   }
 
   if (token_is_operator(token, ",")) {
     // next argument
-    preprocessor_handle_identifier_macro_call_arg(args, value_vec);
-    vector_clear(value_vec);
+    preprocessor_handle_identifier_macro_call_arg(args);
     return vector_peek(src_vec);
   }
 
-  vector_push(value_vec, token);
+  vector_push(args->preprocessor->arg_token_stack, token);
   token = vector_peek(src_vec);
   return token;
 }
 
-struct preprocessor_function_args *
-preprocessor_handle_identifier_macro_call_args(struct compile_process *compiler,
-                                               struct vector *src_vec) {
+// the arguments are pushed onto the preprocessors stacks, the caller frees
+// them once the call is expanded
+void preprocessor_handle_identifier_macro_call_args(
+    struct compile_process *compiler, struct vector *src_vec,
+    struct preprocessor_function_args *args) {
   // skip (
   vector_peek(src_vec);
 
-  struct preprocessor_function_args *args = preprocessor_function_args_create();
+  preprocessor_function_args_init(compiler->preprocessor, args);
   struct token *token = vector_peek(src_vec);
-  struct vector *value_vec = vector_create(sizeof(struct token));
   while (token) {
     token = preprocessor_handle_identifier_macro_call_arg_parse(
-        compiler, src_vec, value_vec, args, token);
+        compiler, src_vec, args, token);
   }
+}
 
-  vector_free(value_vec);
+/**
+ * Pushes the fully expanded value of an object-like macro. The expansion is
+ * kept with the definition and pushed in one go until a definition is added
+ * or removed. Expansions that reach native definitions or push tokens
+ * elsewhere are expanded every time.
+ */
+static void preprocessor_push_expansion(struct compile_process *compiler,
+                                        struct preprocessor_definition *def,
+                                        struct vector *dst_vec) {
+  struct preprocessor *preprocessor = compiler->preprocessor;
+  struct vector *expansion = def->standard.expansion;
+  if (expansion && def->standard.expansion_generation ==
+                       preprocessor->generation) {
+    if (!vector_empty(expansion)) {
+      vector_push_multiple(dst_vec, vector_at(expansion, 0),
+                           vector_count(expansion));
+    }
+    return;
+  }
+
+  unsigned int generation = preprocessor->generation;
+  size_t native_expansions = preprocessor->native_expansions;
+  int start = vector_count(dst_vec);
+  int token_vec_start = vector_count(compiler->token_vec);
+  preprocessor_token_vec_push_src_resolve_definitions(
+      compiler, def->standard.value, dst_vec);
+  if (preprocessor->generation != generation ||
+      preprocessor->native_expansions != native_expansions ||
+      (dst_vec != compiler->token_vec &&
+       vector_count(compiler->token_vec) != token_vec_start)) {
+    return;
+  }
 
-  return args;
+  if (!expansion) {
+    expansion = vector_create(sizeof(struct token));
+    def->standard.expansion = expansion;
+  }
+
+  vector_clear(expansion);
+  int end = vector_count(dst_vec);
+  if (end > start) {
+    vector_push_multiple(expansion, vector_at(dst_vec, start), end - start);
+  }
+  def->standard.expansion_generation = generation;
 }
 
 int preprocessor_handle_identifier_for_token_vector(
@@ -1765,23 +1804,31 @@ int preprocessor_handle_identifier_for_token_vector(
     return -1;
   }
 
-  if (def->type == PREPROCESSOR_DEFINITION_TYPEDEF) {
-    preprocessor_token_vec_push_src_to_dst(
-        compiler, preprocessor_definition_value(def), dst_vec);
-    return 0;
-  }
-
   if (token_is_operator(vector_peek_no_increment(src_vec), "(")) {
-    struct preprocessor_function_args *args =
-        preprocessor_handle_identifier_macro_call_args(compiler, src_vec);
+    struct preprocessor_function_args args;
+    preprocessor_handle_identifier_macro_call_args(compiler, src_vec, &args);
+    // the expansion ends the way the ) of the call did
+    struct token *close_token = vector_at(src_vec, src_vec->pindex - 1);
     const char *func_name = token->sval;
-    preprocessor_macro_function_execute(compiler, func_name, args, 0);
+    int start = vector_count(compiler->token_vec);
+    preprocessor_macro_function_execute(compiler, func_name, &args, 0);
+    preprocessor_function_args_free(&args);
+    if (token_is_symbol(close_token, ')')) {
+      preprocessor_keep_whitespace(close_token, compiler->token_vec, start);
+    }
     return 0;
   }
 
-  struct vector *def_val = preprocessor_definition_value(def);
-  preprocessor_token_vec_push_src_resolve_definitions(
-      compiler, preprocessor_definition_value(def), dst_vec);
+  int start = vector_count(dst_vec);
+  if (def->type == PREPROCESSOR_DEFINITION_STANDARD) {
+    preprocessor_push_expansion(compiler, def, dst_vec);
+  } else {
+    preprocessor_token_vec_push_src_resolve_definitions(
+        compiler, preprocessor_definition_value(def), dst_vec);
+  }
+
+  preprocessor_count_expansion(compiler, def, vector_count(dst_vec) - start);
+  preprocessor_keep_whitespace(token, dst_vec, start);
   return 0;
 }
 
@@ -1793,12 +1840,6 @@ int preprocessor_handle_identifier(struct compile_process *compiler,
 
 void preprocessor_handle_keyword(struct compile_process *compiler,
                                  struct token *token) {
-  if (preprocessor_token_is_typedef(token)) {
-    preprocessor_handle_typedef_token(compiler, compiler->token_vec_original,
-                                      false);
-    return;
-  }
-
   preprocessor_token_push_dst(compiler, token);
 }
 
@@ -1827,9 +1868,111 @@ void preprocessor_handle_token(struct compile_process *compiler,
   }
 }
 
+static bool preprocessor_token_is_blank(struct token *token) {
+  return token->type == TOKEN_TYPE_NEWLINE ||
+         token->type == TOKEN_TYPE_COMMENT;
+}
+
+static int preprocessor_skip_blank_tokens(struct vector *token_vec,
+                                          int index) {
+  while (index < vector_count(token_vec) &&
+         preprocessor_token_is_blank(vector_at(token_vec, index))) {
+    index++;
+  }
+
+  return index;
+}
+
+static bool preprocessor_is_directive_at(struct vector *token_vec, int index,
+                                         const char *str) {
+  if (index + 1 >= vector_count(token_vec) ||
+      !token_is_symbol(vector_at(token_vec, index), '#')) {
+    return false;
+  }
+
+  struct token *token = vector_at(token_vec, index + 1);
+  return (token_is_identifier(token) && S_EQ(token->sval, str)) ||
+         token_is_keyword(token, str);
+}
+
+static bool preprocessor_is_if_directive_at(struct vector *token_vec,
+                                            int index) {
+  return preprocessor_is_directive_at(token_vec, index, "if") ||
+         preprocessor_is_directive_at(token_vec, index, "ifdef") ||
+         preprocessor_is_directive_at(token_vec, index, "ifndef");
+}
+
+// returns the name following the directive at index, NULL if there is none
+static const char *preprocessor_directive_name_at(struct vector *token_vec,
+                                                  int index, const char *str) {
+  if (!preprocessor_is_directive_at(token_vec, index, str)) {
+    return NULL;
+  }
+
+  struct token *token = vector_peek_at(token_vec, index + 2);
+  if (!token_is_identifier(token)) {
+    return NULL;
+  }
+
+  return token->sval;
+}
+
+/**
+ * Returns the macro of an #ifndef X / #define X ... #endif that wraps the
+ * whole file with nothing but comments and newlines outside of it, NULL if
+ * the file has no such guard.
+ */
+static const char *preprocessor_include_guard(struct vector *token_vec) {
+  int index = preprocessor_skip_blank_tokens(token_vec, 0);
+  const char *guard =
+      preprocessor_directive_name_at(token_vec, index, "ifndef");
+  if (!guard) {
+    return NULL;
+  }
+
+  index = preprocessor_skip_blank_tokens(token_vec, index + 3);
+  const char *define =
+      preprocessor_directive_name_at(token_vec, index, "define");
+  if (!define || !S_EQ(define, guard)) {
+    return NULL;
+  }
+
+  // the #endif that closes the #ifndef must be the last thing in the file,
+  // with an #else or #elif of the #ifndef the file has text either way
+  int depth = 1;
+  int total = vector_count(token_vec);
+  for (index += 3; index < total && depth > 0; index++) {
+    if (preprocessor_is_if_directive_at(token_vec, index)) {
+      depth++;
+      index++;
+    } else if (preprocessor_is_directive_at(token_vec, index, "endif")) {
+      depth--;
+      index++;
+    } else if (depth == 1 &&
+               (preprocessor_is_directive_at(token_vec, index, "else") ||
+                preprocessor_is_directive_at(token_vec, index, "elif"))) {
+      return NULL;
+    }
+  }
+
+  if (depth != 0 || preprocessor_skip_blank_tokens(token_vec, index) != total) {
+    return NULL;
+  }
+
+  return guard;
+}
+
 int preprocessor_run(struct compile_process *compiler) {
-  preprocessor_add_included_file(compiler->preprocessor,
-                                 compiler->cfile.abs_path);
+  struct preprocessor_included_file *included_file =
+      preprocessor_get_included_file(compiler->preprocessor,
+                                     compiler->cfile.abs_path);
+  if (!included_file) {
+    included_file = preprocessor_add_included_file(compiler->preprocessor,
+                                                   compiler->cfile.abs_path);
+  }
+
+  // start on the files this one includes before preprocessing it
+  lex_prefetch_scan(compiler);
   vector_set_peek_pointer(compiler->token_vec_original, 0);
   struct token *token = preprocessor_next_token(compiler);
   while (token) {
@@ -1837,5 +1980,9 @@ int preprocessor_run(struct compile_process *compiler) {
     token = preprocessor_next_token(compiler);
   }
 
+  // remembered so the next #include of this file can be skipped
+  included_file->guard =
+      preprocessor_include_guard(compiler->token_vec_original);
+  compile_process_close_token_segment(compiler);
   return PREPROCESS_ALL_OK;
 }
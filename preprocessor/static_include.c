@@ -17,3 +17,29 @@ preprocessor_static_include_handler_for(const char *filename) {
 
   return NULL;
 }
+
+const struct preprocessor_embedded_include *
+preprocessor_embedded_include_for(const char *filename) {
+  for (const struct preprocessor_embedded_include *include =
+           preprocessor_embedded_includes;
+       include->name; include++) {
+    if (S_EQ(include->name, filename)) {
+      return include;
+    }
+  }
+
+  return NULL;
+}
+
+const struct preprocessor_embedded_include *
+preprocessor_embedded_include_for_path(const char *path) {
+  for (const struct preprocessor_embedded_include *include =
+           preprocessor_embedded_includes;
+       include->name; include++) {
+    if (S_EQ(include->path, path)) {
+      return include;
+    }
+  }
+
+  return NULL;
+}
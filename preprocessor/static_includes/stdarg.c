@@ -31,7 +31,7 @@ void native_va_start(struct generator *generator, struct native_function *func,
   generator->asm_push("mov dword [%s], ebx", address_out.address);
   generator->asm_push("; va_start end for %s", stack_arg->sval);
 
-  struct datatype void_datatype;
+  struct datatype void_datatype = {};
   datatype_set_void(&void_datatype);
   generator->ret(&void_datatype, "0");
 }
@@ -57,7 +57,7 @@ void native_builtin_va_arg(struct generator *generator,
 
   generator->asm_push("add dword [ebx], %d", size_arg->llnum);
   generator->asm_push("mov dword eax, [ebx]");
-  struct datatype void_dtype;
+  struct datatype void_dtype = {};
   datatype_set_void(&void_dtype);
   void_dtype.pointer_depth++;
   void_dtype.flags |= DATATYPE_FLAG_IS_POINTER;
@@ -85,7 +85,7 @@ void native_va_end(struct generator *generator, struct native_function *func,
   generator->asm_push("mov dword [ebx], 0");
   generator->asm_push("; va_end end for %s", list_arg->sval);
 
-  struct datatype void_datatype;
+  struct datatype void_datatype = {};
   datatype_set_void(&void_datatype);
   generator->ret(&void_datatype, "0");
 }
@@ -124,7 +124,7 @@ resolver_default_new_entity_data_for_function(struct node *func_node,
       resolver_default_new_entity_data();
   entity_data->flags = flags;
   entity_data->type = RESOLVER_DEFAULT_ENTITY_DATA_TYPE_FUNCTION;
-  resolver_default_global_asm_address(func_node->func.name, 0,
+  resolver_default_global_asm_address(func_node->func->name, 0,
                                       entity_data->address);
   return entity_data;
 }
@@ -363,8 +363,8 @@ struct resolver_entity *resolver_create_new_entity_for_var_node_custom_scope(
   entity->scope = scope;
   assert(entity->scope);
   entity->name = var_node->var.name;
-  entity->dtype = var_node->var.type;
-  entity->var_data.dtype = var_node->var.type;
+  entity->dtype = *var_node->var.type;
+  entity->var_data.dtype = *var_node->var.type;
   entity->node = var_node;
   entity->offset_from_bp = offset;
   return entity;
@@ -475,9 +475,9 @@ resolver_register_function(struct resolver_process *process,
     return NULL;
   }
 
-  entity->name = func_node->func.name;
+  entity->name = func_node->func->name;
   entity->node = func_node;
-  entity->dtype = func_node->func.rtype;
+  entity->dtype = func_node->func->rtype;
   entity->scope = resolver_process_scope_current(process);
   vector_push(process->scopes.root->entities, &entity);
   return entity;
@@ -898,8 +898,8 @@ struct resolver_entity *resolver_follow_cast(struct resolver_process *process,
   operand_entity->flags |= RESOLVER_ENTITY_FLAG_WAS_CASTED;
 
   struct resolver_entity *cast_entity = resolver_create_new_cast_entity(
-      process, operand_entity->scope, &node->cast.dtype);
-  if (datatype_is_struct_or_union(&node->cast.dtype)) {
+      process, operand_entity->scope, node->cast.dtype);
+  if (datatype_is_struct_or_union(node->cast.dtype)) {
     if (!cast_entity->scope) {
       cast_entity->scope = process->scopes.current;
     }
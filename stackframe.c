@@ -3,12 +3,12 @@
 #include <assert.h>
 
 void stackframe_pop(struct node *func_node) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   vector_pop(frame->elements);
 }
 
 struct stack_frame_element *stackframe_back(struct node *func_node) {
-  return vector_back_or_null(func_node->func.stack_frame.elements);
+  return vector_back_or_null(func_node->func->stack_frame.elements);
 }
 
 struct stack_frame_element *stackframe_back_expect(struct node *func_node,
@@ -25,7 +25,7 @@ struct stack_frame_element *stackframe_back_expect(struct node *func_node,
 
 void stackframe_pop_expecting(struct node *func_node, int expecting_type,
                               const char *expecting_name) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   struct stack_frame_element *last_element = stackframe_back(func_node);
   assert(last_element);
   assert(last_element->type == expecting_type &&
@@ -34,19 +34,19 @@ void stackframe_pop_expecting(struct node *func_node, int expecting_type,
 }
 
 void stackframe_peek_start(struct node *func_node) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   vector_set_peek_pointer_end(frame->elements);
   vector_set_flag(frame->elements, VECTOR_FLAG_PEEK_DECREMENT);
 }
 
 struct stack_frame_element *stackframe_peek(struct node *func_node) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   return vector_peek(frame->elements);
 }
 
 void stackframe_push(struct node *func_node,
                      struct stack_frame_element *element) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   // stack grows downwards
   element->offset_from_bp = -(vector_count(frame->elements) * STACK_PUSH_SIZE);
   vector_push(frame->elements, element);
@@ -72,6 +72,6 @@ void stackframe_add(struct node *func_node, int type, const char *name,
 }
 
 void stackframe_assert_empty(struct node *func_node) {
-  struct stack_frame *frame = &func_node->func.stack_frame;
+  struct stack_frame *frame = &func_node->func->stack_frame;
   assert(vector_count(frame->elements) == 0);
 }
@@ -84,7 +84,7 @@ void symresolver_build_for_variable_node(struct compile_process *process,
 
 void symresolver_build_for_function_node(struct compile_process *process,
                                          struct node *node) {
-  symresolver_register_symbol(process, node->func.name, SYMBOL_TYPE_NODE, node);
+  symresolver_register_symbol(process, node->func->name, SYMBOL_TYPE_NODE, node);
 }
 
 void symresolver_build_for_struct_node(struct compile_process *process,
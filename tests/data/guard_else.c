@@ -0,0 +1,2 @@
+#include "guard_else.h"
+#include "guard_else.h"
@@ -0,0 +1,6 @@
+#ifndef GH
+#define GH
+int first;
+#else
+int second;
+#endif
@@ -0,0 +1,8 @@
+#include "inactive_literal.h"
+
+int start;
+#if 0
+char *message = "never closed;
+char quote = 'x;
+#endif
+int end;
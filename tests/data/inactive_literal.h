@@ -0,0 +1,4 @@
+#if 0
+char *header_message = "never closed;
+#endif
+int header_end;
@@ -0,0 +1,4 @@
+// each part.h includes the name.h next to it, found from outside of the
+// directory of this file
+#include "include_dir/one/part.h"
+#include "include_dir/two/part.h"
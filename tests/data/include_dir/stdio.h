@@ -0,0 +1 @@
+int local_stdio;
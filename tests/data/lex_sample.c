@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include "lex_sample.h"
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define SQUARE(x) ((x) * (x))
+#define LONG_MACRO(a, b, c)                                                    \
+  do {                                                                         \
+    a = b + c;                                                                 \
+  } while (0)
+
+/*
+ * comment that spans
+ * a few lines, "with a string" and 'a quote'
+ */
+struct point {
+  int x;
+  int y;
+  char *name;
+};
+
+// a line comment with ( brackets and "quotes"
+static const char *messages[] = {"hello\n", "tab\there", "quote \" inside",
+                                 "slash // not a comment", "/* nor this */"};
+
+int numbers[] = {0, 10, 0x1F, 0xff, 0b1011, 12345L, 3f, 'a', '\n', '\''};
+
+int sum(int a, int b) { return a + b; }
+
+int compute(struct point *p, int count) {
+  int total = 0;
+  for (int i = 0; i < count; i++) {
+    total += sum(p[i].x, MAX(p[i].y, SQUARE(i)));
+    total -= p->x << 2 >> 1;
+    total = total != 0 && (total >= 3 || total <= -3) ? total : ~total;
+    total ^= total | (total & 0x0f) % 7;
+  }
+
+  if (sum(compute(p, count - 1), sum(1,
+                                      2)) == 3) {
+    LONG_MACRO(total, count, sum(1, 2));
+  }
+
+  return total;
+}
+
+int main(int argc, char **argv) {
+  struct point points[3];
+  points[0].x = 1;	points[0].y = 2;
+  printf("%d %s\n", compute(points, 3), messages[argc % 5]);
+  return (argc > 1) ? numbers[argc] : 0;
+}
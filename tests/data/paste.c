@@ -0,0 +1,8 @@
+#define CAT(a, b) a ## b
+#define CAT_SET(a, b) a ## b = 1
+int CAT(foo, bar) = 2;
+int CAT_SET(foo, bar);
+int CAT(X, 0x10UL);
+int CAT(Y, 0b101);
+int CAT(Z, 10L);
+int a = 1 CAT(-, =) 2;
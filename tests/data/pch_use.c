@@ -0,0 +1,2 @@
+#include "pch_prefix.h"
+int main() { return shared; }
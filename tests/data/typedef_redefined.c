@@ -0,0 +1,3 @@
+typedef int count_t;
+typedef char count_t;
+int main() { return 0; }
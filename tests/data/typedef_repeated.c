@@ -0,0 +1,6 @@
+typedef int count_t;
+typedef int count_t;
+struct point { int x; };
+typedef struct point point_t;
+typedef struct point point_t;
+int main() { count_t total = 1; return total; }
@@ -0,0 +1,122 @@
+#include "tests/harness.h"
+#include "helpers/vector.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int harness_checks;
+static int harness_failures;
+
+struct compile_process *harness_process(const char *filename, int flags) {
+  struct compile_process *process =
+      compile_process_create(filename, NULL, flags, NULL);
+  if (!process) {
+    fprintf(stderr, "cannot open %s\n", filename);
+    exit(1);
+  }
+
+  return process;
+}
+
+struct compile_process *harness_process_for_data(char *data, size_t size,
+                                                 int flags) {
+  struct compile_process *process =
+      compile_process_create_lexed("<harness>", data, size, flags, NULL);
+  // the lexed process starts past the end, this one has everything to lex
+  process->cfile.offset = 0;
+  return process;
+}
+
+struct vector *harness_lex(struct compile_process *process) {
+  struct lex_process *lex_process =
+      lex_process_create(process, &compiler_lex_functions, NULL);
+  if (lex(lex_process) != LEXICAL_ANALYSIS_ALL_OK) {
+    fprintf(stderr, "lexing %s failed\n", process->cfile.abs_path);
+    exit(1);
+  }
+
+  return lex_process_tokens(lex_process);
+}
+
+struct vector *harness_lex_file(const char *filename, int flags) {
+  return harness_lex(harness_process(filename, flags));
+}
+
+static bool harness_token_equal(struct token *a, struct token *b) {
+  if (a->type != b->type || a->flags != b->flags ||
+      a->whitespace != b->whitespace || a->num.type != b->num.type ||
+      a->pos.line != b->pos.line || a->pos.col != b->pos.col ||
+      !a->source != !b->source || a->between_brackets != b->between_brackets ||
+      a->between_args != b->between_args) {
+    return false;
+  }
+
+  // the text may be interned in different tables
+  if (token_type_has_text(a->type)) {
+    return a->sval == b->sval || S_EQ(a->sval, b->sval);
+  }
+
+  return a->llnum == b->llnum;
+}
+
+static void harness_print_token(const char *name, struct token *token) {
+  fprintf(stderr, "  %s: type %i line %i col %i ws %i brackets %i args %i ",
+          name, token->type, token->pos.line, token->pos.col,
+          token->whitespace, token->between_brackets, token->between_args);
+  if (token_type_has_text(token->type)) {
+    fprintf(stderr, "\"%s\"\n", token->sval);
+  } else {
+    fprintf(stderr, "%llu\n", token->llnum);
+  }
+}
+
+bool harness_tokens_equal(struct vector *expected, struct vector *actual,
+                          const char *what) {
+  int total = vector_count(expected);
+  for (int i = 0; i < total && i < vector_count(actual); i++) {
+    struct token *a = vector_at(expected, i);
+    struct token *b = vector_at(actual, i);
+    if (!harness_token_equal(a, b)) {
+      harness_check(false, "%s: token %i differs", what, i);
+      harness_print_token("expected", a);
+      harness_print_token("actual", b);
+      return false;
+    }
+  }
+
+  if (total != vector_count(actual)) {
+    harness_check(false, "%s: %i tokens, expected %i", what,
+                  vector_count(actual), total);
+    return false;
+  }
+
+  harness_check(true, "%s", what);
+  return true;
+}
+
+void harness_check(bool ok, const char *msg, ...) {
+  harness_checks++;
+  if (ok) {
+    return;
+  }
+
+  harness_failures++;
+  va_list args;
+  va_start(args, msg);
+  fprintf(stderr, "FAIL: ");
+  vfprintf(stderr, msg, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+}
+
+int harness_finish(const char *name) {
+  printf("%s: %i checks, %i failed\n", name, harness_checks,
+         harness_failures);
+  return harness_failures ? 1 : 0;
+}
+
+double harness_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,40 @@
+#ifndef TESTS_HARNESS_H
+#define TESTS_HARNESS_H
+
+#include "compiler.h"
+
+/**
+ * Helpers shared by the lexer tests and benchmarks. Every test lexes its
+ * input the plain way with lex() and checks that the path under test gives
+ * the very same tokens.
+ */
+
+// compile process for the file, nothing is lexed yet
+struct compile_process *harness_process(const char *filename, int flags);
+
+// compile process lexing data as the whole source, data is taken over
+struct compile_process *harness_process_for_data(char *data, size_t size,
+                                                 int flags);
+
+// lexes the whole source of a new compile process with lex()
+struct vector *harness_lex(struct compile_process *process);
+struct vector *harness_lex_file(const char *filename, int flags);
+
+/**
+ * Returns true if both vectors have the same tokens with the same text,
+ * values, positions, flags and offsets. The first difference is reported
+ * with what as the name of the path being tested.
+ */
+bool harness_tokens_equal(struct vector *expected, struct vector *actual,
+                          const char *what);
+
+// reports a failed check, the test goes on to the next one
+void harness_check(bool ok, const char *msg, ...);
+
+// prints the summary, returns the exit status of the test
+int harness_finish(const char *name);
+
+// seconds on a monotonic clock
+double harness_now();
+
+#endif
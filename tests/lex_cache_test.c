@@ -0,0 +1,88 @@
+#include "helpers/vector.h"
+#include "tests/harness.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+static struct vector *lex_cache_test_load(const char *filename) {
+  return lex_cache_load(
+      harness_process(filename, COMPILE_PROCESS_TOKEN_CACHE));
+}
+
+static void lex_cache_test_write(const char *filename, const char *data,
+                                 size_t size) {
+  FILE *file = fopen(filename, "wb");
+  if (!file || fwrite(data, 1, size, file) != size || fclose(file) != 0) {
+    fprintf(stderr, "cannot write %s\n", filename);
+    exit(1);
+  }
+}
+
+/**
+ * A damaged cache either does not load, so the file is lexed again, or gives
+ * exactly the tokens lexing gives. Returns true if it did not load.
+ */
+static bool lex_cache_test_damaged(const char *filename,
+                                   struct vector *expected, const char *what) {
+  struct vector *tokens = lex_cache_test_load(filename);
+  if (!tokens) {
+    return true;
+  }
+
+  harness_tokens_equal(expected, tokens, what);
+  vector_free(tokens);
+  return false;
+}
+
+static void lex_cache_test_file(const char *filename) {
+  struct compile_process *process =
+      harness_process(filename, COMPILE_PROCESS_TOKEN_CACHE);
+  struct vector *expected = harness_lex(process);
+  lex_cache_store(process, expected);
+
+  struct vector *cached = lex_cache_test_load(filename);
+  harness_check(cached != NULL, "%s: nothing cached", filename);
+  if (!cached) {
+    return;
+  }
+
+  harness_tokens_equal(expected, cached, filename);
+
+  char cache[PATH_MAX];
+  lex_cache_filename(process->cfile.abs_path, cache, sizeof(cache));
+  FILE *file = fopen(cache, "rb");
+  size_t size = 0;
+  char *data = compile_process_read_file(file, &size);
+  fclose(file);
+
+  // every byte flipped in turn, then the file cut short at every 8 bytes
+  char what[PATH_MAX + 64];
+  size_t rejected = 0;
+  for (size_t i = 0; i < size; i++) {
+    data[i] ^= 0xff;
+    lex_cache_test_write(cache, data, size);
+    data[i] ^= 0xff;
+    snprintf(what, sizeof(what), "%s with byte %zu flipped", filename, i);
+    rejected += lex_cache_test_damaged(filename, expected, what);
+  }
+
+  // the checksum covers every byte
+  harness_check(rejected == size, "%s: %zu of %zu flipped bytes loaded",
+                filename, size - rejected, size);
+
+  for (size_t i = 0; i < size; i += 8) {
+    lex_cache_test_write(cache, data, i);
+    snprintf(what, sizeof(what), "%s cut at %zu bytes", filename, i);
+    harness_check(lex_cache_test_load(filename) == NULL, "%s", what);
+  }
+
+  unlink(cache);
+  free(data);
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    lex_cache_test_file(argv[i]);
+  }
+
+  return harness_finish("lex_cache_test");
+}
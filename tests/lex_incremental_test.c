@@ -0,0 +1,205 @@
+#include "helpers/vector.h"
+#include "tests/harness.h"
+#include <stdlib.h>
+
+#define LEX_INCREMENTAL_TEST_RANDOM_EDITS 300
+
+// text the random edits insert, none of it can start a comment or a quote
+static const char *lex_incremental_test_fragments[] = {
+    "", "", "x", " ", "\n", "abc ", "(1 + 2)", "+", "42", "0x1f", "foo(a, b)",
+    ";", "->", "<<=", "\"str\"", "\t", "{", "}", "sum(", ")"};
+
+static unsigned int lex_incremental_test_seed = 1;
+
+// the same numbers on every libc
+static unsigned int lex_incremental_test_random(unsigned int range) {
+  lex_incremental_test_seed =
+      lex_incremental_test_seed * 1103515245 + 12345;
+  return (lex_incremental_test_seed >> 16) % range;
+}
+
+static char *lex_incremental_test_apply(struct compile_process *process,
+                                        struct lex_edit *edit,
+                                        size_t *size_out) {
+  size_t text_len = strlen(edit->text);
+  size_t size = process->cfile.size - edit->length + text_len;
+  char *data = malloc(size + 1);
+  memcpy(data, process->cfile.data, edit->offset);
+  memcpy(&data[edit->offset], edit->text, text_len);
+  memcpy(&data[edit->offset + text_len],
+         &process->cfile.data[edit->offset + edit->length],
+         process->cfile.size - edit->offset - edit->length);
+  data[size] = 0x00;
+  *size_out = size;
+  return data;
+}
+
+// lexes data from scratch, NULL if it does not lex
+static struct vector *lex_incremental_test_full_lex(char *data, size_t size) {
+  jmp_buf error_jmp;
+  if (setjmp(error_jmp)) {
+    compiler_error_jmp = NULL;
+    return NULL;
+  }
+
+  compiler_error_jmp = &error_jmp;
+  struct vector *tokens = harness_lex(harness_process_for_data(data, size, 0));
+  compiler_error_jmp = NULL;
+  return tokens;
+}
+
+/**
+ * Re-lexes after the edit and compares with lexing the edited source from
+ * scratch. Edits that leave a source the lexer rejects are skipped, returns
+ * the new tokens.
+ */
+static struct vector *lex_incremental_test_edit(struct compile_process *process,
+                                                struct vector *tokens,
+                                                struct lex_edit *edit) {
+  size_t size = 0;
+  char *data = lex_incremental_test_apply(process, edit, &size);
+  struct vector *expected = lex_incremental_test_full_lex(data, size);
+  if (!expected) {
+    return tokens;
+  }
+
+  jmp_buf error_jmp;
+  if (setjmp(error_jmp)) {
+    compiler_error_jmp = NULL;
+    harness_check(false, "relex failed at offset %zu", edit->offset);
+    exit(harness_finish("lex_incremental_test"));
+  }
+
+  compiler_error_jmp = &error_jmp;
+  struct vector *relexed = lex_relex(process, tokens, edit);
+  compiler_error_jmp = NULL;
+
+  char what[128];
+  snprintf(what, sizeof(what), "edit at %zu replacing %zu bytes with \"%s\"",
+           edit->offset, edit->length, edit->text);
+  harness_check(process->cfile.size == size &&
+                    memcmp(process->cfile.data, data, size) == 0,
+                "%s: the source is not the edited one", what);
+  harness_tokens_equal(expected, relexed, what);
+  return relexed;
+}
+
+// where the edit starts, NULL for the start of the source and "" for its end
+struct lex_incremental_test_edit {
+  const char *at;
+  size_t length;
+  const char *text;
+};
+
+static size_t lex_incremental_test_find(struct compile_process *process,
+                                        const char *text) {
+  if (!text) {
+    return 0;
+  }
+
+  const char *found = strstr(process->cfile.data, text);
+  if (!found) {
+    fprintf(stderr, "the sample has no \"%s\"\n", text);
+    exit(1);
+  }
+
+  return found - process->cfile.data;
+}
+
+static void lex_incremental_test_edits(const char *filename) {
+  struct compile_process *process = harness_process(filename, 0);
+  struct vector *tokens = harness_lex(process);
+
+  // edits inside of and around brackets, strings, comments and arguments
+  struct lex_incremental_test_edit edits[] = {
+      {"total = 0", 5, "count"},
+      {"sum(1,", 3, "compute"},
+      {"2)) == 3", 0, "(1 + 1) * "},
+      {"hello\\n", 5, "bye"},
+      {"a few lines", 0, "*/ int a; /*"},
+      {"// a line", 2, "/* x */"},
+      {"0x1F", 4, "0b11"},
+      {"int main", 0, "\n\n"},
+      {"p->x", 4, "(p)->x"},
+      {NULL, 0, "int first;\n"},
+      {"", 0, "\nint last;"}};
+  for (size_t i = 0; i < sizeof(edits) / sizeof(edits[0]); i++) {
+    // found in the source as the edits before left it
+    struct lex_edit edit = {
+        .offset = lex_incremental_test_find(process, edits[i].at),
+        .length = edits[i].length,
+        .text = edits[i].text};
+    if (edits[i].at && !*edits[i].at) {
+      edit.offset = process->cfile.size;
+    }
+
+    tokens = lex_incremental_test_edit(process, tokens, &edit);
+  }
+
+  size_t total_fragments = sizeof(lex_incremental_test_fragments) /
+                           sizeof(lex_incremental_test_fragments[0]);
+  for (int i = 0; i < LEX_INCREMENTAL_TEST_RANDOM_EDITS; i++) {
+    struct lex_edit edit = {};
+    edit.offset = lex_incremental_test_random(process->cfile.size + 1);
+    edit.length = lex_incremental_test_random(8);
+    if (edit.offset + edit.length > process->cfile.size) {
+      edit.length = process->cfile.size - edit.offset;
+    }
+
+    edit.text =
+        lex_incremental_test_fragments[lex_incremental_test_random(
+            total_fragments)];
+    tokens = lex_incremental_test_edit(process, tokens, &edit);
+  }
+}
+
+// the position of a token is just past it, also after the lexer looked ahead
+static void lex_incremental_test_positions(const char *source) {
+  char *data = strdup(source);
+  struct vector *tokens =
+      harness_lex(harness_process_for_data(data, strlen(data), 0));
+  for (int i = 0; i < vector_count(tokens); i++) {
+    struct token *token = vector_at(tokens, i);
+    if (token->type != TOKEN_TYPE_IDENTIFIER) {
+      continue;
+    }
+
+    const char *line = data;
+    for (int j = 1; j < token->pos.line && line; j++) {
+      line = strchr(line, '\n');
+      line = line ? line + 1 : NULL;
+    }
+
+    if (!line) {
+      harness_check(false, "\"%s\" is on line %i past the end of \"%s\"",
+                    token->sval, token->pos.line, source);
+      continue;
+    }
+
+    size_t len = strlen(token->sval);
+    const char *end = line + token->pos.col - 1;
+    harness_check(end - len >= data &&
+                      strncmp(end - len, token->sval, len) == 0,
+                  "\"%s\" is not just before line %i col %i of \"%s\"",
+                  token->sval, token->pos.line, token->pos.col, source);
+  }
+}
+
+int main(int argc, char **argv) {
+  // each of these reads a character past an operator, number or comment and
+  // pushes it back
+  lex_incremental_test_positions("a<b c");
+  lex_incremental_test_positions("x->y z");
+  lex_incremental_test_positions("a/b c");
+  lex_incremental_test_positions("p-- -q r");
+  lex_incremental_test_positions("a<<=b c");
+  lex_incremental_test_positions("/* c */d e\nf // g\nh");
+  lex_incremental_test_positions("x = 10L + 0x1f; y");
+  lex_incremental_test_positions("f(a, b)\n  (c) d");
+
+  for (int i = 1; i < argc; i++) {
+    lex_incremental_test_edits(argv[i]);
+  }
+
+  return harness_finish("lex_incremental_test");
+}
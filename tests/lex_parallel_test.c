@@ -0,0 +1,36 @@
+#include "helpers/vector.h"
+#include "tests/harness.h"
+#include <stdlib.h>
+
+static struct vector *lex_parallel_test_lex(const char *filename, int chunks) {
+  struct compile_process *process =
+      harness_process(filename, COMPILE_PROCESS_PARALLEL_LEX);
+  struct lex_process *lex_process =
+      lex_process_create(process, &compiler_lex_functions, NULL);
+  lex_parallel_set_chunks(chunks);
+  int res = lex_parallel(lex_process);
+  lex_parallel_set_chunks(0);
+  harness_check(res == LEXICAL_ANALYSIS_ALL_OK, "%i chunks: lexing failed",
+                chunks);
+  harness_check(process->cfile.offset == process->cfile.size,
+                "%i chunks: the source is not fully lexed", chunks);
+  return lex_process_tokens(lex_process);
+}
+
+/**
+ * Lexes the file in a forced number of chunks, from one chunk per line or
+ * so up to a single chunk, and checks the tokens are the ones lex() gives.
+ */
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    struct vector *expected = harness_lex_file(argv[i], 0);
+    for (int chunks = 1; chunks <= 64; chunks *= 2) {
+      char what[PATH_MAX + 32];
+      snprintf(what, sizeof(what), "%s in %i chunks", argv[i], chunks);
+      harness_tokens_equal(expected, lex_parallel_test_lex(argv[i], chunks),
+                           what);
+    }
+  }
+
+  return harness_finish("lex_parallel_test");
+}
@@ -0,0 +1,100 @@
+#include "helpers/vector.h"
+#include "tests/harness.h"
+#include <stdlib.h>
+
+// the sample is repeated up to this size so the timing is not all startup
+#define LEX_SCAN_BENCH_SIZE (4 * 1024 * 1024)
+#define LEX_SCAN_BENCH_ROUNDS 5
+
+static char *lex_scan_bench_data(const char *filename, size_t *size_out) {
+  FILE *file = fopen(filename, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", filename);
+    exit(1);
+  }
+
+  size_t size = 0;
+  char *sample = compile_process_read_file(file, &size);
+  fclose(file);
+
+  size_t repeat = size ? (LEX_SCAN_BENCH_SIZE + size - 1) / size : 1;
+  char *data = malloc(size * repeat + 1);
+  for (size_t i = 0; i < repeat; i++) {
+    memcpy(&data[i * size], sample, size);
+  }
+
+  data[size * repeat] = 0x00;
+  free(sample);
+  *size_out = size * repeat;
+  return data;
+}
+
+static struct vector *lex_scan_bench_lex(const char *data, size_t size,
+                                         double *time_out) {
+  char *copy = malloc(size + 1);
+  memcpy(copy, data, size + 1);
+  struct compile_process *process = harness_process_for_data(copy, size, 0);
+  double start = harness_now();
+  struct vector *tokens = harness_lex(process);
+  *time_out = harness_now() - start;
+  // the tokens are only compared, nothing reads the source through them
+  free(copy);
+  return tokens;
+}
+
+// scans the source a line at a time like a line comment is skipped
+static double lex_scan_bench_lines(const char *data, size_t size) {
+  double start = harness_now();
+  for (int round = 0; round < LEX_SCAN_BENCH_ROUNDS; round++) {
+    const char *ptr = data;
+    while (*ptr) {
+      ptr += lex_scan_until_char(ptr, '\n');
+      ptr += *ptr ? 1 : 0;
+    }
+  }
+
+  return (harness_now() - start) / LEX_SCAN_BENCH_ROUNDS;
+}
+
+/**
+ * Lexes the same source with every scanner level the cpu supports, reports
+ * the throughput of each and checks they all give the scalar tokens.
+ */
+int main(int argc, char **argv) {
+  const char *filename = argc > 1 ? argv[1] : "./tests/data/lex_sample.c";
+  size_t size = 0;
+  char *data = lex_scan_bench_data(filename, &size);
+
+  int best = lex_scan_select(LEX_SCAN_LEVEL_BEST);
+  struct vector *expected = NULL;
+  for (int level = LEX_SCAN_LEVEL_SCALAR; level <= best; level++) {
+    lex_scan_select(level);
+    double best_time = 0;
+    struct vector *tokens = NULL;
+    for (int round = 0; round < LEX_SCAN_BENCH_ROUNDS; round++) {
+      if (tokens) {
+        vector_free(tokens);
+      }
+
+      double time = 0;
+      tokens = lex_scan_bench_lex(data, size, &time);
+      if (round == 0 || time < best_time) {
+        best_time = time;
+      }
+    }
+
+    double lines_time = lex_scan_bench_lines(data, size);
+    printf("%-8s lex %8.1f MB/s, line scan %8.1f MB/s (%zu bytes, %i "
+           "tokens)\n",
+           lex_scan_level_name(level), size / best_time / (1024 * 1024),
+           size / lines_time / (1024 * 1024), size, vector_count(tokens));
+    if (!expected) {
+      expected = tokens;
+    } else {
+      harness_tokens_equal(expected, tokens, lex_scan_level_name(level));
+      vector_free(tokens);
+    }
+  }
+
+  return harness_finish("lex_scan_bench");
+}
@@ -1,6 +1,9 @@
 #include "compiler.h"
 #include "helpers/buffer.h"
+#include "helpers/intern.h"
 #include "helpers/vector.h"
+#include <stdio.h>
+#include <string.h>
 
 #define PRIMITIVE_TYPES_TOTAL 7
 
@@ -24,6 +27,20 @@ bool token_is_operator(struct token *token, const char *value) {
          S_EQ(token->sval, value);
 }
 
+// tokens of these types keep their text in sval, the rest hold a value
+bool token_type_has_text(int type) {
+  switch (type) {
+  case TOKEN_TYPE_IDENTIFIER:
+  case TOKEN_TYPE_KEYWORD:
+  case TOKEN_TYPE_OPERATOR:
+  case TOKEN_TYPE_STRING:
+  case TOKEN_TYPE_COMMENT:
+    return true;
+  }
+
+  return false;
+}
+
 bool is_operator_token(struct token *token) {
   return token && token->type == TOKEN_TYPE_OPERATOR;
 }
@@ -55,6 +72,38 @@ bool token_is_primitive_keyword(struct token *token) {
   return false;
 }
 
+void token_number_spelling(struct token *token, char *spelling) {
+  unsigned long long value = token->llnum;
+  int len = 0;
+  if (token->flags & TOKEN_FLAG_HEX_NUMBER) {
+    len = sprintf(spelling, "0x%llx", value);
+  } else if (token->flags & TOKEN_FLAG_BINARY_NUMBER) {
+    int bits = 1;
+    while (bits < 64 && value >> bits) {
+      bits++;
+    }
+
+    len = sprintf(spelling, "0b");
+    for (int i = bits - 1; i >= 0; i--) {
+      spelling[len++] = (value >> i) & 1 ? '1' : '0';
+    }
+  } else {
+    len = sprintf(spelling, "%lld", token->llnum);
+  }
+
+  if (token->flags & TOKEN_FLAG_UNSIGNED_NUMBER) {
+    spelling[len++] = 'U';
+  }
+
+  if (token->num.type == NUMBER_TYPE_LONG) {
+    spelling[len++] = 'L';
+  } else if (token->num.type == NUMBER_TYPE_FLOAT) {
+    spelling[len++] = 'f';
+  }
+
+  spelling[len] = 0x00;
+}
+
 void tokens_join_buffer_write_token(struct buffer *fmt_buf,
                                     struct token *token) {
   switch (token->type) {
@@ -68,9 +117,12 @@ void tokens_join_buffer_write_token(struct buffer *fmt_buf,
     buffer_printf(fmt_buf, "\"%s\"", token->sval);
     break;
 
-  case TOKEN_TYPE_NUMBER:
-    buffer_printf(fmt_buf, "%lld", token->llnum);
+  case TOKEN_TYPE_NUMBER: {
+    char spelling[TOKEN_NUMBER_SPELLING_MAX];
+    token_number_spelling(token, spelling);
+    buffer_printf(fmt_buf, "%s", spelling);
     break;
+  }
 
   case TOKEN_TYPE_NEWLINE:
     buffer_printf(fmt_buf, "\n");
@@ -86,18 +138,200 @@ void tokens_join_buffer_write_token(struct buffer *fmt_buf,
   }
 }
 
-struct vector *tokens_join_vector(struct compile_process *compiler,
-                                  struct vector *token_vec) {
-  struct buffer *buf = buffer_create();
-  vector_set_peek_pointer(token_vec, 0);
-  struct token *token = vector_peek(token_vec);
-  while (token) {
-    tokens_join_buffer_write_token(buf, token);
-    token = vector_peek(token_vec);
+static bool token_is_word(struct token *token) {
+  return token->type == TOKEN_TYPE_IDENTIFIER ||
+         token->type == TOKEN_TYPE_KEYWORD;
+}
+
+void tokens_paste(struct compile_process *compiler, struct token *left,
+                  struct token *right, struct vector *token_vec) {
+  if (token_is_word(left) &&
+      (token_is_word(right) || right->type == TOKEN_TYPE_NUMBER)) {
+    // still a single identifier or keyword, build it without the lexer
+    char number[TOKEN_NUMBER_SPELLING_MAX];
+    const char *right_text = right->sval;
+    if (right->type == TOKEN_TYPE_NUMBER) {
+      token_number_spelling(right, number);
+      right_text = number;
+    }
+
+    size_t left_len = strlen(left->sval);
+    size_t right_len = strlen(right_text);
+    char spelling[left_len + right_len + 1];
+    memcpy(spelling, left->sval, left_len);
+    memcpy(&spelling[left_len], right_text, right_len + 1);
+
+    struct token token = *left;
+    token.type =
+        is_keyword(spelling) ? TOKEN_TYPE_KEYWORD : TOKEN_TYPE_IDENTIFIER;
+    token.sval = intern_table_add_len(compiler->strings, spelling,
+                                      left_len + right_len);
+    token.whitespace = right->whitespace;
+    token.source = NULL;
+    token.between_brackets = 0;
+    token.between_args = 0;
+    vector_push(token_vec, &token);
+    return;
   }
 
+  // only the two pasted tokens are lexed, .e.g - ## = becomes -=
+  struct buffer *buf = buffer_create();
+  tokens_join_buffer_write_token(buf, left);
+  tokens_join_buffer_write_token(buf, right);
   struct lex_process *lex_process =
       tokens_build_for_string(compiler, buffer_ptr(buf));
   assert(lex_process);
-  return lex_process->token_vec;
+  int total = vector_count(lex_process->token_vec);
+  for (int i = 0; i < total; i++) {
+    struct token token = *(struct token *)vector_at(lex_process->token_vec, i);
+    // the end of the string is not the end of the line, keep what followed
+    // the right operand like the pastes above do
+    if (i == total - 1) {
+      token.whitespace = right->whitespace;
+    }
+    vector_push(token_vec, &token);
+  }
+  lex_process_free(lex_process);
+  buffer_free(buf);
+}
+
+const char *tokens_spelling(struct compile_process *compiler,
+                            struct token *tokens, int total) {
+  struct buffer *buf = buffer_create();
+  for (int i = 0; i < total; i++) {
+    struct token *token = &tokens[i];
+    tokens_join_buffer_write_token(buf, token);
+    if (token->whitespace && i + 1 < total) {
+      buffer_write(buf, ' ');
+    }
+  }
+
+  buffer_write(buf, 0x00);
+  const char *spelling = intern_table_add(compiler->strings, buffer_ptr(buf));
+  buffer_free(buf);
+  return spelling;
+}
+
+// skips a string or character literal starting at the quote, returns the
+// position of the closing quote
+static const char *token_source_skip_literal(const char *ptr) {
+  char delim = *ptr;
+  for (ptr++; *ptr && *ptr != delim; ptr++) {
+    if (*ptr == '\\' && ptr[1]) {
+      ptr++;
+    }
+  }
+
+  return *ptr ? ptr : ptr - 1;
+}
+
+// skips a comment starting at the slash, returns the position of its last
+// character
+static const char *token_source_skip_comment(const char *ptr) {
+  if (ptr[1] == '/') {
+    while (ptr[1] && ptr[1] != '\n') {
+      ptr++;
+    }
+    return ptr;
+  }
+
+  ptr += 2;
+  while (*ptr && !(ptr[0] == '*' && ptr[1] == '/')) {
+    ptr++;
+  }
+
+  return *ptr ? ptr + 1 : ptr - 1;
+}
+
+// rebuilds the text from the given offset up to the bracket that closes it
+static const char *token_source_text_until_close_bracket(const char *source,
+                                                         int start) {
+  const char *begin = &source[start];
+  const char *ptr = begin;
+  int depth = 0;
+  for (; *ptr; ptr++) {
+    char c = *ptr;
+    if (c == '"' || c == '\'') {
+      ptr = token_source_skip_literal(ptr);
+    } else if (c == '/' && (ptr[1] == '/' || ptr[1] == '*')) {
+      ptr = token_source_skip_comment(ptr);
+    } else if (c == '(') {
+      depth++;
+    } else if (c == ')') {
+      if (depth == 0) {
+        break;
+      }
+      depth--;
+    }
+  }
+
+  size_t len = ptr - begin;
+  char *text = malloc(len + 1);
+  memcpy(text, begin, len);
+  text[len] = 0x00;
+  return text;
+}
+
+const char *token_between_brackets(struct token *token) {
+  if (!token->source || !token->between_brackets) {
+    return NULL;
+  }
+
+  return token_source_text_until_close_bracket(token->source,
+                                               token->between_brackets);
+}
+
+const char *token_between_args(struct token *token) {
+  if (!token->source || !token->between_args) {
+    return NULL;
+  }
+
+  return token_source_text_until_close_bracket(token->source,
+                                               token->between_args);
+}
+
+void token_cursor_init(struct token_cursor *cursor, struct vector *segments) {
+  cursor->segments = segments;
+  cursor->segment = 0;
+  cursor->index = 0;
+  if (!vector_empty(segments)) {
+    cursor->index = ((struct token_segment *)vector_at(segments, 0))->start;
+  }
+}
+
+struct token *token_cursor_peek(struct token_cursor *cursor) {
+  while (cursor->segment < vector_count(cursor->segments)) {
+    struct token_segment *segment =
+        vector_at(cursor->segments, cursor->segment);
+    if (cursor->index < segment->end) {
+      return vector_at(segment->token_vec, cursor->index);
+    }
+
+    cursor->segment++;
+    if (cursor->segment < vector_count(cursor->segments)) {
+      segment = vector_at(cursor->segments, cursor->segment);
+      cursor->index = segment->start;
+    }
+  }
+
+  return NULL;
+}
+
+struct token *token_cursor_next(struct token_cursor *cursor) {
+  struct token *token = token_cursor_peek(cursor);
+  if (token) {
+    cursor->index++;
+  }
+
+  return token;
+}
+
+int token_segments_count(struct vector *segments) {
+  int total = 0;
+  for (int i = 0; i < vector_count(segments); i++) {
+    struct token_segment *segment = vector_at(segments, i);
+    total += segment->end - segment->start;
+  }
+
+  return total;
 }
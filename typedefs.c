@@ -0,0 +1,100 @@
+#include "compiler.h"
+#include "helpers/vector.h"
+#include <stdlib.h>
+
+#define TYPEDEF_TABLE_START_CAPACITY 64
+
+struct typedef_entry {
+  const char *name;
+  struct datatype dtype;
+  // how many typedefs were added before this one
+  size_t index;
+};
+
+struct typedef_table *typedef_table_create() {
+  struct typedef_table *table = calloc(1, sizeof(struct typedef_table));
+  hashmap_init(&table->entries, TYPEDEF_TABLE_START_CAPACITY,
+               HASHMAP_STRING_KEYS);
+  table->order = vector_create(sizeof(struct typedef_entry *));
+  return table;
+}
+
+// a typedef may be repeated with the very same type
+static bool typedef_datatype_equals(struct datatype *a, struct datatype *b) {
+  if (a->type != b->type || a->flags != b->flags ||
+      a->pointer_depth != b->pointer_depth || a->array.size != b->array.size ||
+      !a->secondary != !b->secondary ||
+      (a->secondary && a->secondary->type != b->secondary->type)) {
+    return false;
+  }
+
+  // anonymous structures and unions are only ever the same as themselves
+  if (a->flags & DATATYPE_FLAG_STRUCT_UNION_NO_NAME) {
+    return a->struct_node == b->struct_node;
+  }
+
+  return a->type_str == b->type_str || S_EQ(a->type_str, b->type_str);
+}
+
+bool typedef_table_add(struct typedef_table *table, const char *name,
+                       struct datatype *dtype) {
+  struct hashmap_entry *found = hashmap_find(&table->entries, name);
+  if (found) {
+    struct typedef_entry *entry = found->value;
+    return typedef_datatype_equals(&entry->dtype, dtype);
+  }
+
+  struct typedef_entry *entry = calloc(1, sizeof(struct typedef_entry));
+  entry->name = name;
+  entry->dtype = *dtype;
+  entry->index = vector_count(table->order);
+  hashmap_add(&table->entries, name, entry);
+  vector_push(table->order, &entry);
+  return true;
+}
+
+struct datatype *typedef_table_get(struct typedef_table *table,
+                                   const char *name) {
+  if (!name) {
+    return NULL;
+  }
+
+  struct hashmap_entry *found = hashmap_find(&table->entries, name);
+  if (!found) {
+    return NULL;
+  }
+
+  struct typedef_entry *entry = found->value;
+  if (entry->index >= table->hidden_start &&
+      entry->index < table->hidden_end) {
+    return NULL;
+  }
+
+  return &entry->dtype;
+}
+
+size_t typedef_table_count(struct typedef_table *table) {
+  return vector_count(table->order);
+}
+
+struct datatype *typedef_table_at(struct typedef_table *table, size_t index,
+                                  const char **name_out) {
+  if (index >= vector_count(table->order)) {
+    return NULL;
+  }
+
+  struct typedef_entry *entry =
+      *(struct typedef_entry **)vector_at(table->order, index);
+  *name_out = entry->name;
+  return &entry->dtype;
+}
+
+void typedef_table_hide_after(struct typedef_table *table, size_t count) {
+  table->hidden_start = count;
+  table->hidden_end = vector_count(table->order);
+}
+
+void typedef_table_show_all(struct typedef_table *table) {
+  table->hidden_start = 0;
+  table->hidden_end = 0;
+}
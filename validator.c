@@ -59,7 +59,7 @@ void validate_expressionable(struct node *node) {
 
 void validate_return_node(struct node *node) {
   if (node->stmt.return_stmt.exp) {
-    if (datatype_is_void_no_ptr(&current_function->func.rtype)) {
+    if (datatype_is_void_no_ptr(&current_function->func->rtype)) {
       compiler_node_error(node, "returning value from void function");
     }
 
@@ -176,18 +176,19 @@ void validate_function_args(struct function_args *func_args) {
 void validate_function_node(struct node *node) {
   current_function = node;
   if (!(node->flags & NODE_FLAG_IS_FORWARD_DECLARATION)) {
-    validate_symbol_unique(node->func.name, "function", node);
+    validate_symbol_unique(node->func->name, "function", node);
   }
 
   symresolver_register_symbol(validator_current_compile_process,
-                              node->func.name, SYMBOL_TYPE_NODE, node);
+                              node->func->name, SYMBOL_TYPE_NODE, node);
   validation_new_scope(0);
   // validate function args
-  validate_function_args(&node->func.args);
+  validate_function_args(&node->func->args);
 
   // validate function body
-  if (node->func.body_n) {
-    validate_function_body(node->func.body_n);
+  struct node *body_node = function_node_body(node);
+  if (body_node) {
+    validate_function_body(body_node);
   }
 
   validation_finish_scope();